@@ -0,0 +1,57 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Shared bits of the benchmark programs in this folder, include after nb.h.
+// Every benchmark is a single file built straight against src/nb.h:
+//
+//     gcc -O2 bench/resize_bench.c -o resize_bench -lm -lpthread
+//     cl /O2 bench\resize_bench.c
+//
+// The numbers quoted in the commit messages come from these programs, they
+// are only meaningful relative to each other on the same machine.
+
+#if OS_WINDOWS
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+static inline u64
+bench_now_ns(void) {
+#if OS_WINDOWS
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (u64)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (u64)t.tv_sec * 1000000000ull + (u64)t.tv_nsec;
+#endif
+}
+
+static inline double
+bench_ms_since(u64 start) {
+    return (double)(bench_now_ns() - start) / 1e6;
+}
+
+// Xorshift, so every run and every contender sees the same input.
+static u32 bench_random_state = 0x2545F491u;
+
+static inline u32
+bench_random(void) {
+    u32 x = bench_random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    bench_random_state = x;
+    return x;
+}
+
+static inline u64
+bench_random64(void) {
+    return ((u64)bench_random() << 32) | bench_random();
+}
+
+#endif  // BENCH_H
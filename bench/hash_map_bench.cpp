@@ -0,0 +1,104 @@
+// NB_Hash_Map against std::unordered_map with random u64 keys.
+//
+//     g++ -O2 bench/hash_map_bench.cpp -o hash_map_bench -lm -lpthread
+//
+// Prints ns per operation for put, hit, miss and remove at 1K to 10M keys.
+// Small sizes are repeated so every row does about 10M operations.
+
+#define NB_IMPLEMENTATION
+#include "../src/nb.h"
+#include "bench.h"
+
+#include <unordered_map>
+#include <vector>
+
+struct Timings {
+    double put;
+    double hit;
+    double miss;
+    double remove;
+};
+
+static u64 sink;
+
+static void
+run_nb(const std::vector<u64> &keys, const std::vector<u64> &misses, Timings *timings) {
+    s64 count = (s64)keys.size();
+
+    NB_Hash_Map map;
+    nb_hash_map_init_type(&map, NB_HASH_MAP_KEY_U64, u64, 0, nb_current_allocator);
+
+    u64 start = bench_now_ns();
+    for (s64 i = 0; i < count; ++i) *(u64 *)nb_hash_map_put_u64(&map, keys[i]) = (u64)i;
+    timings->put += bench_ms_since(start);
+
+    start = bench_now_ns();
+    for (s64 i = 0; i < count; ++i) sink += *(u64 *)nb_hash_map_find_u64(&map, keys[i]);
+    timings->hit += bench_ms_since(start);
+
+    start = bench_now_ns();
+    for (s64 i = 0; i < count; ++i) sink += nb_hash_map_find_u64(&map, misses[i]) != null;
+    timings->miss += bench_ms_since(start);
+
+    start = bench_now_ns();
+    for (s64 i = 0; i < count; ++i) nb_hash_map_remove_u64(&map, keys[i]);
+    timings->remove += bench_ms_since(start);
+
+    nb_hash_map_release(&map);
+}
+
+static void
+run_std(const std::vector<u64> &keys, const std::vector<u64> &misses, Timings *timings) {
+    s64 count = (s64)keys.size();
+
+    std::unordered_map<u64, u64> map;
+
+    u64 start = bench_now_ns();
+    for (s64 i = 0; i < count; ++i) map[keys[i]] = (u64)i;
+    timings->put += bench_ms_since(start);
+
+    start = bench_now_ns();
+    for (s64 i = 0; i < count; ++i) sink += map.find(keys[i])->second;
+    timings->hit += bench_ms_since(start);
+
+    start = bench_now_ns();
+    for (s64 i = 0; i < count; ++i) sink += map.find(misses[i]) != map.end();
+    timings->miss += bench_ms_since(start);
+
+    start = bench_now_ns();
+    for (s64 i = 0; i < count; ++i) map.erase(keys[i]);
+    timings->remove += bench_ms_since(start);
+}
+
+int main() {
+    print("               put /   hit /  miss / remove  (ns per operation)\n");
+
+    const s64 counts[] = {1000, 100000, 1000000, 10000000};
+    for (s64 count : counts) {
+        std::vector<u64> keys((size_t)count);
+        std::vector<u64> misses((size_t)count);
+        bench_random_state = 12345;
+        for (s64 i = 0; i < count; ++i) {
+            keys[i]   = bench_random64();
+            misses[i] = bench_random64();
+        }
+
+        s64 repeats = 10000000 / count;
+        Timings nb_timings  = {};
+        Timings std_timings = {};
+        for (s64 repeat = 0; repeat < repeats; ++repeat) run_nb(keys, misses, &nb_timings);
+        for (s64 repeat = 0; repeat < repeats; ++repeat) run_std(keys, misses, &std_timings);
+
+        double scale = 1e6 / ((double)count * (double)repeats);
+        print("%8lld  nb  %5.0f / %5.0f / %5.0f / %5.0f\n", (long long)count,
+              nb_timings.put * scale, nb_timings.hit * scale,
+              nb_timings.miss * scale, nb_timings.remove * scale);
+        print("          std %5.0f / %5.0f / %5.0f / %5.0f\n",
+              std_timings.put * scale, std_timings.hit * scale,
+              std_timings.miss * scale, std_timings.remove * scale);
+    }
+
+    // Keeps the lookups from being optimized away.
+    if (sink == 42) print("\n");
+    return 0;
+}
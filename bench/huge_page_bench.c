@@ -0,0 +1,81 @@
+// Random reads over a 512MB arena, with normal pages and with
+// NB_ARENA_LARGE_PAGES.
+//
+//     gcc -O2 bench/huge_page_bench.c -o huge_page_bench -lm -lpthread
+//
+// Every read lands on a random page, so the cost is dominated by TLB
+// misses. Prints the page size each arena actually obtained, and on Linux
+// how much of the process is backed by transparent huge pages.
+
+#define NB_IMPLEMENTATION
+#include "../src/nb.h"
+#include "bench.h"
+
+#include <stdio.h>
+
+#define ARENA_SIZE NB_MB(512)
+#define READ_COUNT 20000000
+
+// AnonHugePages of the whole process in KB, -1 when unknown.
+static long
+anon_huge_pages_kb(void) {
+    long kb = -1;
+#if OS_LINUX
+    FILE *file = fopen("/proc/self/smaps_rollup", "r");
+    if (!file) return -1;
+
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) break;
+    }
+
+    fclose(file);
+#endif
+    return kb;
+}
+
+static double
+random_reads(u8 *memory, s64 size) {
+    memset(memory, 1, (umm)size);  // Fault everything in first.
+
+    u64 sum = 0;
+    u64 start = bench_now_ns();
+    for (s64 i = 0; i < READ_COUNT; ++i) {
+        sum += memory[bench_random64() % (u64)size];
+    }
+    double ns = (double)(bench_now_ns() - start) / READ_COUNT;
+
+    if (sum == 42) print("\n");  // Keeps the reads.
+    return ns;
+}
+
+int main(void) {
+    print("Large page size: %lld KB\n", (long long)(nb_os_get_large_page_size() / 1024));
+
+    for (int large = 0; large < 2; ++large) {
+        NB_Arena arena = {0};
+        if (!nb_arena_init_ex(&arena, ARENA_SIZE, large ? NB_ARENA_LARGE_PAGES : 0)) {
+            print("Could not reserve the arena.\n");
+            return 1;
+        }
+
+        long huge_before = anon_huge_pages_kb();
+
+        u8 *memory = (u8 *)nb_arena_alloc(&arena, ARENA_SIZE);
+        if (!memory) {
+            print("Could not commit the arena.\n");
+            return 1;
+        }
+
+        bench_random_state = 0x2545F491u;
+        double ns = random_reads(memory, ARENA_SIZE);
+
+        print("%-12s page_size %8lld KB  %6.2f ns/read  AnonHugePages %+ld KB\n",
+              large ? "large pages" : "normal",
+              (long long)(arena.page_size / 1024), ns, anon_huge_pages_kb() - huge_before);
+
+        nb_arena_release(&arena);
+    }
+
+    return 0;
+}
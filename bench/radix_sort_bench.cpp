@@ -0,0 +1,89 @@
+// The radix sorts against nb_qsort and std::sort on random keys.
+//
+//     g++ -O2 bench/radix_sort_bench.cpp -o radix_sort_bench -lm -lpthread
+//
+// Prints the best time in ns per element for 1K to 50M keys. nb_qsort is
+// skipped above 10M. The 50M row needs about 2 GB of memory.
+
+#define NB_IMPLEMENTATION
+#include "../src/nb.h"
+#include "bench.h"
+
+#include <algorithm>
+#include <vector>
+
+enum Sort_Kind {
+    SORT_RADIX_U32,
+    SORT_RADIX_U32_VALUES,
+    SORT_RADIX_U64,
+    SORT_NB_QSORT,
+    SORT_STD_SORT,
+
+    SORT_KIND_COUNT,
+};
+
+static s64
+compare_u32(void *a, void *b) {
+    u32 x = *(u32 *)a;
+    u32 y = *(u32 *)b;
+    return (x > y) - (x < y);
+}
+
+int main() {
+    print("%10s %12s %12s %12s %12s %12s   (ns per element)\n",
+          "count", "radix u32", "radix u32+v", "radix u64", "nb_qsort", "std::sort");
+
+    const s64 counts[] = {1000, 10000, 100000, 1000000, 10000000, 50000000};
+    for (s64 count : counts) {
+        std::vector<u32> source((size_t)count), keys((size_t)count), values((size_t)count);
+        std::vector<u64> source64((size_t)count), keys64((size_t)count);
+        for (s64 i = 0; i < count; ++i) {
+            source[i]   = bench_random();
+            source64[i] = bench_random64();
+            values[i]   = (u32)i;
+        }
+
+        int repeats = count <= 100000 ? 50 : count <= 1000000 ? 5 : 1;
+
+        double best[SORT_KIND_COUNT];
+        for (int kind = 0; kind < SORT_KIND_COUNT; ++kind) best[kind] = -1;
+
+        for (int repeat = 0; repeat < repeats; ++repeat) {
+            for (int kind = 0; kind < SORT_KIND_COUNT; ++kind) {
+                if (kind == SORT_NB_QSORT && count > 10000000) continue;
+
+                keys   = source;
+                keys64 = source64;
+
+                u64 start = bench_now_ns();
+                bool ok = true;
+                switch (kind) {
+                    case SORT_RADIX_U32:        ok = nb_radix_sort_u32(keys.data(), null, count); break;
+                    case SORT_RADIX_U32_VALUES: ok = nb_radix_sort_u32(keys.data(), values.data(), count); break;
+                    case SORT_RADIX_U64:        ok = nb_radix_sort_u64(keys64.data(), null, count); break;
+                    case SORT_NB_QSORT:         nb_qsort(keys.data(), count, sizeof(u32), compare_u32); break;
+                    case SORT_STD_SORT:         std::sort(keys.begin(), keys.end()); break;
+                }
+                double ns = (double)(bench_now_ns() - start);
+
+                if (!ok) {
+                    print("The temporary storage ran out at %lld keys.\n", (long long)count);
+                    return 1;
+                }
+                if (best[kind] < 0 || ns < best[kind]) best[kind] = ns;
+            }
+
+            // Grows the base block to the high water mark, so later repeats do not chain blocks.
+            nb_reset_temporary_storage();
+        }
+
+        print("%10lld", (long long)count);
+        for (int kind = 0; kind < SORT_KIND_COUNT; ++kind) {
+            if (best[kind] < 0) print(" %12s", "-");
+            else                print(" %12.1f", best[kind] / (double)count);
+        }
+        print("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+// Grows one buffer to 16 MB in 4 KB steps through NB_ALLOCATOR_RESIZE.
+//
+//     gcc -O2 bench/resize_bench.c -o resize_bench -lm -lpthread
+//
+// "alloc/copy/free" is what nb_heap_allocator did before it resized in
+// place: a fresh block, a copy of the old contents and a free every step.
+// The temporary storage extends its last allocation in place until the
+// block is full, then moves it to a chained block.
+
+#define NB_IMPLEMENTATION
+#include "../src/nb.h"
+#include "bench.h"
+
+#include <stdlib.h>
+
+static NB_ALLOCATOR_PROC(copy_resize_allocator) {
+    if (mode == NB_ALLOCATOR_RESIZE) {
+        void *result = malloc((size_t)size);
+        if (result && old_memory) {
+            memcpy(result, old_memory, (size_t)old_size);
+            free(old_memory);
+        }
+        return result;
+    }
+    return nb_heap_allocator(mode, size, old_size, old_memory, allocator_data);
+}
+
+static double
+grow(NB_Allocator allocator, s64 total, s64 step) {
+    u64 start = bench_now_ns();
+
+    u8 *memory = null;
+    for (s64 size = 0; size < total; size += step) {
+        memory = (u8 *)allocator.proc(NB_ALLOCATOR_RESIZE, size + step, size, memory, allocator.data);
+        assert(memory);
+        memory[size] = 1;  // Touch the new tail like a real append would.
+    }
+
+    double ms = bench_ms_since(start);
+    if (allocator.proc == nb_temporary_storage_proc) {
+        nb_reset_temporary_storage();  // It does not free single allocations.
+    } else {
+        allocator.proc(NB_ALLOCATOR_FREE, 0, 0, memory, allocator.data);
+    }
+    return ms;
+}
+
+int main(void) {
+    s64 total = NB_MB(16);
+    s64 step  = NB_KB(4);
+
+    NB_Allocator copy_heap = {copy_resize_allocator, null};
+    NB_Allocator heap      = {nb_heap_allocator, null};
+
+    NB_Arena arena = {0};
+    NB_Allocator arena_allocator = nb_arena_allocator(&arena);
+
+    print("Growing to %lld KB in %lld KB steps:\n", (long long)(total / 1024), (long long)(step / 1024));
+    print("alloc/copy/free  %10.3f ms\n", grow(copy_heap, total, step));
+    print("heap realloc     %10.3f ms\n", grow(heap, total, step));
+    print("arena in place   %10.3f ms\n", grow(arena_allocator, total, step));
+    print("temporary        %10.3f ms\n", grow(nb_temporary_allocator, total, step));
+
+    return 0;
+}
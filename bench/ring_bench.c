@@ -0,0 +1,192 @@
+// Contention on NB_MPMC_Ring with 1 to N producer threads and one
+// consumer, NB_SPSC_Ring is the 1:1 baseline.
+//
+//     gcc -O2 bench/ring_bench.c -o ring_bench -lm -lpthread
+//     ./ring_bench [max_producers]
+//
+// Producers push (producer << 40 | sequence) in batches of 1, 8 and 64,
+// the consumer checks that every producer's items arrive in order and
+// that none is lost. Prints items per second through the ring.
+// Run it on a machine with more cores than threads, otherwise it only
+// measures the scheduler.
+
+#define NB_IMPLEMENTATION
+#include "../src/nb.h"
+#include "bench.h"
+
+#include <stdlib.h>
+
+#if OS_WINDOWS
+typedef HANDLE Bench_Thread;
+#define BENCH_THREAD_PROC(name) DWORD WINAPI name(void *data)
+#else
+#include <pthread.h>
+#include <sched.h>
+typedef pthread_t Bench_Thread;
+#define BENCH_THREAD_PROC(name) void *name(void *data)
+#endif
+
+typedef BENCH_THREAD_PROC(Bench_Thread_Proc);
+
+static Bench_Thread
+bench_thread_start(Bench_Thread_Proc *proc, void *data) {
+#if OS_WINDOWS
+    return CreateThread(null, 0, proc, data, 0, null);
+#else
+    pthread_t thread;
+    pthread_create(&thread, null, proc, data);
+    return thread;
+#endif
+}
+
+static void
+bench_thread_join(Bench_Thread thread) {
+#if OS_WINDOWS
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, null);
+#endif
+}
+
+static void
+bench_yield(void) {
+#if OS_WINDOWS
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+#define ITEM_COUNT     4000000  // Per run, split between the producers.
+#define RING_CAPACITY  1024
+#define MAX_PRODUCERS  64
+#define SEQUENCE_BITS  40
+
+typedef struct Producer {
+    s64 index;
+    s64 item_count;
+} Producer;
+
+static NB_SPSC_Ring spsc_ring;
+static NB_MPMC_Ring mpmc_ring;
+static s64 batch_size;
+
+static BENCH_THREAD_PROC(spsc_producer) {
+    Producer *producer = (Producer *)data;
+
+    u64 batch[64];
+    s64 sent = 0;
+    while (sent < producer->item_count) {
+        s64 count = nb_min(batch_size, producer->item_count - sent);
+        for (s64 i = 0; i < count; ++i) batch[i] = (u64)(sent + i);
+
+        s64 pushed = 0;
+        while (pushed < count) {
+            s64 n = nb_spsc_ring_push(&spsc_ring, batch + pushed, count - pushed);
+            if (!n) bench_yield();
+            pushed += n;
+        }
+
+        sent += count;
+    }
+
+    return 0;
+}
+
+static BENCH_THREAD_PROC(mpmc_producer) {
+    Producer *producer = (Producer *)data;
+    u64 tag = (u64)producer->index << SEQUENCE_BITS;
+
+    u64 batch[64];
+    s64 sent = 0;
+    while (sent < producer->item_count) {
+        s64 count = nb_min(batch_size, producer->item_count - sent);
+        for (s64 i = 0; i < count; ++i) batch[i] = tag | (u64)(sent + i);
+
+        s64 pushed = 0;
+        while (pushed < count) {
+            s64 n = nb_mpmc_ring_push(&mpmc_ring, batch + pushed, count - pushed);
+            if (!n) bench_yield();
+            pushed += n;
+        }
+
+        sent += count;
+    }
+
+    return 0;
+}
+
+// Runs on the main thread, returns false on a lost or reordered item.
+static bool
+consume(bool mpmc, s64 producer_count, s64 total) {
+    s64 next[MAX_PRODUCERS] = {0};
+
+    u64 batch[64];
+    s64 received = 0;
+    while (received < total) {
+        s64 n = mpmc ? nb_mpmc_ring_pop(&mpmc_ring, batch, batch_size)
+                     : nb_spsc_ring_pop(&spsc_ring, batch, batch_size);
+        if (!n) {
+            bench_yield();
+            continue;
+        }
+
+        for (s64 i = 0; i < n; ++i) {
+            s64 producer = (s64)(batch[i] >> SEQUENCE_BITS);
+            s64 sequence = (s64)(batch[i] & (((u64)1 << SEQUENCE_BITS) - 1));
+            if (producer >= producer_count || sequence != next[producer]) return false;
+            next[producer] += 1;
+        }
+
+        received += n;
+    }
+
+    return true;
+}
+
+static void
+run(bool mpmc, s64 producer_count) {
+    Producer producers[MAX_PRODUCERS];
+    Bench_Thread threads[MAX_PRODUCERS];
+
+    s64 total = (ITEM_COUNT / producer_count) * producer_count;
+
+    u64 start = bench_now_ns();
+    for (s64 i = 0; i < producer_count; ++i) {
+        producers[i].index = i;
+        producers[i].item_count = total / producer_count;
+        threads[i] = bench_thread_start(mpmc ? mpmc_producer : spsc_producer, &producers[i]);
+    }
+
+    bool ok = consume(mpmc, producer_count, total);
+
+    for (s64 i = 0; i < producer_count; ++i) bench_thread_join(threads[i]);
+    double seconds = (double)(bench_now_ns() - start) / 1e9;
+
+    print("%-5s %9lld %6lld %14.1f M items/s%s\n",
+          mpmc ? "mpmc" : "spsc", (long long)producer_count, (long long)batch_size,
+          (double)total / seconds / 1e6, ok ? "" : "  LOST OR REORDERED ITEMS");
+}
+
+int main(int argc, char **argv) {
+    s64 max_producers = 4;
+    if (argc > 1) max_producers = atoi(argv[1]);
+    if (max_producers < 1) max_producers = 1;
+    if (max_producers > MAX_PRODUCERS) max_producers = MAX_PRODUCERS;
+
+    nb_spsc_ring_init_type(&spsc_ring, u64, RING_CAPACITY, nb_current_allocator);
+    nb_mpmc_ring_init_type(&mpmc_ring, u64, RING_CAPACITY, nb_current_allocator);
+
+    print("ring  producers  batch     throughput\n");
+    for (batch_size = 1; batch_size <= 64; batch_size *= 8) {
+        run(false, 1);
+        for (s64 producer_count = 1; producer_count <= max_producers; ++producer_count) {
+            run(true, producer_count);
+        }
+    }
+
+    nb_spsc_ring_release(&spsc_ring);
+    nb_mpmc_ring_release(&mpmc_ring);
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Allocation count of a logging and path manipulation workload, with
+// mprint/nb_new_array against NB_Small_String/NB_Small_Array.
+//
+//     gcc -O2 bench/small_buffer_bench.c -o small_buffer_bench -lm -lpthread
+//
+// Each iteration formats one log line and one asset path, then splits the
+// path into the offsets of its components. All the memory goes through a
+// counting allocator bound as nb_current_allocator.
+
+#define NB_IMPLEMENTATION
+#include "../src/nb.h"
+#include "bench.h"
+
+#define ITERATION_COUNT 300000
+#define MAX_COMPONENTS  16
+
+static s64 allocation_count;
+
+static NB_ALLOCATOR_PROC(counting_allocator) {
+    NB_Allocator_Mode base_mode = nb_allocator_base_mode(mode);
+    if ((base_mode == NB_ALLOCATOR_ALLOCATE) || (base_mode == NB_ALLOCATOR_RESIZE)) {
+        allocation_count += 1;
+    }
+
+    return nb_heap_allocator(mode, size, old_size, old_memory, allocator_data);
+}
+
+static const char *directories[] = {"data/shaders", "data/textures/terrain", "assets"};
+
+static u64 sink;
+
+static void
+run_mprint(void) {
+    for (s64 i = 0; i < ITERATION_COUNT; ++i) {
+        char *line = mprint("[Renderer] frame %lld: %d draws", (long long)i, (int)(i & 255));
+        char *path = mprint("%s/%s_%lld.dds", directories[i % 3], "grass", (long long)(i & 63));
+
+        u32 *components = nb_new_array(u32, MAX_COMPONENTS);
+        s64 component_count = 0;
+        for (s64 c = 0; path[c] && (component_count < MAX_COMPONENTS); ++c) {
+            if ((c == 0) || (path[c - 1] == '/')) components[component_count++] = (u32)c;
+        }
+
+        sink += (u64)line[3] + (u64)path[components[component_count - 1]];
+
+        nb_free(components);
+        nb_free(line);
+        nb_free(path);
+    }
+}
+
+static void
+run_small_buffers(void) {
+    for (s64 i = 0; i < ITERATION_COUNT; ++i) {
+        NB_Small_String line;
+        NB_Small_String path;
+        nb_small_string_init(&line, nb_current_allocator);
+        nb_small_string_init(&path, nb_current_allocator);
+
+        nb_small_string_print(&line, "[Renderer] frame %lld: %d draws", (long long)i, (int)(i & 255));
+        nb_small_string_print(&path, "%s/%s_%lld.dds", directories[i % 3], "grass", (long long)(i & 63));
+
+        NB_Small_Array components;
+        nb_small_array_init_type(&components, u32, nb_current_allocator);
+
+        char *p = nb_small_string_cstring(&path);
+        for (s64 c = 0; p[c]; ++c) {
+            if ((c == 0) || (p[c - 1] == '/')) {
+                u32 offset = (u32)c;
+                nb_small_array_push(&components, &offset);
+            }
+        }
+
+        u32 last = nb_small_array_at(&components, u32, components.count - 1);
+        sink += (u64)nb_small_string_cstring(&line)[3] + (u64)p[last];
+
+        nb_small_array_release(&components);
+        nb_small_string_release(&line);
+        nb_small_string_release(&path);
+    }
+}
+
+int main(void) {
+    NB_Allocator counting = {counting_allocator, null};
+    nb_push_allocator(counting);
+
+    allocation_count = 0;
+    u64 start = bench_now_ns();
+    run_mprint();
+    double mprint_ns = (double)(bench_now_ns() - start) / ITERATION_COUNT;
+    s64 mprint_count = allocation_count;
+
+    allocation_count = 0;
+    start = bench_now_ns();
+    run_small_buffers();
+    double small_ns = (double)(bench_now_ns() - start) / ITERATION_COUNT;
+    s64 small_count = allocation_count;
+
+    nb_pop_allocator();
+
+    print("%lld iterations, one log line and one path each:\n", (long long)ITERATION_COUNT);
+    print("mprint + nb_new_array      %8lld allocations  %6.1f ns/iteration\n", (long long)mprint_count, mprint_ns);
+    print("small string + small array %8lld allocations  %6.1f ns/iteration\n", (long long)small_count, small_ns);
+
+    if (sink == 42) print("\n");  // Keeps the work.
+    return 0;
+}
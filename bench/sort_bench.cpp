@@ -0,0 +1,150 @@
+// nb_qsort and nb_sort against the previous nb_qsort and std::sort.
+//
+//     g++ -O2 bench/sort_bench.cpp -o sort_bench -lm -lpthread
+//
+// Sorts 1M s32 of six input shapes, best of 3, and counts the comparisons
+// on random input. Results the previous nb_qsort left unsorted are marked
+// with a '*', that column is not a fair baseline.
+
+#define NB_IMPLEMENTATION
+#include "../src/nb.h"
+#include "bench.h"
+
+#include <algorithm>
+#include <vector>
+
+#define ITEM_COUNT  1000000
+#define REPEATS     3
+
+static s64 compare_count;
+
+static s64
+compare_s32(void *a, void *b) {
+    s32 x = *(s32 *)a;
+    s32 y = *(s32 *)b;
+    return (x > y) - (x < y);
+}
+
+static s64
+compare_s32_counted(void *a, void *b) {
+    compare_count += 1;
+    return compare_s32(a, b);
+}
+
+// nb_qsort as it was before the introsort, byte swap included.
+static void
+previous_qsort(void *data, s64 count, s64 stride, s64 (*qsort_compare)(void *, void *)) {
+    if (count < 2) return;
+
+    u8 *start = (u8 *)data;
+    u8 *pivot_address = start + (count / 2) * stride;
+
+    s64 i = 0;
+    s64 j = count-1;
+
+    while (1) {
+        while (qsort_compare(start + i*stride, pivot_address) < 0) { i += 1; }
+        while (qsort_compare(pivot_address, start + j*stride) < 0) { j -= 1; }
+
+        if (i >= j) break;
+
+        u8 *a = start + i*stride;
+        u8 *b = start + j*stride;
+        for (s64 k = 0; k < stride; ++k) {
+            u8 temp = a[k];
+            a[k]    = b[k];
+            b[k]    = temp;
+        }
+
+        i += 1;
+        j -= 1;
+    }
+
+    previous_qsort(start, i, stride, qsort_compare);
+    previous_qsort(start + i*stride, count-i, stride, qsort_compare);
+}
+
+enum Input_Kind {
+    INPUT_RANDOM,
+    INPUT_SORTED,
+    INPUT_REVERSED,
+    INPUT_FEW_UNIQUE,
+    INPUT_ORGAN_PIPE,
+    INPUT_NEARLY_SORTED,
+
+    INPUT_KIND_COUNT,
+};
+
+static const char *input_kind_names[INPUT_KIND_COUNT] = {
+    "random", "sorted", "reversed", "few unique", "organ pipe", "nearly sorted",
+};
+
+static void
+fill(s32 *items, s64 count, int kind) {
+    bench_random_state = 0x2545F491u;
+    for (s64 i = 0; i < count; ++i) {
+        switch (kind) {
+            case INPUT_RANDOM:        items[i] = (s32)bench_random(); break;
+            case INPUT_SORTED:        items[i] = (s32)i; break;
+            case INPUT_REVERSED:      items[i] = (s32)(count - i); break;
+            case INPUT_FEW_UNIQUE:    items[i] = (s32)(bench_random() % 8); break;
+            case INPUT_ORGAN_PIPE:    items[i] = (s32)(i < count / 2 ? i : count - i); break;
+            case INPUT_NEARLY_SORTED: items[i] = (s32)((i % 100) == 0 ? bench_random() : i); break;
+        }
+    }
+}
+
+int main() {
+    const char *sort_names[] = {"old qsort", "nb_qsort", "nb_sort", "std::sort"};
+
+    std::vector<s32> source(ITEM_COUNT);
+    std::vector<s32> work(ITEM_COUNT);
+
+    print("%-14s %11s %11s %11s %11s   (ms, %d s32)\n", "input",
+          sort_names[0], sort_names[1], sort_names[2], sort_names[3], ITEM_COUNT);
+
+    for (int kind = 0; kind < INPUT_KIND_COUNT; ++kind) {
+        fill(source.data(), ITEM_COUNT, kind);
+
+        double best[4];
+        bool   sorted[4];
+        for (int sort = 0; sort < 4; ++sort) {
+            best[sort]   = 1e30;
+            sorted[sort] = true;
+            for (int repeat = 0; repeat < REPEATS; ++repeat) {
+                work = source;
+
+                u64 start = bench_now_ns();
+                switch (sort) {
+                    case 0: previous_qsort(work.data(), ITEM_COUNT, sizeof(s32), compare_s32); break;
+                    case 1: nb_qsort(work.data(), ITEM_COUNT, sizeof(s32), compare_s32); break;
+                    case 2: nb_sort(work.data(), ITEM_COUNT); break;
+                    case 3: std::sort(work.begin(), work.end()); break;
+                }
+                double ms = bench_ms_since(start);
+
+                if (ms < best[sort]) best[sort] = ms;
+                if (!std::is_sorted(work.begin(), work.end())) sorted[sort] = false;
+            }
+        }
+
+        print("%-14s", input_kind_names[kind]);
+        for (int sort = 0; sort < 4; ++sort) print(" %10.1f%c", best[sort], sorted[sort] ? ' ' : '*');
+        print("\n");
+    }
+
+    fill(source.data(), ITEM_COUNT, INPUT_RANDOM);
+
+    work = source;
+    compare_count = 0;
+    previous_qsort(work.data(), ITEM_COUNT, sizeof(s32), compare_s32_counted);
+    s64 previous_compares = compare_count;
+
+    work = source;
+    compare_count = 0;
+    nb_qsort(work.data(), ITEM_COUNT, sizeof(s32), compare_s32_counted);
+
+    print("Comparisons on random input: old qsort %lld, nb_qsort %lld\n",
+          (long long)previous_compares, (long long)compare_count);
+    return 0;
+}
@@ -0,0 +1,82 @@
+// Allocation latency percentiles of NB_TLSF against nb_heap_allocator.
+//
+//     gcc -O2 bench/tlsf_bench.c -o tlsf_bench -lm -lpthread
+//
+// 2M random operations over 20000 slots: an empty slot gets an allocation
+// of 16B-512B (1 in 16 up to 256KB), a full one is freed. Each operation
+// is timed on its own. The first pass only warms the pages up.
+
+#define NB_IMPLEMENTATION
+#include "../src/nb.h"
+#include "bench.h"
+
+#include <stdlib.h>
+
+#define SLOT_COUNT      20000
+#define OPERATION_COUNT 2000000
+
+static u64   latencies[OPERATION_COUNT];
+static void *slots[SLOT_COUNT];
+
+static int
+compare_u64(const void *a, const void *b) {
+    u64 x = *(const u64 *)a;
+    u64 y = *(const u64 *)b;
+    return (x > y) - (x < y);
+}
+
+static void
+run(const char *name, NB_Allocator allocator, bool report) {
+    memset(slots, 0, sizeof(slots));
+    bench_random_state = 777;
+
+    for (s64 op = 0; op < OPERATION_COUNT; ++op) {
+        u32 slot = bench_random() % SLOT_COUNT;
+        s64 size = 16 + bench_random() % ((bench_random() & 15) ? 512 : NB_KB(256));
+
+        u64 start = bench_now_ns();
+        if (slots[slot]) {
+            allocator.proc(NB_ALLOCATOR_FREE, 0, 0, slots[slot], allocator.data);
+            slots[slot] = null;
+        } else {
+            slots[slot] = allocator.proc(NB_ALLOCATOR_ALLOCATE, size, 0, null, allocator.data);
+        }
+        latencies[op] = bench_now_ns() - start;
+
+        if (slots[slot]) ((u8 *)slots[slot])[0] = 1;
+    }
+
+    for (s64 i = 0; i < SLOT_COUNT; ++i) {
+        if (slots[i]) allocator.proc(NB_ALLOCATOR_FREE, 0, 0, slots[i], allocator.data);
+    }
+
+    if (!report) return;
+
+    qsort(latencies, OPERATION_COUNT, sizeof(u64), compare_u64);
+    print("%-5s p50 %5llu ns  p99 %6llu ns  p99.9 %7llu ns  p99.99 %8llu ns  max %9llu ns\n",
+          name,
+          (unsigned long long)latencies[OPERATION_COUNT / 2],
+          (unsigned long long)latencies[(s64)OPERATION_COUNT * 99 / 100],
+          (unsigned long long)latencies[(s64)OPERATION_COUNT * 999 / 1000],
+          (unsigned long long)latencies[(s64)OPERATION_COUNT * 9999 / 10000],
+          (unsigned long long)latencies[OPERATION_COUNT - 1]);
+}
+
+int main(void) {
+    NB_TLSF tlsf;
+    if (!nb_tlsf_init_reserve(&tlsf, NB_GB(2))) {
+        print("Could not reserve the TLSF region.\n");
+        return 1;
+    }
+
+    NB_Allocator heap = {nb_heap_allocator, null};
+    NB_Allocator tlsf_allocator = nb_tlsf_allocator(&tlsf);
+
+    for (int pass = 0; pass < 2; ++pass) {
+        run("heap", heap, pass == 1);
+        run("tlsf", tlsf_allocator, pass == 1);
+    }
+
+    nb_tlsf_release(&tlsf);
+    return 0;
+}
@@ -33,9 +33,8 @@ typedef struct {
     u32 ex_style;
 } Bender_Window_Record;
 
-static Bender_Window_Record *b_window_record_storage;
-static u32 b_window_record_count     = 0;
-static u32 b_window_record_allocated = 0;
+// Window ids are indices in the bucket array, records never move.
+static NB_Bucket_Array b_window_records;
 static HINSTANCE b_w32_instance;
 static WCHAR BENDER_DEFAULT_WINDOW_CLASS_NAME[] = L"BENDER_DEFAULT_WINDOW_CLASS";
 
@@ -83,10 +82,10 @@ NB_INLINE void b_push_event(BEvent event) {
 NB_INLINE Bender_Window_Record *
 b_get_window_record(u32 index) {
     assert(index != -1);
-    assert(index < b_window_record_count);
 
     Bender_Window_Record *result = null;
-    result = b_window_record_storage + index;
+    result = (Bender_Window_Record *)nb_bucket_array_get(&b_window_records, index);
+    assert(result);
 
     return result;
 }
@@ -205,7 +204,7 @@ char *b_w32_wide_to_utf8(wchar_t *s,
     if (!s) return null;
 
     char *result = null;
-    NB_Allocator old_allocator = NB_SET_ALLOCATOR(allocator);
+    nb_push_allocator(allocator);
 
     if (!src_length) src_length = wcslen(s);
     int required_length = WideCharToMultiByte(CP_UTF8,
@@ -227,7 +226,7 @@ char *b_w32_wide_to_utf8(wchar_t *s,
         result[required_length] = 0;
     }
 
-    NB_SET_ALLOCATOR(old_allocator);
+    nb_pop_allocator();
     return result;
 }
 
@@ -1313,24 +1312,15 @@ u32 bender_create_window(const char *title,
     }
 #endif
 
-    if (!b_window_record_storage) {
-        b_window_record_allocated = 1;
-        b_window_record_storage = nb_new_array(Bender_Window_Record, b_window_record_allocated);
-        if (!b_window_record_storage) return result;
+    if (!b_window_records.item_size) {
+        nb_bucket_array_init_type(&b_window_records, Bender_Window_Record, nb_current_allocator);
     }
 
-    if (b_window_record_count == b_window_record_allocated) {
-        u32 old_count = b_window_record_allocated;
-        b_window_record_allocated += 4;
-        b_window_record_storage = (Bender_Window_Record *)nb_realloc(b_window_record_storage, 
-            b_window_record_allocated*size_of(Bender_Window_Record),
-            old_count*size_of(Bender_Window_Record));
-    }
-
-    result = b_window_record_count;
-    b_window_record_count += 1;
+    s64 record_index;
+    Bender_Window_Record *record = (Bender_Window_Record *)nb_bucket_array_add(&b_window_records, &record_index);
+    if (!record) return result;
 
-    Bender_Window_Record *record = b_window_record_storage + result;
+    result = (u32)record_index;
     record->handle   = hwnd;
     record->style    = style;
     record->ex_style = ex_style;
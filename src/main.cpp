@@ -85,8 +85,14 @@ u8 piece_shapes[PIECE_COUNT][4][4] = {
 u8 play_field[PLAY_FIELD_HEIGHT][PLAY_FIELD_WIDTH];
 u32 block_size = 32;
 
-s32 line_indices[32];
-s32 line_indices_count = 0;
+NB_Array<s32> line_indices;
+
+// Advanced one tick per frame.
+NB_Timer_Wheel frame_timers;
+
+void piece_drop_timer_proc(void *data, u32 timer) {
+    *(bool *)data = true;
+}
 
 inline void play_field_to_right_handed_coords(s32 x, s32 y, 
     s32 *x_return, s32 *y_return) {
@@ -135,6 +141,12 @@ int main(void) {
 
     rm_init(id);
 
+    // Reported on exit, to size NB_TS_SIZE_DEFAULT and the frame arenas.
+    NB_Allocator temporary_allocator = {nb_temporary_storage_proc, &nb_temporary_storage};
+    NB_Allocator frame_allocator     = {nb_frame_storage_proc, &nb_frame_storage};
+    nb_register_allocator("Temporary Storage", temporary_allocator);
+    nb_register_allocator("Frame Storage", frame_allocator);
+
     RMShader *block_shader = rm_shader_create_from_file("data/shaders/basic_vertex.hlsl",
                                                         "data/shaders/block_shader.hlsl",
                                                         "Block Shader");
@@ -166,9 +178,10 @@ int main(void) {
     s32 piece_y = 0;
     s32 piece_rotation = 0;
 
-    s32 counter_fin = 20;
-    s32 counter_current = 0;
     bool move_down = false;
+    nb_timer_wheel_init(&frame_timers, 8, nb_current_allocator);
+    nb_timer_add(&frame_timers, 20, 20, piece_drop_timer_proc, &move_down);
+
     bool game_over = false;
     bool is_line_filled = false;
     float global_line_alpha = 1.0f;
@@ -226,8 +239,6 @@ int main(void) {
                         piece_id = (piece_id + 1) % PIECE_COUNT;
                     }
                 }
-
-                nb_reset_temporary_storage();
             }
 
             for (s32 index = 0; index < input->touch_pointer_count; ++index) {
@@ -260,8 +271,8 @@ int main(void) {
                         piece_rotation = (piece_rotation + 1) % 4;
                 }
 
-                counter_current += 1;
-                move_down = (counter_current == counter_fin);
+                move_down = false;
+                nb_timer_wheel_advance(&frame_timers, 1);
 
                 if (move_down) {
                     if (piece_test_occupancy(piece_id, piece_x, piece_y + 1, piece_rotation))
@@ -293,8 +304,7 @@ int main(void) {
                                     }
 
                                     is_line_filled = true;
-                                    line_indices[line_indices_count] = piece_y + y;
-                                    line_indices_count += 1;
+                                    line_indices.push(piece_y + y);
                                 }
                             }
                         }
@@ -311,8 +321,6 @@ int main(void) {
                             nb_write_string("GAME OVER\n", false);
                         }
                     }
-
-                    counter_current = 0;
                 }
             }
 
@@ -322,8 +330,7 @@ int main(void) {
                     is_line_filled = false;
                     global_line_alpha = 1;
 
-                    for (s32 index = 0; index < line_indices_count; ++index) {
-                        s32 row = line_indices[index];
+                    for (s32 row : line_indices) {
                         for (s32 x = 1; x < PLAY_FIELD_WIDTH - 1; ++x) {
                             for (s32 y = row; y > 0; --y) {
                                 play_field[y][x] = play_field[y-1][x];
@@ -333,7 +340,7 @@ int main(void) {
                         }
                     }
 
-                    line_indices_count = 0;
+                    line_indices.reset();
                 }
             }
 
@@ -428,12 +435,23 @@ int main(void) {
             rm_immediate_frame_end();
 
             rm_swap_buffers(id);
+
+            // Temporary memory lives for one frame, frame storage
+            // for NB_FRAME_BUFFER_COUNT frames.
+            nb_reset_temporary_storage();
+            nb_frame_advance();
+
             bender_sleep_ms(50);
         }
     }
 
+    nb_timer_wheel_release(&frame_timers);
     rm_texture_free(texture_id);
 
+#if NB_DEBUG
+    nb_allocator_report();
+#endif
+
     return 0;
 }
 
@@ -17,6 +17,13 @@
 
     #define NB_ENABLE_ASSERTS 1 (0 by default, 1 for debug build)
     #define NB_ENABLE_DEFERS 1 (0 by default)
+    #define NB_TRACK_ALLOCATIONS 1 (0 by default) records the call site
+        of nb_new/nb_new_array/nb_realloc/nb_free and mprint for
+        the tracking allocator.
+
+    #define NB_HEAP_STATS 1 (NB_DEBUG by default) counts the heap
+        allocations for NB_ALLOCATOR_QUERY_STATS, it roughly doubles
+        the cost of small malloc/free pairs.
 
     #define NB_INCLUDE_WINDEFS (undefined by default) use it to include 
         custom "windefs.h" file instead of <windows.h>
@@ -61,6 +68,14 @@
 #define NB_ENABLE_DEFERS 0
 #endif
 
+#ifndef NB_TRACK_ALLOCATIONS
+#define NB_TRACK_ALLOCATIONS 0
+#endif
+
+#ifndef NB_HEAP_STATS
+#define NB_HEAP_STATS NB_DEBUG
+#endif
+
 /******** Compiler detection ********/
 
 #if defined(__clang__)
@@ -204,6 +219,12 @@
 #include <intrin.h>
 #endif
 
+// The strict -std=c99/c11 modes hide the mmap flags, madvise and
+// posix_memalign, this has to come before the first system include.
+#if OS_LINUX && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE 1
+#endif
+
 
 /******** Primitives ********/
 #include <stdint.h>
@@ -507,6 +528,160 @@ typedef enum NB_Arch_Type {
     NB_ARCH_COUNT,
 } NB_Arch_Type;
 
+/******** Atomics ********/
+
+//
+// Sequentially consistent, they are meant for counters, flags and
+// publishing pointers between threads, not for elaborate lock-free
+// containers.
+//
+
+NB_INLINE s32 nb_atomic_load32(volatile s32 *value) {
+#if COMPILER_CL
+    return (s32)_InterlockedCompareExchange((volatile long *)value, 0, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+NB_INLINE void nb_atomic_store32(volatile s32 *value, s32 new_value) {
+#if COMPILER_CL
+    _InterlockedExchange((volatile long *)value, (long)new_value);
+#else
+    __atomic_store_n(value, new_value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Returns the previous value.
+NB_INLINE s32 nb_atomic_exchange32(volatile s32 *value, s32 new_value) {
+#if COMPILER_CL
+    return (s32)_InterlockedExchange((volatile long *)value, (long)new_value);
+#else
+    return __atomic_exchange_n(value, new_value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Returns the previous value, the exchange happened if it is 'expected'.
+NB_INLINE s32 nb_atomic_compare_exchange32(volatile s32 *value, s32 expected, s32 new_value) {
+#if COMPILER_CL
+    return (s32)_InterlockedCompareExchange((volatile long *)value, (long)new_value, (long)expected);
+#else
+    __atomic_compare_exchange_n(value, &expected, new_value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return expected;
+#endif
+}
+
+NB_INLINE s64 nb_atomic_load64(volatile s64 *value) {
+#if COMPILER_CL
+    return _InterlockedCompareExchange64(value, 0, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+NB_INLINE s64 nb_atomic_compare_exchange64(volatile s64 *value, s64 expected, s64 new_value) {
+#if COMPILER_CL
+    return _InterlockedCompareExchange64(value, new_value, expected);
+#else
+    __atomic_compare_exchange_n(value, &expected, new_value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return expected;
+#endif
+}
+
+// Returns the new value.
+NB_INLINE s64 nb_atomic_add64(volatile s64 *value, s64 addend) {
+#if COMPILER_CL && (ARCH_X64 || ARCH_ARM64)
+    return _InterlockedExchangeAdd64(value, addend) + addend;
+#elif COMPILER_CL
+    s64 old_value = *value;
+    for (;;) {
+        s64 previous = _InterlockedCompareExchange64(value, old_value + addend, old_value);
+        if (previous == old_value) break;
+        old_value = previous;
+    }
+
+    return old_value + addend;
+#else
+    return __atomic_add_fetch(value, addend, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Acquire and release orderings for hand-off between two threads, a load
+// acquire sees everything written before the matching store release.
+NB_INLINE s64 nb_atomic_load_acquire64(volatile s64 *value) {
+#if COMPILER_CL && ARCH_X64
+    // x64 loads are not reordered with later accesses, only the compiler can.
+    s64 result = *value;
+    _ReadWriteBarrier();
+    return result;
+#elif COMPILER_CL
+    return _InterlockedCompareExchange64(value, 0, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+NB_INLINE void nb_atomic_store_release64(volatile s64 *value, s64 new_value) {
+#if COMPILER_CL && ARCH_X64
+    _ReadWriteBarrier();
+    *value = new_value;
+#elif COMPILER_CL
+    _InterlockedExchange64(value, new_value);
+#else
+    __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+#endif
+}
+
+NB_INLINE void *nb_atomic_load_pointer(void *volatile *value) {
+#if COMPILER_CL
+    return _InterlockedCompareExchangePointer(value, 0, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+NB_INLINE void nb_atomic_store_pointer(void *volatile *value, void *new_value) {
+#if COMPILER_CL
+    _InterlockedExchangePointer(value, new_value);
+#else
+    __atomic_store_n(value, new_value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Raises the value to 'candidate' if it is lower, for peaks.
+NB_INLINE void nb_atomic_max64(volatile s64 *value, s64 candidate) {
+    s64 old_value = nb_atomic_load64(value);
+    while (old_value < candidate) {
+        s64 previous = nb_atomic_compare_exchange64(value, old_value, candidate);
+        if (previous == old_value) break;
+        old_value = previous;
+    }
+}
+
+NB_INLINE void nb_cpu_relax(void) {
+#if COMPILER_CL && (ARCH_X64 || ARCH_X86)
+    _mm_pause();
+#elif COMPILER_CL
+    __yield();
+#elif ARCH_X64 || ARCH_X86
+    __builtin_ia32_pause();
+#elif ARCH_ARM64
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// A zeroed s32 is an unlocked spin lock, for short critical sections.
+NB_INLINE void nb_spin_lock(volatile s32 *lock) {
+    while (nb_atomic_exchange32(lock, 1) != 0) {
+        while (nb_atomic_load32(lock) != 0) nb_cpu_relax();
+    }
+}
+
+NB_INLINE void nb_spin_unlock(volatile s32 *lock) {
+    nb_atomic_store32(lock, 0);
+}
+
+
 // Custom Allocators.
 
 typedef enum NB_Allocator_Mode {
@@ -514,18 +689,67 @@ typedef enum NB_Allocator_Mode {
     NB_ALLOCATOR_RESIZE,
     NB_ALLOCATOR_FREE,
     NB_ALLOCATOR_FREE_ALL,
+
+    // 'old_memory' is the NB_Allocator_Stats to fill, the proc returns it,
+    // or null when the allocator does not keep statistics.
+    NB_ALLOCATOR_QUERY_STATS,
+
+    //
+    // Flags or-ed into the mode with nb_allocator_mode().
+    // Without ZERO/NO_ZERO allocators keep their default behaviour
+    // (the Windows heap zeroes, the others do not).
+    //
+    NB_ALLOCATOR_ZERO    = 0x100,  // The new bytes must be zeroed.
+    NB_ALLOCATOR_NO_ZERO = 0x200,  // The new bytes may be left uninitialized.
+
+    // Hint, back big blocks with large pages when the allocator can
+    // (only the Linux heap does, through transparent huge pages).
+    NB_ALLOCATOR_LARGE_PAGES = 0x400,
+
+    NB_ALLOCATOR_MODE_MASK  = 0xFF,
+    NB_ALLOCATOR_ALIGN_MASK = 0xFF0000,  // log2(alignment), 0 is the allocator default.
 } NB_Allocator_Mode;
 
+#define NB_ALLOCATOR_ALIGN_SHIFT 16
+
+// The built-in callers (mprint, nb_talloc, pools, ...) or flags into
+// 'mode', so procs must switch on nb_allocator_base_mode(mode), never on
+// 'mode' itself. ZERO and the alignment have to be honored, NO_ZERO is only
+// a hint.
 #define NB_ALLOCATOR_PROC(name) void *name(NB_Allocator_Mode mode, s64 size, s64 old_size, void *old_memory, void *allocator_data)
 
 typedef NB_ALLOCATOR_PROC(NB_Allocator_Proc);
 
+NB_INLINE NB_Allocator_Mode nb_allocator_mode(NB_Allocator_Mode mode, u32 flags) {
+    return (NB_Allocator_Mode)((u32)mode | flags);
+}
+
+// Encodes a power of 2 alignment as mode flags.
+NB_INLINE u32 nb_allocator_align_flag(s64 alignment) {
+    u32 shift = 0;
+    while (((s64)1 << shift) < alignment) shift += 1;
+    return shift << NB_ALLOCATOR_ALIGN_SHIFT;
+}
+
+// Strips the flags, this is what the allocator procs switch on.
+NB_INLINE NB_Allocator_Mode nb_allocator_base_mode(NB_Allocator_Mode mode) {
+    return (NB_Allocator_Mode)((u32)mode & NB_ALLOCATOR_MODE_MASK);
+}
+
+// Requested alignment, 0 when the allocator default is fine.
+NB_INLINE s64 nb_allocator_mode_alignment(NB_Allocator_Mode mode) {
+    u32 shift = ((u32)mode & NB_ALLOCATOR_ALIGN_MASK) >> NB_ALLOCATOR_ALIGN_SHIFT;
+    return shift ? ((s64)1 << shift) : 0;
+}
+
 typedef struct NB_Allocator {
     NB_Allocator_Proc *proc;
     void *data;
 } NB_Allocator;
 
-extern NB_Allocator nb_current_allocator;
+// The bound allocator is per thread, so workers can bind their own
+// arena or pool without locking or clobbering each other.
+extern nb_thread_local NB_Allocator nb_current_allocator;
 
 #if 0
 #define NB_SET_ALLOCATOR(a) do { nb_current_allocator = a; } while (0)
@@ -544,7 +768,47 @@ NB_INLINE NB_Allocator NB_GET_ALLOCATOR(void) {
     return nb_current_allocator;
 }
 
+// Per thread stack of the previously bound allocators.
+
+#ifndef NB_ALLOCATOR_STACK_SIZE
+#define NB_ALLOCATOR_STACK_SIZE 32
+#endif
+
+// Binds 'a', the current allocator is saved on the stack.
+NB_EXTERN void nb_push_allocator(NB_Allocator a);
+
+// Restores the previous allocator, returns the popped one.
+NB_EXTERN NB_Allocator nb_pop_allocator(void);
+
+//
+// Binds an allocator for the following statement or block:
+//     NB_WITH_ALLOCATOR(nb_arena_allocator(&arena)) {
+//         ...
+//     }
+// Do not break/return out of the block, it would skip the pop.
+//
+#define NB_WITH_ALLOCATOR(a) \
+    for (int NB_CONCAT(nb_allocator_scope__, __LINE__) = (nb_push_allocator(a), 0); \
+         !NB_CONCAT(nb_allocator_scope__, __LINE__); \
+         NB_CONCAT(nb_allocator_scope__, __LINE__) = (nb_pop_allocator(), 1))
+
+#if LANGUAGE_CPP
+// Binds an allocator until the end of the enclosing scope, returns included.
+// With NB_ENABLE_DEFERS this is the same as:
+//     nb_push_allocator(a); defer { nb_pop_allocator(); };
+struct NB_Scoped_Allocator {
+    NB_Scoped_Allocator(NB_Allocator a) { nb_push_allocator(a); }
+    ~NB_Scoped_Allocator(void) { nb_pop_allocator(); }
+};
+
+#define NB_SCOPED_ALLOCATOR(a) NB_Scoped_Allocator NB_CONCAT(nb_scoped_allocator__, __LINE__)(a)
+#endif
+
 // Heap allocator.
+
+// What malloc/HeapAlloc guarantee, bigger alignments take the aligned path.
+#define NB_HEAP_DEFAULT_ALIGNMENT ((s64)(2*size_of(void *)))
+
 NB_EXTERN void *
 nb_heap_allocator(NB_Allocator_Mode mode, 
                   s64 size, s64 old_size, 
@@ -556,25 +820,134 @@ nb_heap_allocator(NB_Allocator_Mode mode,
 #define nb_heap_free(mem) nb_heap_allocator(NB_ALLOCATOR_FREE, 0, 0, (mem), null)
 
 
+// Allocator statistics.
+
+typedef struct NB_Allocator_Stats {
+    s64 live_bytes;        // Handed out and not freed yet.
+    s64 peak_bytes;        // Highest live_bytes.
+    s64 allocation_count;  // Successful allocations since the start.
+    s64 failed_count;      // Requests that returned null.
+    s64 reserved_bytes;    // Memory held by the allocator, 0 when unknown.
+
+    // 0 when the free memory is contiguous, close to 1 when it is
+    // scattered in blocks too small for a big request.
+    float fragmentation;
+} NB_Allocator_Stats;
+
+// Zeroes 'stats' and queries the allocator, false when it keeps no statistics.
+NB_EXTERN bool nb_allocator_query_stats(NB_Allocator allocator, NB_Allocator_Stats *stats);
+
+#ifndef NB_ALLOCATOR_REGISTRY_SIZE
+#define NB_ALLOCATOR_REGISTRY_SIZE 64
+#endif
+
+//
+// Registered allocators are listed by nb_allocator_report(), the heap
+// is always registered. The name is not copied.
+// Unregister an allocator before its data goes away.
+//
+NB_EXTERN bool nb_register_allocator(const char *name, NB_Allocator allocator);
+NB_EXTERN void nb_unregister_allocator(NB_Allocator allocator);
+
+// Logs the statistics of every registered allocator. The allocators
+// owned by other threads are read while they may be in use, the
+// numbers are only indicative.
+NB_EXTERN void nb_allocator_report(void);
+
+
+// Allocation call sites, read by the tracking allocator.
+
+typedef struct NB_Allocation_Site {
+    const char *file;
+    s32 line;
+} NB_Allocation_Site;
+
+extern nb_thread_local NB_Allocation_Site nb_allocation_site;
+extern nb_thread_local s32 nb_allocation_site_depth;
+
+NB_INLINE void nb_set_allocation_site(const char *file, s32 line) {
+    // The outermost site wins, so helpers allocating on behalf
+    // of their caller report the caller.
+    if (nb_allocation_site_depth == 0) {
+        nb_allocation_site.file = file;
+        nb_allocation_site.line = line;
+    }
+}
+
+NB_INLINE void nb_push_allocation_site(const char *file, s32 line) {
+    nb_set_allocation_site(file, line);
+    nb_allocation_site_depth += 1;
+}
+
+NB_INLINE void *nb_pop_allocation_site(void *result) {
+    nb_allocation_site_depth -= 1;
+    if (nb_allocation_site_depth == 0) {
+        nb_allocation_site.file = null;
+        nb_allocation_site.line = 0;
+    }
+    return result;
+}
+
+#if NB_TRACK_ALLOCATIONS
+#define NB_ALLOCATION_SITE() nb_set_allocation_site(__FILE__, __LINE__),
+
+// Attributes the allocations done inside 'call' to the caller.
+#define NB_TRACK_CALL(Type, call) \
+    (nb_push_allocation_site(__FILE__, __LINE__), (Type)nb_pop_allocation_site((void *)(call)))
+#else
+#define NB_ALLOCATION_SITE()
+#define NB_TRACK_CALL(Type, call) (call)
+#endif
+
+
 // The new* helpers uses the currently bound allocator (default is nb_heap_allocator).
 
-#define nb_new(Type) (Type *)nb_current_allocator.proc(NB_ALLOCATOR_ALLOCATE, size_of(Type), 0, null, nb_current_allocator.data)
+#define nb_new(Type) (NB_ALLOCATION_SITE() (Type *)nb_current_allocator.proc(NB_ALLOCATOR_ALLOCATE, size_of(Type), 0, null, nb_current_allocator.data))
 
 #ifndef New
 #define New nb_new
 #endif
 
-#define nb_new_array(Type, count) (Type *)nb_current_allocator.proc(NB_ALLOCATOR_ALLOCATE, (count)*size_of(Type), 0, null, nb_current_allocator.data)
+#define nb_new_array(Type, count) (NB_ALLOCATION_SITE() (Type *)nb_current_allocator.proc(NB_ALLOCATOR_ALLOCATE, (count)*size_of(Type), 0, null, nb_current_allocator.data))
+
+#define nb_realloc(m, new_size, old_size) (NB_ALLOCATION_SITE() nb_current_allocator.proc(NB_ALLOCATOR_RESIZE, (new_size), (old_size), (m), nb_current_allocator.data))
+
+#define nb_free(m) (NB_ALLOCATION_SITE() nb_current_allocator.proc(NB_ALLOCATOR_FREE, 0, 0, (m), nb_current_allocator.data))
+
+// Same as above with mode flags (NB_ALLOCATOR_ZERO, NB_ALLOCATOR_NO_ZERO, nb_allocator_align_flag()).
+// Aligned memory must be resized and freed with the same alignment flag.
+
+#define nb_alloc_ex(size, flags) (NB_ALLOCATION_SITE() nb_current_allocator.proc(nb_allocator_mode(NB_ALLOCATOR_ALLOCATE, (flags)), (size), 0, null, nb_current_allocator.data))
+
+#define nb_realloc_ex(m, new_size, old_size, flags) (NB_ALLOCATION_SITE() nb_current_allocator.proc(nb_allocator_mode(NB_ALLOCATOR_RESIZE, (flags)), (new_size), (old_size), (m), nb_current_allocator.data))
 
-#define nb_realloc(m, new_size, old_size) nb_current_allocator.proc(NB_ALLOCATOR_RESIZE, (new_size), (old_size), (m), nb_current_allocator.data)
+#define nb_free_ex(m, flags) (NB_ALLOCATION_SITE() nb_current_allocator.proc(nb_allocator_mode(NB_ALLOCATOR_FREE, (flags)), 0, 0, (m), nb_current_allocator.data))
 
-#define nb_free(m) nb_current_allocator.proc(NB_ALLOCATOR_FREE, 0, 0, (m), nb_current_allocator.data)
+#define nb_new_array_aligned(Type, count, alignment) (Type *)nb_alloc_ex((count)*size_of(Type), nb_allocator_align_flag(alignment))
+#define nb_free_aligned(m, alignment) nb_free_ex((m), nb_allocator_align_flag(alignment))
+
+#define nb_new_array_no_zero(Type, count) (Type *)nb_alloc_ex((count)*size_of(Type), NB_ALLOCATOR_NO_ZERO)
 
 
 
 /******** Temporary Storage ********/
 #define NB_TS_SIZE_DEFAULT NB_KB(40)
 
+//
+// When a request does not fit in the base block, the storage chains
+// an overflow block instead of falling back to the heap.
+// 'occupied' keeps growing across the chain, so marks stay plain offsets.
+//
+// Resetting the storage releases the overflow blocks and grows the base
+// block to the high water mark, so a warmed up frame never allocates.
+//
+
+typedef struct NB_Temporary_Storage_Block {
+    struct NB_Temporary_Storage_Block *previous;
+    s64 size;   // Usable bytes after the header.
+    s64 start;  // Value of 'occupied' when the block was chained.
+} NB_Temporary_Storage_Block;
+
 typedef struct NB_Temporary_Storage {
     s64 size;
     u8 *data;
@@ -582,7 +955,14 @@ typedef struct NB_Temporary_Storage {
     s64 occupied;
     s64 high_water_mark;
 
+    NB_Temporary_Storage_Block *overflow;     // Most recently chained block.
+    NB_Temporary_Storage_Block *free_blocks;  // Released blocks, recycled by nb_talloc.
+
     NB_Allocator allocator;
+
+    s64 peak_bytes;  // Highest high_water_mark across resets.
+    s64 allocation_count;
+    s64 failed_count;
 } NB_Temporary_Storage;
 
 extern nb_thread_local NB_Temporary_Storage nb_temporary_storage;
@@ -591,110 +971,521 @@ extern nb_thread_local NB_Allocator nb_temporary_allocator;
 NB_EXTERN void *nb_talloc(NB_Temporary_Storage *ts, s64 size);
 NB_EXTERN void *nb_talloc_align(NB_Temporary_Storage *ts, s64 size, s64 alignment);
 
+NB_EXTERN void nb_temporary_storage_release_blocks(NB_Temporary_Storage *ts, s64 mark);
+NB_EXTERN void nb_temporary_storage_reset(NB_Temporary_Storage *ts);
+
+// A null allocator_data uses the nb_temporary_storage of the calling thread.
 NB_EXTERN NB_ALLOCATOR_PROC(nb_temporary_storage_proc);
 
 
-/******** String ********/
+/******** Virtual Memory ********/
 
-typedef struct NB_String {
-    s64 count;
-    u8 *data;
-} NB_String;
+// Reserves address space without backing it with physical memory,
+// pages must be committed before being touched.
+NB_EXTERN void *nb_os_reserve(s64 size);
+NB_EXTERN bool  nb_os_commit(void *memory, s64 size);
+NB_EXTERN void  nb_os_decommit(void *memory, s64 size);
+NB_EXTERN void  nb_os_release(void *memory, s64 size);
+NB_EXTERN s64   nb_os_get_page_size(void);
 
-#if LANGUAGE_CPP
-#define S(s) NB_String{size_of(s)-1, (u8 *)(s)}
+//
+// Large pages (2MB on x64) cover 512 times more memory per TLB entry,
+// which pays off on big working sets accessed all over the place.
+// 'size' must be a multiple of nb_os_get_large_page_size().
+//
+// When the OS hands out real large pages (MAP_HUGETLB, MEM_LARGE_PAGES)
+// the whole range comes back committed, and on Windows locked in physical
+// memory, so keep the size close to what is really needed.
+// Otherwise it silently falls back to nb_os_reserve(), advised for
+// transparent huge pages on Linux.
+//
+// 'page_size' receives the page size actually backing the range,
+// 'committed' whether the range can be used without nb_os_commit().
+// Release the range with nb_os_release().
+//
+NB_EXTERN void *nb_os_reserve_large(s64 size, s64 *page_size, bool *committed);
+
+// 0 when large pages are not available.
+NB_EXTERN s64   nb_os_get_large_page_size(void);
+
+
+/******** Arena ********/
+
+//
+// A linear allocator over a reserved virtual range, pages are committed
+// on demand as the arena grows, so reserving a large range is cheap.
+//
+// A zeroed NB_Arena is valid, it reserves NB_ARENA_RESERVE_DEFAULT
+// on the first allocation.
+//
+// Individual frees are ignored, use marks or NB_ALLOCATOR_FREE_ALL
+// to release everything at once.
+//
+// With NB_ARENA_LARGE_PAGES the range is reserved with nb_os_reserve_large(),
+// page_size tells what was obtained. Real large pages come back committed
+// (and locked on Windows), so such an arena needs an explicit reserve size
+// from nb_arena_init_ex(), it is never reserved lazily.
+//
+
+#if ARCH_X64 || ARCH_ARM64
+#define NB_ARENA_RESERVE_DEFAULT NB_GB(1)
 #else
-#define S(s) (NB_String){size_of(s)-1, (u8 *)(s)}
+#define NB_ARENA_RESERVE_DEFAULT NB_MB(64)
 #endif
 
-NB_INLINE NB_String 
-nb_make_string(u8 *data, s64 count) {
-    NB_String result;
-    result.count = count;
-    result.data  = data;
-    return result;
-}
+#define NB_ARENA_COMMIT_SIZE NB_KB(64)
 
+typedef enum NB_Arena_Flags {
+    NB_ARENA_LARGE_PAGES = 0x1,
+} NB_Arena_Flags;
 
+typedef struct NB_Arena {
+    u8 *base;
+    s64 reserved;
+    s64 committed;
 
-/******** Custom Loggers ********/
+    s64 occupied;
+    s64 high_water_mark;
 
-typedef enum NB_Log_Mode {
-    NB_LOG_NONE,
-    NB_LOG_ERROR,
-    NB_LOG_WARNING,
-} NB_Log_Mode;
+    u32 flags;      // NB_Arena_Flags, kept across nb_arena_release().
+    s64 page_size;  // Page size backing the range, set by nb_arena_init().
 
-typedef void NB_Logger_Proc(const char *message, ...) NB_IS_PRINTF_LIKE(1, 2);
+    s64 allocation_count;
+    s64 failed_count;
+} NB_Arena;
 
-extern NB_Logger_Proc *nb_current_logger;
-extern const char *nb_current_logger_ident;
-extern u32 nb_current_logger_mode;
+// Uses the flags already set on the arena.
+NB_EXTERN bool nb_arena_init(NB_Arena *arena, s64 reserve_size);
+NB_EXTERN bool nb_arena_init_ex(NB_Arena *arena, s64 reserve_size, u32 flags);
+NB_EXTERN void nb_arena_release(NB_Arena *arena);
 
-NB_EXTERN const char *nb_logger_push_ident(const char *ident);
-NB_EXTERN u32 nb_logger_push_mode(u32 mode);
+NB_EXTERN void *nb_arena_alloc(NB_Arena *arena, s64 size);
+NB_EXTERN void *nb_arena_alloc_align(NB_Arena *arena, s64 size, s64 alignment);
 
-#if COMPILER_CL
-#define nb_log_print(mode, ident, message, ...) \
-do { \
-    u32 nb_log_old_mode = nb_logger_push_mode(mode); \
-    const char *nb_log_old_ident = nb_logger_push_ident(ident); \
-    nb_log((message), __VA_ARGS__); \
-    nb_logger_push_ident(nb_log_old_ident); \
-    nb_logger_push_mode(nb_log_old_mode); \
-} while (0)
-#else
-#define nb_log_print(mode, ident, message, ...) \
-do { \
-    u32 nb_log_old_mode = nb_logger_push_mode(mode); \
-    const char *nb_log_old_ident = nb_logger_push_ident(ident); \
-    nb_log((message), ##__VA_ARGS__); \
-    nb_logger_push_ident(nb_log_old_ident); \
-    nb_logger_push_mode(nb_log_old_mode); \
-} while (0)
+NB_EXTERN NB_ALLOCATOR_PROC(nb_arena_proc);
+
+NB_INLINE NB_Allocator nb_arena_allocator(NB_Arena *arena) {
+    NB_Allocator result;
+    result.proc = nb_arena_proc;
+    result.data = arena;
+    return result;
+}
+
+
+/******** Frame Storage ********/
+
+//
+// N arenas used in rotation for the data that must outlive the frame
+// it was allocated in (GPU staging, deferred render commands...).
+// nb_frame_advance() moves to the next arena and resets it, so memory
+// allocated during frame N stays valid until frame N + buffer_count - 1.
+//
+// A zeroed NB_Frame_Storage is valid, it uses NB_FRAME_BUFFER_COUNT
+// arenas reserving NB_FRAME_STORAGE_RESERVE_DEFAULT each.
+//
+
+#ifndef NB_FRAME_BUFFER_COUNT
+#define NB_FRAME_BUFFER_COUNT 3
 #endif
 
-#if COMPILER_CL
-#define nb_log(message, ...) nb_current_logger((message), __VA_ARGS__)
+#if ARCH_X64 || ARCH_ARM64
+#define NB_FRAME_STORAGE_RESERVE_DEFAULT NB_MB(256)
 #else
-#define nb_log(message, ...) nb_current_logger((message), ##__VA_ARGS__)
+#define NB_FRAME_STORAGE_RESERVE_DEFAULT NB_MB(16)
 #endif
 
-#ifndef Log
-#define Log nb_log
-#endif
+typedef struct NB_Frame_Storage {
+    NB_Arena arenas[NB_FRAME_BUFFER_COUNT];
 
-#define NB_SET_LOGGER(l) do { nb_current_logger = l; } while (0)
-#define NB_GET_LOGGER() (nb_current_logger)
+    s32 buffer_count;  // 0 means NB_FRAME_BUFFER_COUNT.
+    s32 current;
+    s64 reserve_size;  // Per arena, 0 means the default.
 
-#define NB_GET_LOGGER_MODE()  (nb_current_logger_mode)
-#define NB_GET_LOGGER_IDENT() (nb_current_logger_ident)
+    u64 frame_index;
+} NB_Frame_Storage;
 
-// Cross-platform write string functions.
-void nb_write_string(const char *s, 
-                     bool NB_DEFAULT_VALUE(to_standard_error, false));
-void nb_write_string_count(const char *s, u32 count, 
-                           bool NB_DEFAULT_VALUE(to_standard_error, false));
+extern nb_thread_local NB_Frame_Storage nb_frame_storage;
+extern nb_thread_local NB_Allocator nb_frame_allocator;
 
-void nb_write_new_string(NB_String s, 
-                         bool NB_DEFAULT_VALUE(to_standard_error, false));
+NB_EXTERN void nb_frame_storage_init(NB_Frame_Storage *fs, s32 buffer_count, s64 reserve_size);
+NB_EXTERN void nb_frame_storage_release(NB_Frame_Storage *fs);
 
-NB_EXTERN bool 
-nb_abort_error_message(const char *title, 
-                       const char *message, 
-                       const char *details);
+NB_EXTERN void *nb_frame_storage_alloc(NB_Frame_Storage *fs, s64 size, s64 alignment);
 
-typedef enum NB_System_Console_Text_Color {
-    NB_TEXT_BLACK,
-    NB_TEXT_DARK_BLUE,
-    NB_TEXT_DARK_GREEN,
-    NB_TEXT_LIGHT_BLUE,
-    NB_TEXT_DARK_RED,
-    NB_TEXT_MAGENTA,
-    NB_TEXT_ORANGE,
-    NB_TEXT_LIGHT_GRAY,
-    NB_TEXT_GRAY,
-    NB_TEXT_BLUE,
+// Rotates to the oldest arena and resets it.
+NB_EXTERN void nb_frame_storage_advance(NB_Frame_Storage *fs);
+
+// Allocator data is the NB_Frame_Storage, null means the thread's nb_frame_storage.
+NB_EXTERN NB_ALLOCATOR_PROC(nb_frame_storage_proc);
+
+// The thread's frame storage, call it once per frame.
+NB_EXTERN void nb_frame_advance(void);
+
+NB_EXTERN void *nb_falloc(s64 size);
+
+
+/******** Scratch Arenas ********/
+
+//
+// Thread local arenas for short lived intermediate data, released by
+// rewinding to the mark taken by nb_get_scratch().
+//
+// A function that allocates its result in an arena passed by the caller
+// lists that arena as a conflict, so its own scratch memory never lands
+// in (and never gets rewound under) the caller's data:
+//
+//     NB_Scratch scratch = nb_get_scratch(&result_arena, 1);
+//     ...
+//     nb_release_scratch(scratch);
+//
+
+#ifndef NB_SCRATCH_ARENA_COUNT
+#define NB_SCRATCH_ARENA_COUNT 2
+#endif
+
+typedef struct NB_Scratch {
+    NB_Arena *arena;
+    s64 mark;
+} NB_Scratch;
+
+extern nb_thread_local NB_Arena nb_scratch_arenas[NB_SCRATCH_ARENA_COUNT];
+
+// Returns a scratch arena that is not one of the conflicts.
+NB_EXTERN NB_Scratch nb_get_scratch(NB_Arena **conflicts, s32 conflict_count);
+
+NB_EXTERN void nb_release_scratch(NB_Scratch scratch);
+
+NB_INLINE NB_Allocator nb_scratch_allocator(NB_Scratch scratch) {
+    return nb_arena_allocator(scratch.arena);
+}
+
+
+/******** Pool ********/
+
+//
+// Hands out fixed-size slots carved from slabs, free slots are linked
+// through their own memory so there is no per-allocation header.
+//
+// NB_ALLOCATOR_FREE_ALL keeps the slabs around and starts handing
+// them out again from the first one.
+//
+
+#define NB_POOL_SLOTS_PER_SLAB_DEFAULT 64
+
+typedef struct NB_Pool_Slab {
+    struct NB_Pool_Slab *next;
+} NB_Pool_Slab;
+
+typedef struct NB_Pool {
+    s64 slot_size;
+    s64 alignment;
+    s64 slots_per_slab;
+
+    void *free_list;
+
+    NB_Pool_Slab *slabs;
+    NB_Pool_Slab *current_slab;
+    s64 slab_cursor;  // Next never used slot in the current slab.
+
+    s64 live_count;
+    s64 peak_count;
+    s64 slab_count;
+
+    s64 allocation_count;
+    s64 failed_count;
+
+    NB_Allocator allocator;  // Used for the slabs.
+} NB_Pool;
+
+NB_EXTERN void nb_pool_init(NB_Pool *pool,
+                            s64 slot_size, s64 alignment,
+                            s64 slots_per_slab,
+                            NB_Allocator allocator);
+NB_EXTERN void nb_pool_release(NB_Pool *pool);
+
+NB_EXTERN void *nb_pool_alloc(NB_Pool *pool);
+NB_EXTERN void  nb_pool_free(NB_Pool *pool, void *memory);
+NB_EXTERN void  nb_pool_reset(NB_Pool *pool);
+
+NB_EXTERN NB_ALLOCATOR_PROC(nb_pool_proc);
+
+NB_INLINE NB_Allocator nb_pool_allocator(NB_Pool *pool) {
+    NB_Allocator result;
+    result.proc = nb_pool_proc;
+    result.data = pool;
+    return result;
+}
+
+#define nb_pool_init_type(pool, Type, slots_per_slab, allocator) \
+    nb_pool_init((pool), size_of(Type), 16, (slots_per_slab), (allocator))
+
+
+/******** Tracking Allocator ********/
+
+//
+// Wraps another allocator and records every live allocation with its
+// size and call site (see NB_TRACK_ALLOCATIONS), optionally with the
+// caller stack. Reports live bytes per call site, peak usage and leaks.
+//
+// The bookkeeping tables live on the heap, outside the wrapped allocator.
+// It is not thread safe, bind one tracker per thread.
+//
+
+typedef struct NB_Tracked_Allocation {
+    void *memory;  // null for empty slots.
+    s64 size;
+
+    const char *file;
+    s32 line;
+
+    char *stacktrace;
+} NB_Tracked_Allocation;
+
+typedef struct NB_Allocation_Site_Stats {
+    const char *file;
+    s32 line;
+
+    s64 live_bytes;
+    s64 live_count;
+    s64 peak_bytes;
+    s64 total_count;
+} NB_Allocation_Site_Stats;
+
+typedef struct NB_Tracking_Allocator {
+    NB_Allocator parent;
+
+    NB_Tracked_Allocation *allocations;
+    s64 allocation_count;
+    s64 allocation_capacity;
+
+    NB_Allocation_Site_Stats *sites;
+    s64 site_count;
+    s64 site_capacity;
+
+    s64 live_bytes;
+    s64 peak_bytes;
+    s64 total_count;
+    s64 failed_count;
+
+    bool capture_stacktraces;
+} NB_Tracking_Allocator;
+
+NB_EXTERN void nb_tracking_allocator_init(NB_Tracking_Allocator *tracker,
+                                          NB_Allocator parent,
+                                          bool capture_stacktraces);
+NB_EXTERN void nb_tracking_allocator_release(NB_Tracking_Allocator *tracker);
+
+NB_EXTERN NB_ALLOCATOR_PROC(nb_tracking_allocator_proc);
+
+// Logs the live bytes and peak of every call site.
+NB_EXTERN void nb_tracking_allocator_report(NB_Tracking_Allocator *tracker);
+
+// Logs every allocation that is still alive, returns their count.
+NB_EXTERN s64 nb_tracking_allocator_report_leaks(NB_Tracking_Allocator *tracker);
+
+NB_INLINE NB_Allocator nb_tracking_allocator(NB_Tracking_Allocator *tracker) {
+    NB_Allocator result;
+    result.proc = nb_tracking_allocator_proc;
+    result.data = tracker;
+    return result;
+}
+
+
+/******** TLSF Allocator ********/
+
+//
+// Two-level segregated fit allocator, allocations and frees are O(1)
+// with bounded fragmentation, for the code that cannot afford the
+// worst case latency of the heap.
+//
+// It runs over caller provided regions, or reserves one with
+// nb_tlsf_init_reserve(). Blocks are aligned to NB_TLSF_ALIGN_SIZE,
+// pass an alignment flag (or use nb_tlsf_alloc_align) for more.
+//
+// It is not thread safe.
+//
+
+#if ARCH_X64 || ARCH_ARM64
+#define NB_TLSF_ALIGN_SIZE_LOG2 3
+#define NB_TLSF_FL_INDEX_MAX    32  // Blocks up to 4GB.
+#else
+#define NB_TLSF_ALIGN_SIZE_LOG2 2
+#define NB_TLSF_FL_INDEX_MAX    30
+#endif
+
+#define NB_TLSF_SL_INDEX_COUNT_LOG2 5
+
+#define NB_TLSF_ALIGN_SIZE       (1 << NB_TLSF_ALIGN_SIZE_LOG2)
+#define NB_TLSF_SL_INDEX_COUNT   (1 << NB_TLSF_SL_INDEX_COUNT_LOG2)
+#define NB_TLSF_FL_INDEX_SHIFT   (NB_TLSF_SL_INDEX_COUNT_LOG2 + NB_TLSF_ALIGN_SIZE_LOG2)
+#define NB_TLSF_FL_INDEX_COUNT   (NB_TLSF_FL_INDEX_MAX - NB_TLSF_FL_INDEX_SHIFT + 1)
+#define NB_TLSF_SMALL_BLOCK_SIZE (1 << NB_TLSF_FL_INDEX_SHIFT)
+
+typedef struct NB_TLSF_Block {
+    // Only valid when the previous block is free, it is stored
+    // in the last word of that block.
+    struct NB_TLSF_Block *prev_physical;
+
+    // Payload size, the 2 low bits flag this block and the previous one as free.
+    umm size;
+
+    // Only valid when the block is free, they overlap the payload.
+    struct NB_TLSF_Block *next_free;
+    struct NB_TLSF_Block *prev_free;
+} NB_TLSF_Block;
+
+typedef struct NB_TLSF_Region {
+    struct NB_TLSF_Region *next;
+    s64 size;
+} NB_TLSF_Region;
+
+typedef struct NB_TLSF {
+    u32 fl_bitmap;
+    u32 sl_bitmap[NB_TLSF_FL_INDEX_COUNT];
+    NB_TLSF_Block *blocks[NB_TLSF_FL_INDEX_COUNT][NB_TLSF_SL_INDEX_COUNT];
+
+    NB_TLSF_Region *regions;
+
+    // Set when the region was reserved by nb_tlsf_init_reserve().
+    u8 *reserved_base;
+    s64 reserved_size;
+
+    s64 used_bytes;
+    s64 peak_bytes;
+    s64 allocation_count;
+    s64 failed_count;
+} NB_TLSF;
+
+NB_EXTERN bool nb_tlsf_init(NB_TLSF *tlsf, void *memory, s64 size);
+NB_EXTERN bool nb_tlsf_init_reserve(NB_TLSF *tlsf, s64 size);
+
+// Adds more memory to manage, the region must outlive the allocator.
+NB_EXTERN bool nb_tlsf_add_region(NB_TLSF *tlsf, void *memory, s64 size);
+
+NB_EXTERN void nb_tlsf_release(NB_TLSF *tlsf);
+
+// Frees everything at once.
+NB_EXTERN void nb_tlsf_reset(NB_TLSF *tlsf);
+
+NB_EXTERN void *nb_tlsf_alloc(NB_TLSF *tlsf, s64 size);
+NB_EXTERN void *nb_tlsf_alloc_align(NB_TLSF *tlsf, s64 size, s64 alignment);
+NB_EXTERN void *nb_tlsf_realloc(NB_TLSF *tlsf, void *memory, s64 size);
+NB_EXTERN void  nb_tlsf_free(NB_TLSF *tlsf, void *memory);
+
+// Validates the free lists and the bitmaps, for debugging.
+NB_EXTERN bool nb_tlsf_check(NB_TLSF *tlsf);
+
+NB_EXTERN NB_ALLOCATOR_PROC(nb_tlsf_proc);
+
+NB_INLINE NB_Allocator nb_tlsf_allocator(NB_TLSF *tlsf) {
+    NB_Allocator result;
+    result.proc = nb_tlsf_proc;
+    result.data = tlsf;
+    return result;
+}
+
+
+/******** String ********/
+
+typedef struct NB_String {
+    s64 count;
+    u8 *data;
+} NB_String;
+
+#if LANGUAGE_CPP
+#define S(s) NB_String{size_of(s)-1, (u8 *)(s)}
+#else
+#define S(s) (NB_String){size_of(s)-1, (u8 *)(s)}
+#endif
+
+NB_INLINE NB_String 
+nb_make_string(u8 *data, s64 count) {
+    NB_String result;
+    result.count = count;
+    result.data  = data;
+    return result;
+}
+
+
+
+/******** Custom Loggers ********/
+
+typedef enum NB_Log_Mode {
+    NB_LOG_NONE,
+    NB_LOG_ERROR,
+    NB_LOG_WARNING,
+} NB_Log_Mode;
+
+typedef void NB_Logger_Proc(const char *message, ...) NB_IS_PRINTF_LIKE(1, 2);
+
+extern NB_Logger_Proc *nb_current_logger;
+extern const char *nb_current_logger_ident;
+extern u32 nb_current_logger_mode;
+
+NB_EXTERN const char *nb_logger_push_ident(const char *ident);
+NB_EXTERN u32 nb_logger_push_mode(u32 mode);
+
+#if COMPILER_CL
+#define nb_log_print(mode, ident, message, ...) \
+do { \
+    u32 nb_log_old_mode = nb_logger_push_mode(mode); \
+    const char *nb_log_old_ident = nb_logger_push_ident(ident); \
+    nb_log((message), __VA_ARGS__); \
+    nb_logger_push_ident(nb_log_old_ident); \
+    nb_logger_push_mode(nb_log_old_mode); \
+} while (0)
+#else
+#define nb_log_print(mode, ident, message, ...) \
+do { \
+    u32 nb_log_old_mode = nb_logger_push_mode(mode); \
+    const char *nb_log_old_ident = nb_logger_push_ident(ident); \
+    nb_log((message), ##__VA_ARGS__); \
+    nb_logger_push_ident(nb_log_old_ident); \
+    nb_logger_push_mode(nb_log_old_mode); \
+} while (0)
+#endif
+
+#if COMPILER_CL
+#define nb_log(message, ...) nb_current_logger((message), __VA_ARGS__)
+#else
+#define nb_log(message, ...) nb_current_logger((message), ##__VA_ARGS__)
+#endif
+
+#ifndef Log
+#define Log nb_log
+#endif
+
+#define NB_SET_LOGGER(l) do { nb_current_logger = l; } while (0)
+#define NB_GET_LOGGER() (nb_current_logger)
+
+#define NB_GET_LOGGER_MODE()  (nb_current_logger_mode)
+#define NB_GET_LOGGER_IDENT() (nb_current_logger_ident)
+
+// Cross-platform write string functions.
+void nb_write_string(const char *s, 
+                     bool NB_DEFAULT_VALUE(to_standard_error, false));
+void nb_write_string_count(const char *s, u32 count, 
+                           bool NB_DEFAULT_VALUE(to_standard_error, false));
+
+void nb_write_new_string(NB_String s, 
+                         bool NB_DEFAULT_VALUE(to_standard_error, false));
+
+NB_EXTERN bool 
+nb_abort_error_message(const char *title, 
+                       const char *message, 
+                       const char *details);
+
+typedef enum NB_System_Console_Text_Color {
+    NB_TEXT_BLACK,
+    NB_TEXT_DARK_BLUE,
+    NB_TEXT_DARK_GREEN,
+    NB_TEXT_LIGHT_BLUE,
+    NB_TEXT_DARK_RED,
+    NB_TEXT_MAGENTA,
+    NB_TEXT_ORANGE,
+    NB_TEXT_LIGHT_GRAY,
+    NB_TEXT_GRAY,
+    NB_TEXT_BLUE,
     NB_TEXT_GREEN,
     NB_TEXT_CYAN,
     NB_TEXT_RED,
@@ -723,13 +1514,33 @@ NB_INLINE s64 nb_get_temporary_storage_mark(void) {
 
 NB_INLINE void nb_set_temporary_storage_mark(s64 mark) {
     assert(mark >= 0);
-    assert(mark <= nb_temporary_storage.size);
+    assert(mark <= nb_temporary_storage.occupied);
+
+    if (nb_temporary_storage.overflow) {
+        nb_temporary_storage_release_blocks(&nb_temporary_storage, mark);
+    }
+
     nb_temporary_storage.occupied = mark;
 }
 
 NB_INLINE void nb_reset_temporary_storage(void) {
-    nb_set_temporary_storage_mark(0);
-    nb_temporary_storage.high_water_mark = 0;
+    nb_temporary_storage_reset(&nb_temporary_storage);
+}
+
+
+// Arena helpers.
+NB_INLINE s64 nb_get_arena_mark(NB_Arena *arena) {
+    return arena->occupied;
+}
+
+NB_INLINE void nb_set_arena_mark(NB_Arena *arena, s64 mark) {
+    assert(mark >= 0);
+    assert(mark <= arena->occupied);
+    arena->occupied = mark;
+}
+
+NB_INLINE void nb_reset_arena(NB_Arena *arena) {
+    nb_set_arena_mark(arena, 0);
 }
 
 
@@ -763,6 +1574,12 @@ NB_EXTERN void print(const char *fmt, ...) NB_IS_PRINTF_LIKE(1, 2);
 NB_EXTERN void 
 nb_default_logger(const char *message, ...);
 
+#if NB_TRACK_ALLOCATIONS
+#define mprint(...)       NB_TRACK_CALL(char *, mprint(__VA_ARGS__))
+#define mprint_guess(...) NB_TRACK_CALL(char *, mprint_guess(__VA_ARGS__))
+#define mprint_valist(fmt, arg_list) NB_TRACK_CALL(char *, mprint_valist((fmt), (arg_list)))
+#endif
+
 
 
 NB_INLINE u32 nb_safe_truncate_u64(u64 value) {
@@ -773,1087 +1590,7143 @@ NB_INLINE u32 nb_safe_truncate_u64(u64 value) {
 
 
 
-/******** Quick Sort ********/
-NB_EXTERN void nb_qsort(void *data, s64 count, s64 stride, s64 (*qsort_compare)(void *, void *));
-NB_EXTERN void nb_qsort_it(void *data, s64 count, s64 stride, s64 (*qsort_compare)(void *, void *));
+/******** Dynamic Array ********/
 
+//
+// A stretchy buffer, the array is a plain T * with a header stored right
+// before the first element, so it indexes like any C array:
+//
+//     s32 *values = null;
+//     nb_array_init(values, nb_arena_allocator(&arena), 16);
+//     nb_array_push(values, 42);
+//     for (s64 index = 0; index < nb_array_length(values); ++index) values[index]...
+//     nb_array_free(values);
+//
+// The memory comes from the allocator given to nb_array_init(), a null
+// array binds nb_current_allocator on its first growth instead.
+// The capacity is multiplied by growth_factor when the array is full.
+// Arrays in the temporary storage go away with it, do not free them.
+//
+// The macros evaluate 'a' more than once, and may move the elements,
+// do not keep pointers into the array across a push or a reserve.
+// Growing functions return false when the allocator is out of memory,
+// the array is left untouched.
+//
+// nb_array_count() is the element count of a fixed size C array,
+// nb_array_length() is the one for dynamic arrays.
+//
 
+#ifndef NB_ARRAY_GROWTH_FACTOR
+#define NB_ARRAY_GROWTH_FACTOR 2.0f
+#endif
 
-/******** Utility functions ********/
+#define NB_ARRAY_CAPACITY_MIN 4
 
-NB_INLINE u16 nb_swap2(u16 mem) {
-    u16 a = mem >> 8;
-    u16 b = (mem & 0xFF) << 8;
-    
-    u16 result = a | b;
-    return result;
-}
+// The elements are aligned to NB_ARRAY_ALIGNMENT.
+#define NB_ARRAY_ALIGNMENT 16
 
-NB_INLINE u32 nb_swap4(u32 mem) {
-    u32 a = (mem >> 24);
-    u32 b = (mem >> 16) & 0xFF;
-    u32 c = (mem >>  8) & 0xFF;
-    u32 d = (mem) & 0xFF;
-    
-    u32 result = (d << 24) | (c << 16) | (b << 8) | a;
-    return result;
-}
+typedef struct NB_Array_Header {
+    s64 count;
+    s64 capacity;
+    float growth_factor;
 
-NB_INLINE u32 nb_find_least_significant_set_bit(u32 value) {
-#if COMPILER_CL
-    unsigned long result = 0;
-    _BitScanForward(&result, value);
-    return (u32)result;
-#elif COMPILER_GCC
-    return (u32)__builtin_ctz(value);
-#else
-    for (u32 test = 0; test < 32; ++test) {
-        if (value & (1 << test)) {
-            return test;
-        }
-    }
+    NB_Allocator allocator;
+} NB_Array_Header;
 
-    return 0;
-#endif
-}
+#define NB_ARRAY_HEADER_SIZE nb_align_forward((s64)size_of(NB_Array_Header), NB_ARRAY_ALIGNMENT)
 
-NB_INLINE void 
-nb_swap_two_memory_blocks(u8 *a_, u8 *b_, s64 count) {
-    u8 *a = a_;
-    u8 *b = b_;
+#if LANGUAGE_CPP
+#define NB_ARRAY_CAST(a) (decltype(a))
+#else
+#define NB_ARRAY_CAST(a)
+#endif
 
-    while (count--) {
-        u8 temp = *a;
-        *a++    = *b;
-        *b++    = temp;
-    }
-}
+// Returns the array with room for 'capacity' elements, the same array
+// when it already has it or when the allocation fails.
+NB_EXTERN void *nb_array_grow(void *array, s64 element_size, s64 capacity, NB_Allocator allocator);
+NB_EXTERN void  nb_array_free_memory(void *array);
+NB_EXTERN void  nb_array_remove_ordered_at(void *array, s64 element_size, s64 index);
 
-#define nb_get_clamped(v, l, h) (((v) < (l)) ? (l) : (((v) > (h)) ? (h) : (v)))
+#define nb_array_header(a)   ((NB_Array_Header *)((u8 *)(a) - NB_ARRAY_HEADER_SIZE))
+#define nb_array_length(a)   ((a) ? nb_array_header(a)->count : 0)
+#define nb_array_capacity(a) ((a) ? nb_array_header(a)->capacity : 0)
 
-#if LANGUAGE_CPP
-NB_INLINE void nb_clamp(int *pointer, int low, int high) {
-    if (*pointer < low) { *pointer = low; }
-    if (*pointer > high) { *pointer = high; }
+// A function, so the macros can be used as statements without warnings.
+NB_INLINE bool nb_array_has_room(void *array, s64 capacity) {
+    return array && (nb_array_header(array)->capacity >= capacity);
 }
 
-NB_INLINE void nb_clamp(float *pointer, float low, float high) {
-    if (*pointer < low) { *pointer = low; }
-    if (*pointer > high) { *pointer = high; }
-}
-#endif
+#define nb_array_init(a, allocator, capacity) \
+    ((a) = NB_ARRAY_CAST(a)nb_array_grow(null, size_of(*(a)), (capacity), (allocator)), \
+     nb_array_has_room((a), 0))
 
-#ifndef Clamp
-#define Clamp nb_clamp
-#endif
+#define nb_array_reserve(a, capacity) \
+    (nb_array_has_room((a), (capacity)) ? true : \
+     ((a) = NB_ARRAY_CAST(a)nb_array_grow((a), size_of(*(a)), (capacity), nb_current_allocator), \
+      nb_array_has_room((a), (capacity))))
 
-NB_INLINE NB_OS_Type nb_get_current_os(void) {
-    NB_OS_Type result = NB_OS_NONE;
-#if OS_WINDOWS
-    result = NB_OS_WINDOWS;
-#elif OS_LINUX
-    result = NB_OS_LINUX;
-#elif OS_MAC
-    result = NB_OS_MAC;
-#endif
+// The array must not be null.
+#define nb_array_set_growth_factor(a, factor) (nb_array_header(a)->growth_factor = (factor))
 
-    return result;
-}
+// Returns false when the array could not grow.
+#define nb_array_push(a, value) \
+    (nb_array_reserve(a, nb_array_length(a) + 1) ? \
+     ((a)[nb_array_header(a)->count++] = (value), true) : false)
 
-NB_INLINE NB_Arch_Type nb_get_current_arch(void) {
-    NB_Arch_Type result = NB_ARCH_NONE;
-#if ARCH_X64
-    result = NB_ARCH_X64;
-#elif ARCH_X86
-    result = NB_ARCH_X86;
-#elif ARCH_ARM
-    result = NB_ARCH_ARM;
-#elif ARCH_ARM64
-    result = NB_ARCH_ARM64;
-#endif
+// Appends 'n' uninitialized elements, returns the first one or null.
+#define nb_array_add(a, n) \
+    (nb_array_reserve(a, nb_array_length(a) + (n)) ? \
+     (nb_array_header(a)->count += (n), (a) + nb_array_header(a)->count - (n)) : null)
 
-    return result;
-}
+#define nb_array_pop(a)  ((a)[--nb_array_header(a)->count])
+#define nb_array_last(a) ((a)[nb_array_header(a)->count - 1])
 
-NB_INLINE const char *nb_os_to_string(NB_OS_Type os) {
-    const char *result = null;
-    switch (os) {
-        case NB_OS_WINDOWS:
-            result = "Windows";
-            break;
+// O(1), the last element takes the place of the removed one.
+#define nb_array_remove_unordered(a, index) \
+    ((a)[(index)] = (a)[--nb_array_header(a)->count])
 
-        case NB_OS_LINUX:
-            result = "Linux";
-            break;
+// O(n), keeps the order.
+#define nb_array_remove_ordered(a, index) \
+    nb_array_remove_ordered_at((a), size_of(*(a)), (index))
 
-        case NB_OS_MAC:
-            result = "Mac";
-            break;
+// Empties the array and keeps its capacity.
+#define nb_array_reset(a) ((a) ? (nb_array_header(a)->count = 0) : 0)
 
-        default: break;
+#define nb_array_free(a) (nb_array_free_memory(a), (a) = null)
+
+#if LANGUAGE_CPP
+//
+// Typed wrapper, it owns nothing by itself: copies share the same
+// elements and release() must be called explicitly, as with the C API.
+//
+template<typename T>
+struct NB_Array {
+    T *items = null;
+
+    bool init(NB_Allocator allocator, s64 capacity = 0) {
+        nb_array_free(items);
+        return nb_array_init(items, allocator, capacity);
     }
 
-    return result;
-}
+    void release(void) { nb_array_free(items); }
 
-NB_INLINE const char *nb_arch_to_string(NB_Arch_Type arch) {
-    const char *result = null;
-    switch (arch) {
-        case NB_ARCH_X64:
-            result = "X64";
-            break;
+    bool reserve(s64 capacity) { return nb_array_reserve(items, capacity); }
+    bool push(const T &value)  { return nb_array_push(items, value); }
+    T   *add(s64 n = 1)        { return nb_array_add(items, n); }
 
-        case NB_ARCH_X86:
-            result = "X86";
-            break;
+    T    pop(void)  { assert(count() > 0); return nb_array_pop(items); }
+    T   &last(void) { assert(count() > 0); return nb_array_last(items); }
 
-        case NB_ARCH_ARM:
-            result = "ARM";
-            break;
+    void remove_unordered(s64 index) { assert((index >= 0) && (index < count())); nb_array_remove_unordered(items, index); }
+    void remove_ordered(s64 index)   { assert((index >= 0) && (index < count())); nb_array_remove_ordered(items, index); }
 
-        case NB_ARCH_ARM64:
-            result = "ARM64";
-            break;
+    void reset(void) { nb_array_reset(items); }
 
-        default: break;
-    }
+    void set_growth_factor(float factor) { assert(items); nb_array_set_growth_factor(items, factor); }
 
-    return result;
-}
+    s64 count(void) const    { return nb_array_length(items); }
+    s64 capacity(void) const { return nb_array_capacity(items); }
 
-NB_INLINE void nb_panic(void) {
-    nb_write_new_string(S("Panic.\n"), true);
-#if NB_DEBUG
-    nb_debug_break();
-#else
-    // nb_abort();
+    T       &operator[](s64 index)       { assert((index >= 0) && (index < count())); return items[index]; }
+    const T &operator[](s64 index) const { assert((index >= 0) && (index < count())); return items[index]; }
+
+    T *begin(void) const { return items; }
+    T *end(void) const   { return items + count(); }
+};
 #endif
-}
 
-// Ratio helpers.
 
-NB_INLINE float nb_safe_ratio_0(float n, float d) {
-    float result = 0;
+/******** Hash Map ********/
 
-    if (d != 0) {
-        result = n/d;
-    }
+//
+// Open addressing hash map in the style of SwissTable: a control byte per
+// slot holds 7 bits of the hash (or NB_HASH_MAP_EMPTY), and a probe
+// compares a whole group of control bytes at once, with SSE2 when the
+// target has it and 8 bytes at a time in a u64 otherwise.
+//
+// Probing is linear from the home slot of the key, so a removal shifts
+// the following entries back instead of leaving a tombstone, and the
+// table never degrades with churn.
+//
+//     NB_Hash_Map textures;
+//     nb_hash_map_init_type(&textures, NB_HASH_MAP_KEY_STRING, u32, 0, nb_current_allocator);
+//     *(u32 *)nb_hash_map_put_string(&textures, S("grass")) = texture_id;
+//     u32 *found = (u32 *)nb_hash_map_find_string(&textures, S("grass"));
+//     nb_hash_map_release(&textures);
+//
+// The map does not copy string keys, their bytes must outlive the entry.
+// Value pointers are invalidated by any put or remove.
+//
 
-    return result;
-}
+#ifndef NB_HASH_MAP_SSE2
+    #if ARCH_X64 || (ARCH_X86 && (defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))))
+        #define NB_HASH_MAP_SSE2 1
+    #else
+        #define NB_HASH_MAP_SSE2 0
+    #endif
+#endif
 
-NB_INLINE float nb_safe_ratio_1(float n, float d) {
-    float result = 1;
+#if NB_HASH_MAP_SSE2
+#define NB_HASH_MAP_GROUP_WIDTH 16
+#else
+#define NB_HASH_MAP_GROUP_WIDTH 8
+#endif
 
-    if (d != 0) {
-        result = n/d;
-    }
+#define NB_HASH_MAP_EMPTY 0x80
+#define NB_HASH_MAP_CAPACITY_MIN 16
 
-    return result;
-}
+// The map grows when it is 7/8 full.
+#define NB_HASH_MAP_LOAD_NUMERATOR   7
+#define NB_HASH_MAP_LOAD_DENOMINATOR 8
 
-NB_INLINE float nb_safe_ratio_n(float a, float b, float n) {
-    float result = n;
+typedef enum NB_Hash_Map_Key {
+    NB_HASH_MAP_KEY_U64,
+    NB_HASH_MAP_KEY_STRING,
+} NB_Hash_Map_Key;
 
-    if (b != 0) {
-        result = a/b;
-    }
+typedef struct NB_Hash_Map {
+    u8 *control;        // capacity + NB_HASH_MAP_GROUP_WIDTH - 1 bytes, the tail mirrors the head.
+    u8 *slots;          // capacity * slot_size bytes, key then value.
 
-    return result;
-}
+    s64 count;
+    s64 capacity;       // Power of 2.
+    s64 growth_left;    // Insertions left before the map grows.
 
-// String helpers.
+    s32 slot_size;
+    s32 value_offset;
+    s64 value_size;
 
-NB_INLINE bool nb_strings_are_equal(NB_String a, NB_String b) {
-    if (a.count != b.count) return false;
+    NB_Hash_Map_Key key_kind;
+    NB_Allocator allocator;
+} NB_Hash_Map;
 
-    for (s64 index = 0; index < a.count; ++index) {
-        if (a.data[index] != b.data[index]) {
-            return false;
-        }
-    }
+NB_EXTERN u64 nb_hash_u64(u64 value);
+NB_EXTERN u64 nb_hash_bytes(void *data, s64 count, u64 seed);
 
-    return true;
+NB_INLINE u64 nb_hash_string(NB_String s) {
+    return nb_hash_bytes(s.data, s.count, 0);
 }
 
-NB_INLINE bool nb_cstrings_are_equal(char *a, char *b) {
-    bool result = (a == b);
+// A null allocator proc binds nb_current_allocator. The capacity is a hint,
+// the first put allocates the table when it is 0.
+NB_EXTERN void nb_hash_map_init(NB_Hash_Map *map, NB_Hash_Map_Key key_kind, s64 value_size, s64 capacity, NB_Allocator allocator);
+NB_EXTERN void nb_hash_map_release(NB_Hash_Map *map);
 
-    if (a && b) {
-        while (*a && *b && (*a == *b)) {
-            ++a;
-            ++b;
-        }
+// Removes every entry and keeps the table.
+NB_EXTERN void nb_hash_map_reset(NB_Hash_Map *map);
+NB_EXTERN bool nb_hash_map_reserve(NB_Hash_Map *map, s64 count);
 
-        result = ((*a == 0) && (*b == 0));
-    }
+// Put returns the value of the key, a new entry has a zeroed value.
+// It returns null when the table could not grow.
+NB_EXTERN void *nb_hash_map_find_u64(NB_Hash_Map *map, u64 key);
+NB_EXTERN void *nb_hash_map_put_u64(NB_Hash_Map *map, u64 key);
+NB_EXTERN bool  nb_hash_map_remove_u64(NB_Hash_Map *map, u64 key);
 
-    return result;
-}
+NB_EXTERN void *nb_hash_map_find_string(NB_Hash_Map *map, NB_String key);
+NB_EXTERN void *nb_hash_map_put_string(NB_Hash_Map *map, NB_String key);
+NB_EXTERN bool  nb_hash_map_remove_string(NB_Hash_Map *map, NB_String key);
 
-NB_INLINE bool 
-nb_strings_are_equal_length(s64 length_a, char *a, s64 length_b, char *b) {
-    if (length_a != length_b) return false;
+//
+// Walks the entries in table order, 'key' points to a u64 or an NB_String:
+//
+//     s64 cursor = 0;
+//     void *key, *value;
+//     while (nb_hash_map_next(&map, &cursor, &key, &value)) ...
+//
+NB_EXTERN bool nb_hash_map_next(NB_Hash_Map *map, s64 *cursor, void **key, void **value);
 
-    for (s64 index = 0; index < length_a; ++index) {
-        if (a[index] != b[index]) return false;
-    }
+#define nb_hash_map_init_type(map, key_kind, Type, capacity, allocator) \
+    nb_hash_map_init((map), (key_kind), size_of(Type), (capacity), (allocator))
 
-    return true;
-}
+/******** String Interner ********/
 
-NB_INLINE bool 
-nb_strings_are_equal_first_length(s64 length_a, char *a, char *b) {
-    char *it = b;
-    for (s64 index = 0; index < length_a; ++index, ++it) {
-        if ((*it == 0) || (a[index] != *it)) {
-            return false;
-        }
-    }
+//
+// Maps a string to a small stable id, so names compare as integers and
+// fit in a u32 wherever they are stored:
+//
+//     NB_Interner names = {0};
+//     u32 id = nb_intern(&names, S("grass"));
+//     NB_String name = nb_interner_get(&names, id);
+//
+// A zeroed NB_Interner is valid. Id 0 is always the empty string, so a
+// zeroed name field reads as "".
+//
+// The bytes are copied once into the interner arena and stay put until
+// nb_interner_release(), the strings returned are null terminated.
+// Lookups and nb_interner_get() do not lock, inserting a new string takes
+// a spin lock, so any thread can intern.
+//
 
-    bool result = (*it == 0);
-    return result;
-}
+#define NB_INTERNER_FIRST_CHUNK_SIZE 256
+#define NB_INTERNER_CHUNK_COUNT      24
+#define NB_INTERNER_TABLE_SIZE_MIN   512
 
-NB_INLINE bool nb_is_end_of_line(int c) {
-    bool result = ((c == '\n') || (c == '\r'));
-    return result;
-}
+typedef struct NB_Interner_Entry {
+    u8 *data;
+    u32 count;
+    u32 hash;
+} NB_Interner_Entry;
 
-NB_INLINE bool nb_is_white_space(int c) {
-    bool result = ((c == ' ')  || 
-                   (c == '\t') ||
-                   (c == '\v') || 
-                   (c == '\f') || 
-                   (c == '\n') ||
-                   (c == '\r'));
+typedef struct NB_Interner_Table {
+    s64 capacity;         // Power of 2.
+    volatile s32 *ids;    // 0 is an empty slot, the empty string is never stored.
+} NB_Interner_Table;
 
-    return result;
-}
+typedef struct NB_Interner {
+    NB_Arena arena;       // Bytes, entries and tables, old tables stay valid for readers.
 
-NB_INLINE bool nb_is_digit(int c) {
-    bool result = (c >= '0') && (c <= '9');
-    return result;
-}
+    // Chunk k holds NB_INTERNER_FIRST_CHUNK_SIZE << k entries, they never move.
+    NB_Interner_Entry *chunks[NB_INTERNER_CHUNK_COUNT];
+    NB_Interner_Table *volatile table;
 
-NB_INLINE s64 nb_string_length(const char *s) {
-    if (!s) return 0;
+    volatile s32 count;   // Ids handed out, the empty string included.
+    volatile s32 lock;
+} NB_Interner;
 
-    const char *it = s;
-    while (*it++);
+NB_EXTERN void nb_interner_release(NB_Interner *interner);
 
-    return (s64)(it-1 - s);
-}
+NB_EXTERN u32  nb_intern(NB_Interner *interner, NB_String s);
+NB_EXTERN u32  nb_intern_cstring(NB_Interner *interner, const char *s);
 
-NB_INLINE char *nb_eat_spaces(char *s) {
-    char *it = s;
-    while (*it == ' ') {
-        it++;
-    }
+// Looks the string up without adding it.
+NB_EXTERN bool nb_interner_find(NB_Interner *interner, NB_String s, u32 *id);
+NB_EXTERN NB_String nb_interner_get(NB_Interner *interner, u32 id);
 
-    return it;
-}
 
-NB_INLINE char *nb_get_extension(char *s) {
-    char *result = null;
+/******** Handle Pool ********/
 
-    char *it = s;
-    while (*it) {
-        if (*it == '.') result = it;
+//
+// Items addressed by generational u32 handles: the low NB_HANDLE_INDEX_BITS
+// pick a slot, the high bits count how many times the slot was reused,
+// so a handle to a removed item is detected in O(1) instead of reaching
+// whatever took its place.
+//
+//     NB_Handle_Pool textures;
+//     nb_handle_pool_init_type(&textures, Texture, 64, nb_current_allocator);
+//     Texture *texture;
+//     u32 handle = nb_handle_pool_add(&textures, (void **)&texture);
+//     texture = (Texture *)nb_handle_pool_get(&textures, handle);  // null once removed.
+//
+// The items stay packed in 'items', a removal moves the last item in the
+// hole, so walking 0..count-1 touches live items only. Freed slots are
+// reused in FIFO order, which spreads the generations and delays their
+// wrap around. Item pointers are invalidated by any add or remove.
+//
+// 0 and (u32)-1 are never valid handles.
+//
 
-        it++;
-    }
+#define NB_HANDLE_INDEX_BITS      20
+#define NB_HANDLE_INDEX_MASK      ((1u << NB_HANDLE_INDEX_BITS) - 1)
+#define NB_HANDLE_GENERATION_MASK ((1u << (32 - NB_HANDLE_INDEX_BITS)) - 1)
 
-    return result;
-}
+// The all ones index marks the end of the free list.
+#define NB_HANDLE_CAPACITY_MAX    NB_HANDLE_INDEX_MASK
+#define NB_HANDLE_NONE            0
 
-NB_INLINE char *
-nb_find_character_from_right(char *s, u8 c) {
-    s64 length = nb_string_length(s);
+#define nb_handle_index(handle)      ((handle) & NB_HANDLE_INDEX_MASK)
+#define nb_handle_generation(handle) ((handle) >> NB_HANDLE_INDEX_BITS)
 
-    for (s64 i = length - 1; i >= 0; --i) {
-        if (s[i] == c) {
-            return s + i;
-        }
-    }
+typedef struct NB_Handle_Slot {
+    u32 generation;   // Starts at 1, so no handle is 0.
+    u32 dense_index;  // Item of a live slot, next free slot otherwise.
+} NB_Handle_Slot;
 
-    return null;
-}
+typedef struct NB_Handle_Pool {
+    u8  *items;        // count * item_size bytes.
+    u32 *item_handles; // Handle of each item.
+    NB_Handle_Slot *slots;
 
-NB_INLINE char *nb_path_cleanup(char *s) {
-    char *it = s;
-    while (*it) {
-        if (*it == '\\') *it = '/';
+    s64 item_size;
+    u32 count;
+    u32 slot_count;    // Slots handed out at least once.
+    u32 capacity;
 
-        it++;
-    }
+    u32 free_head;
+    u32 free_tail;
 
-    return s;
-}
+    NB_Allocator allocator;
+} NB_Handle_Pool;
 
-NB_INLINE void nb_advance(NB_String *s, s64 amount) {
-    s->data  += amount;
-    s->count -= amount;
-}
+// A null allocator proc binds nb_current_allocator.
+NB_EXTERN void nb_handle_pool_init(NB_Handle_Pool *pool, s64 item_size, s64 capacity, NB_Allocator allocator);
+NB_EXTERN void nb_handle_pool_release(NB_Handle_Pool *pool);
 
-#endif  // NB_INCLUDE_GENERAL_H
+// Returns NB_HANDLE_NONE when the pool is full or out of memory,
+// the new item is zeroed.
+NB_EXTERN u32  nb_handle_pool_add(NB_Handle_Pool *pool, void **item);
+NB_EXTERN bool nb_handle_pool_remove(NB_Handle_Pool *pool, u32 handle);
 
+// Removes every item, the outstanding handles become stale.
+NB_EXTERN void nb_handle_pool_reset(NB_Handle_Pool *pool);
 
+NB_INLINE void *
+nb_handle_pool_get(NB_Handle_Pool *pool, u32 handle) {
+    u32 index = nb_handle_index(handle);
+    if (index >= pool->slot_count) return null;
 
+    NB_Handle_Slot *slot = pool->slots + index;
+    if (slot->generation != nb_handle_generation(handle)) return null;
 
+    return pool->items + (s64)slot->dense_index * pool->item_size;
+}
 
+#define nb_handle_pool_init_type(pool, Type, capacity, allocator) \
+    nb_handle_pool_init((pool), size_of(Type), (capacity), (allocator))
 
+// Item at a packed index, for iteration.
+#define nb_handle_pool_item(pool, index) ((void *)((pool)->items + (s64)(index) * (pool)->item_size))
 
 
+/******** Bucket Array ********/
 
+//
+// Items live in fixed buckets of NB_BUCKET_ARRAY_BUCKET_SIZE that are never
+// moved or freed before nb_bucket_array_release(), so a pointer to an item
+// stays valid as the array grows, and appending never copies anything:
+//
+//     NB_Bucket_Array entities;
+//     nb_bucket_array_init_type(&entities, Entity, nb_current_allocator);
+//     s64 id;
+//     Entity *entity = (Entity *)nb_bucket_array_add(&entities, &id);
+//     ...
+//     s64 cursor = 0;
+//     while (nb_bucket_array_next(&entities, &cursor, (void **)&entity)) ...
+//
+// Each bucket has a u64 occupancy bitmap, removed slots are refilled by
+// later adds and iteration skips the empty ones 64 at a time.
+// The index of an item is stable as well, it is bucket * 64 + slot.
+//
 
+#define NB_BUCKET_ARRAY_BUCKET_SIZE 64  // One bit per item in a u64.
+#define NB_BUCKET_ARRAY_ALIGNMENT   16
 
+typedef struct NB_Bucket {
+    u64 occupied;
+} NB_Bucket;
 
+#define NB_BUCKET_HEADER_SIZE nb_align_forward((s64)size_of(NB_Bucket), NB_BUCKET_ARRAY_ALIGNMENT)
 
-/******** General Implementation ********/
+typedef struct NB_Bucket_Array {
+    NB_Bucket **buckets;   // nb_array, the table moves, the buckets do not.
+    s64 *unfull_buckets;   // nb_array, every bucket with a free slot, once.
 
-#ifdef NB_IMPLEMENTATION
+    s64 item_size;
+    s64 count;
+
+    NB_Allocator allocator;
+} NB_Bucket_Array;
+
+// A null allocator proc binds nb_current_allocator.
+NB_EXTERN void nb_bucket_array_init(NB_Bucket_Array *array, s64 item_size, NB_Allocator allocator);
+NB_EXTERN void nb_bucket_array_release(NB_Bucket_Array *array);
+
+// Returns a zeroed item, or null when out of memory. 'index' is optional.
+NB_EXTERN void *nb_bucket_array_add(NB_Bucket_Array *array, s64 *index);
+NB_EXTERN bool  nb_bucket_array_remove(NB_Bucket_Array *array, s64 index);
+
+// Walks the items in index order, start with a zeroed cursor.
+NB_EXTERN bool  nb_bucket_array_next(NB_Bucket_Array *array, s64 *cursor, void **item);
+
+// Null when no item lives at that index.
+NB_INLINE void *
+nb_bucket_array_get(NB_Bucket_Array *array, s64 index) {
+    s64 bucket_index = index / NB_BUCKET_ARRAY_BUCKET_SIZE;
+    s64 slot         = index % NB_BUCKET_ARRAY_BUCKET_SIZE;
+    if ((index < 0) || (bucket_index >= nb_array_length(array->buckets))) return null;
+
+    NB_Bucket *bucket = array->buckets[bucket_index];
+    if (!(bucket->occupied & (1ull << slot))) return null;
+
+    return (u8 *)bucket + NB_BUCKET_HEADER_SIZE + slot * array->item_size;
+}
+
+#define nb_bucket_array_init_type(array, Type, allocator) \
+    nb_bucket_array_init((array), size_of(Type), (allocator))
+
+
+/******** Ring Buffers ********/
+
+//
+// Bounded lock-free queues of fixed size items, copied in and out:
+//
+// NB_SPSC_Ring has one producer and one consumer thread. Each side keeps
+// a cached copy of the other side index and only reads the shared one
+// when the cache says the ring is full (or empty), so a batch costs one
+// acquire load and one release store.
+//
+// NB_MPMC_Ring takes any number of producers and consumers. Every cell
+// has a sequence number telling which lap it is ready for (D. Vyukov's
+// bounded queue). A batch claims its whole run of cells with one
+// compare exchange.
+//
+// The push and pop functions move up to 'count' items and return how
+// many moved, 0 when the ring is full (or empty). The capacity is
+// rounded up to a power of 2.
+//
+//     NB_MPMC_Ring jobs;
+//     nb_mpmc_ring_init_type(&jobs, Job, 1024, nb_current_allocator);
+//     nb_mpmc_ring_push(&jobs, &job, 1);           // Any thread.
+//     while (nb_mpmc_ring_pop(&jobs, &job, 1)) ... // Any thread.
+//
+// The indices written by different threads sit on separate cache lines.
+//
+
+#ifndef NB_CACHE_LINE_SIZE
+#define NB_CACHE_LINE_SIZE 64
+#endif
+
+typedef struct NB_SPSC_Ring {
+    u8 *items;
+    s64 item_size;
+    s64 capacity;
+    NB_Allocator allocator;
+
+    u8 pad0[NB_CACHE_LINE_SIZE];
+
+    volatile s64 tail;      // Written by the producer.
+    s64 cached_head;        // Producer only.
+
+    u8 pad1[NB_CACHE_LINE_SIZE];
+
+    volatile s64 head;      // Written by the consumer.
+    s64 cached_tail;        // Consumer only.
+
+    u8 pad2[NB_CACHE_LINE_SIZE];
+} NB_SPSC_Ring;
+
+typedef struct NB_MPMC_Ring {
+    u8 *items;
+    volatile s64 *sequences;
+    s64 item_size;
+    s64 capacity;
+    NB_Allocator allocator;
+
+    u8 pad0[NB_CACHE_LINE_SIZE];
+
+    volatile s64 enqueue_position;
+
+    u8 pad1[NB_CACHE_LINE_SIZE];
+
+    volatile s64 dequeue_position;
+
+    u8 pad2[NB_CACHE_LINE_SIZE];
+} NB_MPMC_Ring;
+
+// A null allocator proc binds nb_current_allocator.
+NB_EXTERN bool nb_spsc_ring_init(NB_SPSC_Ring *ring, s64 item_size, s64 capacity, NB_Allocator allocator);
+NB_EXTERN void nb_spsc_ring_release(NB_SPSC_Ring *ring);
+NB_EXTERN s64  nb_spsc_ring_push(NB_SPSC_Ring *ring, void *items, s64 count);
+NB_EXTERN s64  nb_spsc_ring_pop(NB_SPSC_Ring *ring, void *items, s64 count);
+
+NB_EXTERN bool nb_mpmc_ring_init(NB_MPMC_Ring *ring, s64 item_size, s64 capacity, NB_Allocator allocator);
+NB_EXTERN void nb_mpmc_ring_release(NB_MPMC_Ring *ring);
+NB_EXTERN s64  nb_mpmc_ring_push(NB_MPMC_Ring *ring, void *items, s64 count);
+NB_EXTERN s64  nb_mpmc_ring_pop(NB_MPMC_Ring *ring, void *items, s64 count);
+
+#define nb_spsc_ring_init_type(ring, Type, capacity, allocator) \
+    nb_spsc_ring_init((ring), size_of(Type), (capacity), (allocator))
+
+#define nb_mpmc_ring_init_type(ring, Type, capacity, allocator) \
+    nb_mpmc_ring_init((ring), size_of(Type), (capacity), (allocator))
+
+
+/******** Small Buffers ********/
+
+//
+// A string and an array that keep their first bytes inline and only go to
+// the allocator once they outgrow them, so the short lived ones (a log
+// line, a path, a handful of ids) never allocate:
+//
+//     NB_Small_String path;
+//     nb_small_string_init(&path, nb_current_allocator);
+//     nb_small_string_print(&path, "%s/%s.hlsl", directory, name);
+//     fopen(nb_small_string_cstring(&path), "r");
+//     nb_small_string_release(&path);
+//
+// A zeroed NB_Small_String is valid and binds nb_current_allocator when it
+// first grows. Neither type points into itself, so both can be copied or
+// moved around while inline, copies share the heap buffer after that.
+// Inline array items are 8 bytes aligned.
+//
+
+#ifndef NB_SMALL_STRING_INLINE_SIZE
+#define NB_SMALL_STRING_INLINE_SIZE 64
+#endif
+
+#ifndef NB_SMALL_ARRAY_INLINE_SIZE
+#define NB_SMALL_ARRAY_INLINE_SIZE 128
+#endif
+
+typedef struct NB_Small_String {
+    char *heap;        // Null while the string is inline.
+    s64 count;
+    s64 capacity;      // Characters the heap buffer holds, without the terminator.
+    NB_Allocator allocator;
+
+    char buffer[NB_SMALL_STRING_INLINE_SIZE];
+} NB_Small_String;
+
+typedef struct NB_Small_Array {
+    u8 *heap;          // Null while the items are inline.
+    s64 count;
+    s64 capacity;      // Items the heap buffer holds.
+    s64 item_size;
+    NB_Allocator allocator;
+
+    u8 buffer[NB_SMALL_ARRAY_INLINE_SIZE];
+} NB_Small_Array;
+
+NB_EXTERN void nb_small_string_init(NB_Small_String *s, NB_Allocator allocator);
+NB_EXTERN void nb_small_string_release(NB_Small_String *s);
+NB_EXTERN bool nb_small_string_reserve(NB_Small_String *s, s64 count);
+
+// Appending functions return false when out of memory, the string is unchanged.
+NB_EXTERN bool nb_small_string_append(NB_Small_String *s, NB_String text);
+NB_EXTERN bool nb_small_string_append_cstring(NB_Small_String *s, const char *text);
+NB_EXTERN bool nb_small_string_print(NB_Small_String *s, const char *fmt, ...) NB_IS_PRINTF_LIKE(2, 3);
+NB_EXTERN bool nb_small_string_print_valist(NB_Small_String *s, const char *fmt, va_list arg_list);
+
+NB_INLINE char *nb_small_string_cstring(NB_Small_String *s) {
+    return s->heap ? s->heap : s->buffer;
+}
+
+NB_INLINE NB_String nb_small_string_view(NB_Small_String *s) {
+    return nb_make_string((u8 *)nb_small_string_cstring(s), s->count);
+}
+
+NB_INLINE void nb_small_string_reset(NB_Small_String *s) {
+    s->count = 0;
+    nb_small_string_cstring(s)[0] = 0;
+}
+
+NB_EXTERN void  nb_small_array_init(NB_Small_Array *array, s64 item_size, NB_Allocator allocator);
+NB_EXTERN void  nb_small_array_release(NB_Small_Array *array);
+NB_EXTERN bool  nb_small_array_reserve(NB_Small_Array *array, s64 count);
+
+// Appends 'count' uninitialized items, returns the first one or null.
+NB_EXTERN void *nb_small_array_add(NB_Small_Array *array, s64 count);
+NB_EXTERN bool  nb_small_array_push(NB_Small_Array *array, void *item);
+
+NB_INLINE void *nb_small_array_items(NB_Small_Array *array) {
+    return array->heap ? array->heap : array->buffer;
+}
+
+#define nb_small_array_init_type(array, Type, allocator) \
+    nb_small_array_init((array), size_of(Type), (allocator))
+
+#define nb_small_array_at(array, Type, index) (((Type *)nb_small_array_items(array))[(index)])
+
+#if LANGUAGE_CPP
+//
+// Typed wrapper over NB_Small_Array. Like NB_Array there is no destructor,
+// release() frees the heap buffer once the items spilled out.
+//
+template<typename T>
+struct NB_Small_Vector {
+    NB_Small_Array array = {null, 0, 0, size_of(T), {null, null}, {}};
+
+    static_assert(alignof(T) <= 8, "NB_Small_Vector items are 8 bytes aligned inline.");
+
+    void release(void) { nb_small_array_release(&array); }
+
+    bool reserve(s64 count) { return nb_small_array_reserve(&array, count); }
+    bool push(const T &value) {
+        T *item = (T *)nb_small_array_add(&array, 1);
+        if (item) *item = value;
+        return item != null;
+    }
+
+    T   *add(s64 count = 1) { return (T *)nb_small_array_add(&array, count); }
+    T    pop(void)          { assert(array.count > 0); array.count -= 1; return items()[array.count]; }
+    void reset(void)        { array.count = 0; }
+
+    T  *items(void)       { return (T *)nb_small_array_items(&array); }
+    s64 count(void) const { return array.count; }
+
+    T &operator[](s64 index) { assert((index >= 0) && (index < array.count)); return items()[index]; }
+
+    T *begin(void) { return items(); }
+    T *end(void)   { return items() + array.count; }
+};
+#endif
+
+
+/******** Bitset ********/
+
+//
+// A bit array in u64 words, either over caller memory (fixed size):
+//
+//     u64 words[NB_BITSET_WORD_COUNT(256)];
+//     NB_Bitset keys;
+//     nb_bitset_init_buffer(&keys, words, 256);
+//
+// or allocated, and then resizable, with nb_bitset_init().
+//
+// Iterating the set bits:
+//
+//     for (s64 index = nb_bitset_find_next_set(&set, 0); index >= 0;
+//          index = nb_bitset_find_next_set(&set, index + 1)) ...
+//
+// The whole set operations and the population count run AVX2 kernels when
+// the CPU has AVX2, chosen once at runtime, and plain u64 loops otherwise.
+// Define NB_BITSET_AVX2 to 0 to leave the AVX2 code out.
+// The bits past 'count' in the last word are always 0.
+//
+
+#ifndef NB_BITSET_AVX2
+    #if (ARCH_X64 || ARCH_X86) && (COMPILER_CL || COMPILER_GCC || COMPILER_CLANG)
+        #define NB_BITSET_AVX2 1
+    #else
+        #define NB_BITSET_AVX2 0
+    #endif
+#endif
+
+#define NB_BITSET_WORD_COUNT(bit_count) (((bit_count) + 63) / 64)
+
+typedef struct NB_Bitset {
+    u64 *words;
+    s64 count;          // Bits.
+    s64 word_capacity;
+
+    NB_Allocator allocator;  // Null for a buffer set, it cannot grow.
+} NB_Bitset;
+
+// A null allocator proc binds nb_current_allocator. The bits start cleared.
+NB_EXTERN bool nb_bitset_init(NB_Bitset *set, s64 count, NB_Allocator allocator);
+NB_EXTERN void nb_bitset_init_buffer(NB_Bitset *set, u64 *words, s64 count);
+NB_EXTERN void nb_bitset_release(NB_Bitset *set);
+
+// New bits are cleared. A buffer set only resizes within its words.
+NB_EXTERN bool nb_bitset_resize(NB_Bitset *set, s64 count);
+
+NB_EXTERN void nb_bitset_set_range(NB_Bitset *set, s64 first, s64 count);
+NB_EXTERN void nb_bitset_clear_range(NB_Bitset *set, s64 first, s64 count);
+NB_EXTERN void nb_bitset_clear_all(NB_Bitset *set);
+
+NB_EXTERN s64  nb_bitset_popcount(NB_Bitset *set);
+
+// Returns the first index >= 'from' with the bit set (or clear), -1 if none.
+NB_EXTERN s64  nb_bitset_find_next_set(NB_Bitset *set, s64 from);
+NB_EXTERN s64  nb_bitset_find_next_clear(NB_Bitset *set, s64 from);
+
+// 'dest' = 'a' op 'b', the three have the same count, dest may be a or b.
+NB_EXTERN void nb_bitset_and(NB_Bitset *dest, NB_Bitset *a, NB_Bitset *b);
+NB_EXTERN void nb_bitset_or(NB_Bitset *dest, NB_Bitset *a, NB_Bitset *b);
+NB_EXTERN void nb_bitset_xor(NB_Bitset *dest, NB_Bitset *a, NB_Bitset *b);
+NB_EXTERN void nb_bitset_andnot(NB_Bitset *dest, NB_Bitset *a, NB_Bitset *b);  // a & ~b
+
+NB_EXTERN bool nb_cpu_supports_avx2(void);
+
+NB_INLINE bool nb_bitset_get(NB_Bitset *set, s64 index) {
+    assert((index >= 0) && (index < set->count));
+    return (set->words[index >> 6] >> (index & 63)) & 1;
+}
+
+NB_INLINE void nb_bitset_set(NB_Bitset *set, s64 index) {
+    assert((index >= 0) && (index < set->count));
+    set->words[index >> 6] |= 1ull << (index & 63);
+}
+
+NB_INLINE void nb_bitset_clear(NB_Bitset *set, s64 index) {
+    assert((index >= 0) && (index < set->count));
+    set->words[index >> 6] &= ~(1ull << (index & 63));
+}
+
+NB_INLINE void nb_bitset_toggle(NB_Bitset *set, s64 index) {
+    assert((index >= 0) && (index < set->count));
+    set->words[index >> 6] ^= 1ull << (index & 63);
+}
+
+
+/******** Heap ********/
+
+//
+// A 4-ary min heap of (key, value) pairs. A node's four children share one
+// cache line: the entries start 3 slots into a cache line aligned block,
+// so each sift down step loads a single line.
+//
+//     NB_Heap queue;
+//     nb_heap_init(&queue, 64, nb_current_allocator);
+//     nb_heap_push(&queue, deadline, (u64)job);
+//     NB_Heap_Entry next;
+//     while (nb_heap_pop(&queue, &next)) ...
+//
+
+#define NB_HEAP_ARITY 4
+
+typedef struct NB_Heap_Entry {
+    u64 key;
+    u64 value;
+} NB_Heap_Entry;
+
+typedef struct NB_Heap {
+    NB_Heap_Entry *entries;  // entries[0] is the minimum.
+    s64 count;
+    s64 capacity;
+
+    NB_Allocator allocator;
+} NB_Heap;
+
+// A null allocator proc binds nb_current_allocator.
+NB_EXTERN void nb_heap_init(NB_Heap *heap, s64 capacity, NB_Allocator allocator);
+NB_EXTERN void nb_heap_release(NB_Heap *heap);
+
+NB_EXTERN bool nb_heap_reserve(NB_Heap *heap, s64 capacity);
+NB_EXTERN bool nb_heap_push(NB_Heap *heap, u64 key, u64 value);
+NB_EXTERN bool nb_heap_pop(NB_Heap *heap, NB_Heap_Entry *entry);
+
+NB_INLINE NB_Heap_Entry *
+nb_heap_peek(NB_Heap *heap) {
+    return heap->count ? heap->entries : null;
+}
+
+NB_INLINE void
+nb_heap_reset(NB_Heap *heap) {
+    heap->count = 0;
+}
+
+
+
+/******** Timer Wheel ********/
+
+//
+// Hierarchical timer wheel (Varghese & Lauck) counting abstract ticks:
+// the caller decides what a tick is (a frame, a millisecond) and moves
+// the wheel with nb_timer_wheel_advance().
+//
+// Level 0 has one slot per tick for the next 64 ticks, each level above
+// covers 64 times the span of the one below. When level 0 wraps, the
+// matching slot of level 1 is spread back over level 0, and so on up.
+// Adding and cancelling are O(1), a tick costs O(1) plus the timers
+// that fire or move down a level.
+//
+//     NB_Timer_Wheel wheel;
+//     nb_timer_wheel_init(&wheel, 64, nb_current_allocator);
+//     u32 timer = nb_timer_add(&wheel, 20, 20, drop_piece, &game);  // Every 20 ticks.
+//     nb_timer_wheel_advance(&wheel, 1);
+//     nb_timer_cancel(&wheel, timer);
+//
+// Timers are handles of a handle pool, cancelling a timer that already
+// fired is a no-op. The procs may add and cancel timers. A periodic
+// timer is re-armed before its proc runs, so the proc can cancel it.
+// Deadlines past the top level span are parked in the top level and
+// cascade back down until they are in range.
+//
+
+#define NB_TIMER_WHEEL_LEVELS     4
+#define NB_TIMER_WHEEL_SLOT_BITS  6
+#define NB_TIMER_WHEEL_SLOTS      (1 << NB_TIMER_WHEEL_SLOT_BITS)
+#define NB_TIMER_WHEEL_SLOT_MASK  (NB_TIMER_WHEEL_SLOTS - 1)
+#define NB_TIMER_WHEEL_MAX_DELAY  ((1ull << (NB_TIMER_WHEEL_LEVELS * NB_TIMER_WHEEL_SLOT_BITS)) - 1)
+
+typedef void NB_Timer_Proc(void *data, u32 timer);
+
+typedef struct NB_Timer {
+    u64 period;    // 0 for a one shot timer.
+
+    NB_Timer_Proc *proc;
+    void *data;
+} NB_Timer;
+
+// The list links live apart from the timers, by handle index, so linking
+// and cascading touch one small record and no pool indirection.
+typedef struct NB_Timer_Link {
+    u64 expires;   // Absolute tick.
+    u32 prev;      // Handle indices of the slot list neighbours.
+    u32 next;
+    u32 slot;      // level * NB_TIMER_WHEEL_SLOTS + slot.
+} NB_Timer_Link;
+
+#define NB_TIMER_WHEEL_NONE NB_HANDLE_INDEX_MASK
+
+typedef struct NB_Timer_Wheel {
+    NB_Handle_Pool timers;
+
+    NB_Timer_Link *links;
+    s64 link_capacity;
+
+    u32 slots[NB_TIMER_WHEEL_LEVELS * NB_TIMER_WHEEL_SLOTS];  // List heads.
+    u64 occupied[NB_TIMER_WHEEL_LEVELS];                      // A bit per non empty slot.
+
+    u64 now;
+} NB_Timer_Wheel;
+
+// A null allocator proc binds nb_current_allocator.
+NB_EXTERN void nb_timer_wheel_init(NB_Timer_Wheel *wheel, s64 capacity, NB_Allocator allocator);
+NB_EXTERN void nb_timer_wheel_release(NB_Timer_Wheel *wheel);
+
+// Runs the timers due in the next 'ticks' ticks, returns how many fired.
+NB_EXTERN s64  nb_timer_wheel_advance(NB_Timer_Wheel *wheel, u64 ticks);
+
+// Fires 'delay' ticks from now (at least 1), then every 'period' ticks
+// unless the period is 0. Returns NB_HANDLE_NONE when out of memory.
+NB_EXTERN u32  nb_timer_add(NB_Timer_Wheel *wheel, u64 delay, u64 period, NB_Timer_Proc *proc, void *data);
+NB_EXTERN bool nb_timer_cancel(NB_Timer_Wheel *wheel, u32 timer);
+
+NB_INLINE s64
+nb_timer_wheel_count(NB_Timer_Wheel *wheel) {
+    return wheel->timers.count;
+}
+
+
+/******** Quick Sort ********/
+
+//
+// nb_qsort is an introsort: quicksort around a median of 3 pivot (a ninther
+// above NB_SORT_NINTHER_THRESHOLD items), insertion sort for the ranges
+// under NB_SORT_INSERTION_THRESHOLD items, and heapsort for a range once
+// the partitions went 2*log2(count) deep, so the worst case stays
+// O(n log n). It is not stable. qsort_compare returns < 0, 0, > 0.
+//
+// From C++, nb_sort() runs the same algorithm with the comparison inlined
+// and the elements moved by type:
+//
+//     nb_sort(items, count);  // operator <
+//     nb_sort(items, count, [](const Item &a, const Item &b) { return a.key < b.key; });
+//
+
+#define NB_SORT_INSERTION_THRESHOLD 16
+#define NB_SORT_NINTHER_THRESHOLD   128
+
+NB_EXTERN void nb_qsort(void *data, s64 count, s64 stride, s64 (*qsort_compare)(void *, void *));
+
+// The same sort without recursion, on a fixed 64 range stack.
+NB_EXTERN void nb_qsort_it(void *data, s64 count, s64 stride, s64 (*qsort_compare)(void *, void *));
+
+#if LANGUAGE_CPP
+template<typename T>
+inline void nb_sort_swap(T &a, T &b) {
+    T temp = a;
+    a = b;
+    b = temp;
+}
+
+template<typename T, typename Less>
+void nb_sort_insertion(T *data, s64 count, Less &less) {
+    for (s64 index = 1; index < count; ++index) {
+        if (!less(data[index], data[index - 1])) continue;
+
+        T value = data[index];
+        s64 at  = index;
+        do {
+            data[at] = data[at - 1];
+            at -= 1;
+        } while ((at > 0) && less(value, data[at - 1]));
+
+        data[at] = value;
+    }
+}
+
+template<typename T, typename Less>
+void nb_sort_sift_down(T *data, s64 root, s64 count, Less &less) {
+    T value = data[root];
+
+    for (;;) {
+        s64 child = root * 2 + 1;
+        if (child >= count) break;
+
+        if ((child + 1 < count) && less(data[child], data[child + 1])) child += 1;
+        if (!less(value, data[child])) break;
+
+        data[root] = data[child];
+        root = child;
+    }
+
+    data[root] = value;
+}
+
+template<typename T, typename Less>
+void nb_sort_heap(T *data, s64 count, Less &less) {
+    for (s64 index = count / 2 - 1; index >= 0; --index) {
+        nb_sort_sift_down(data, index, count, less);
+    }
+
+    for (s64 end = count - 1; end > 0; --end) {
+        nb_sort_swap(data[0], data[end]);
+        nb_sort_sift_down(data, 0, end, less);
+    }
+}
+
+template<typename T, typename Less>
+s64 nb_sort_median_of_3(T *data, s64 a, s64 b, s64 c, Less &less) {
+    if (less(data[a], data[b])) {
+        if (less(data[b], data[c])) return b;
+        return less(data[a], data[c]) ? c : a;
+    }
+
+    if (less(data[a], data[c])) return a;
+    return less(data[b], data[c]) ? c : b;
+}
+
+template<typename T, typename Less>
+void nb_sort_introsort(T *data, s64 count, s64 depth, Less &less) {
+    while (count > NB_SORT_INSERTION_THRESHOLD) {
+        if (depth == 0) {
+            nb_sort_heap(data, count, less);
+            return;
+        }
+        depth -= 1;
+
+        // The samples skip both ends. The pivot swaps leave outliers there,
+        // on a reversed run the max stays first and a median with it picks
+        // the next largest item at every level.
+        s64 first  = 1;
+        s64 middle = count / 2;
+        s64 last   = count - 2;
+        s64 pivot;
+        if (count > NB_SORT_NINTHER_THRESHOLD) {
+            s64 step = count / 8;
+            pivot = nb_sort_median_of_3(data,
+                                        nb_sort_median_of_3(data, first, first + step, first + step * 2, less),
+                                        nb_sort_median_of_3(data, middle - step, middle, middle + step, less),
+                                        nb_sort_median_of_3(data, last - step * 2, last - step, last, less),
+                                        less);
+        } else {
+            pivot = nb_sort_median_of_3(data, first, middle, last, less);
+        }
+
+        // Hoare partition around data[0], stopping on equal items keeps the
+        // halves balanced when the keys repeat.
+        nb_sort_swap(data[0], data[pivot]);
+        T pivot_value = data[0];
+
+        s64 i = 0;
+        s64 j = count;
+        for (;;) {
+            do { i += 1; } while ((i < count) && less(data[i], pivot_value));
+            do { j -= 1; } while (less(pivot_value, data[j]));
+
+            if (i >= j) break;
+            nb_sort_swap(data[i], data[j]);
+        }
+
+        nb_sort_swap(data[0], data[j]);
+
+        // Recurses in the smaller side, so the stack stays O(log n).
+        s64 left_count  = j;
+        s64 right_count = count - j - 1;
+        if (left_count < right_count) {
+            nb_sort_introsort(data, left_count, depth, less);
+            data  += j + 1;
+            count  = right_count;
+        } else {
+            nb_sort_introsort(data + j + 1, right_count, depth, less);
+            count  = left_count;
+        }
+    }
+
+    nb_sort_insertion(data, count, less);
+}
+
+template<typename T, typename Less>
+void nb_sort(T *data, s64 count, Less less) {
+    if (count < 2) return;
+
+    s64 depth = 0;
+    for (s64 n = count; n > 1; n >>= 1) depth += 2;
+
+    nb_sort_introsort(data, count, depth, less);
+}
+
+template<typename T>
+struct NB_Sort_Less {
+    bool operator()(const T &a, const T &b) const { return a < b; }
+};
+
+template<typename T>
+void nb_sort(T *data, s64 count) {
+    nb_sort(data, count, NB_Sort_Less<T>());
+}
+#endif  // LANGUAGE_CPP
+
+
+
+/******** Radix Sort ********/
+
+//
+// LSD radix sort on 11 bit digits: 3 passes over 32 bit keys, 6 over
+// 64 bit keys. A single read counts every digit up front, and a pass is
+// skipped when all the keys share its digit (small ids, depths in a narrow
+// range...). The sort is stable, the optional 'values' (indices, handles)
+// move along with their keys.
+//
+// The ping pong buffers and the counts come from the temporary storage,
+// which gets back to its mark before returning. Returns false, with the
+// arrays untouched, when the storage runs out of memory.
+//
+// s32 keys sort as signed, float32 keys by value with -0 before +0,
+// NaNs go to the ends by sign.
+//
+
+#define NB_RADIX_SORT_DIGIT_BITS 11
+#define NB_RADIX_SORT_BUCKETS    (1 << NB_RADIX_SORT_DIGIT_BITS)
+
+// Under this count an insertion sort beats the counting passes.
+#define NB_RADIX_SORT_SMALL      64
+
+NB_EXTERN bool nb_radix_sort_u32(u32 *keys, u32 *values, s64 count);
+NB_EXTERN bool nb_radix_sort_s32(s32 *keys, u32 *values, s64 count);
+NB_EXTERN bool nb_radix_sort_float32(float32 *keys, u32 *values, s64 count);
+NB_EXTERN bool nb_radix_sort_u64(u64 *keys, u32 *values, s64 count);
+
+#if LANGUAGE_CPP
+NB_INLINE bool nb_radix_sort(u32 *keys, s64 count, u32 *values = null)     { return nb_radix_sort_u32(keys, values, count); }
+NB_INLINE bool nb_radix_sort(s32 *keys, s64 count, u32 *values = null)     { return nb_radix_sort_s32(keys, values, count); }
+NB_INLINE bool nb_radix_sort(float32 *keys, s64 count, u32 *values = null) { return nb_radix_sort_float32(keys, values, count); }
+NB_INLINE bool nb_radix_sort(u64 *keys, s64 count, u32 *values = null)     { return nb_radix_sort_u64(keys, values, count); }
+#endif
+
+
+
+/******** Merge Sort ********/
+
+//
+// Stable sort for when equal keys must keep their order (draws by layer,
+// then by submission). A natural merge sort: the ascending runs already
+// in the data are kept, strictly descending ones are reversed, and the
+// runs shorter than NB_MERGE_SORT_MIN_RUN are extended by insertion sort.
+// Neighbour runs are then merged pairwise, bottom up.
+//
+// A merge first skips the left items already below the right run and the
+// right items already above the left run, then copies the rest of the
+// left run aside and merges forward. Once one side wins
+// NB_MERGE_SORT_MIN_GALLOP times in a row it gallops: an exponential then
+// binary search finds how far it keeps winning, moved as one block.
+// Sorted or nearly sorted data costs about n compares.
+//
+// The scratch (count items) comes from the temporary storage, which gets
+// back to its mark before returning. Returns false, with the data
+// untouched, when the storage runs out of memory.
+//
+//     nb_merge_sort(draws, count, size_of(Draw), compare_draw_layer);
+//     nb_stable_sort(draws, count, [](const Draw &a, const Draw &b) { return a.layer < b.layer; });
+//
+
+#define NB_MERGE_SORT_MIN_RUN    32
+#define NB_MERGE_SORT_MIN_GALLOP 7
+
+NB_EXTERN bool nb_merge_sort(void *data, s64 count, s64 stride, s64 (*compare)(void *, void *));
+
+#if LANGUAGE_CPP
+//
+// Typed front end, the comparison inlines. The scratch is raw memory the
+// items are assigned into, so T should be plain data like for NB_Array.
+//
+
+// Items of 'base' that go before 'key': the ones <= key when 'upper',
+// the ones < key otherwise.
+template<typename T, typename Less>
+s64 nb_stable_sort_gallop(const T &key, T *base, s64 count, bool upper, Less &less) {
+#define NB_STABLE_SORT_BEFORE(index) (upper ? !less(key, base[(index)]) : less(base[(index)], key))
+    if (!count || !NB_STABLE_SORT_BEFORE(0)) return 0;
+
+    // Exponential probe from the start, then binary search the last gap.
+    s64 last_before = 0;
+    s64 step = 1;
+    while ((last_before + step < count) && NB_STABLE_SORT_BEFORE(last_before + step)) {
+        last_before += step;
+        step *= 2;
+    }
+
+    s64 low  = last_before + 1;
+    s64 high = nb_min(last_before + step, count);
+    while (low < high) {
+        s64 middle = low + (high - low) / 2;
+        if (NB_STABLE_SORT_BEFORE(middle)) low = middle + 1;
+        else                               high = middle;
+    }
+#undef NB_STABLE_SORT_BEFORE
+
+    return low;
+}
+
+template<typename T, typename Less>
+void nb_stable_sort_merge(T *left_run, s64 left_count, s64 right_count, T *temp, Less &less) {
+    T *right = left_run + left_count;
+
+    s64 skip = nb_stable_sort_gallop(right[0], left_run, left_count, true, less);
+    left_run   += skip;
+    left_count -= skip;
+    if (!left_count) return;
+
+    right_count = nb_stable_sort_gallop(left_run[left_count - 1], right, right_count, false, less);
+    if (!right_count) return;
+
+    for (s64 index = 0; index < left_count; ++index) temp[index] = left_run[index];
+
+    T *left      = temp;
+    T *left_end  = temp + left_count;
+    T *right_end = right + right_count;
+    T *dest      = left_run;
+
+    s64 left_wins  = 0;
+    s64 right_wins = 0;
+    while ((left < left_end) && (right < right_end)) {
+        if (left_wins >= NB_MERGE_SORT_MIN_GALLOP) {
+            s64 run = nb_stable_sort_gallop(*right, left, left_end - left, true, less);
+            for (s64 index = 0; index < run; ++index) *dest++ = *left++;
+
+            left_wins = 0;
+            if (left == left_end) break;
+        } else if (right_wins >= NB_MERGE_SORT_MIN_GALLOP) {
+            s64 run = nb_stable_sort_gallop(*left, right, right_end - right, false, less);
+            for (s64 index = 0; index < run; ++index) *dest++ = *right++;
+
+            right_wins = 0;
+            if (right == right_end) break;
+        }
+
+        if (less(*right, *left)) {
+            *dest++ = *right++;
+            right_wins += 1;
+            left_wins   = 0;
+        } else {
+            *dest++ = *left++;
+            left_wins += 1;
+            right_wins = 0;
+        }
+    }
+
+    // What is left of the right run is in place already.
+    while (left < left_end) *dest++ = *left++;
+}
+
+template<typename T, typename Less>
+bool nb_stable_sort(T *data, s64 count, Less less) {
+    if (count < 2) return true;
+
+    if (count <= NB_MERGE_SORT_MIN_RUN) {
+        nb_sort_insertion(data, count, less);
+        return true;
+    }
+
+    s64 mark = nb_get_temporary_storage_mark();
+    s64 *runs = (s64 *)nb_talloc_align(&nb_temporary_storage, (count / NB_MERGE_SORT_MIN_RUN + 2) * size_of(s64), 8);
+    T   *temp = (T *)nb_talloc_align(&nb_temporary_storage, count * size_of(T), 16);
+    if (!runs || !temp) {
+        nb_set_temporary_storage_mark(mark);
+        return false;
+    }
+
+    s64 run_count = 0;
+    for (s64 start = 0; start < count;) {
+        s64 end = start + 1;
+        if (end < count) {
+            if (less(data[end], data[start])) {
+                // Only strictly descending, reversing equal items would
+                // break the stability.
+                end += 1;
+                while ((end < count) && less(data[end], data[end - 1])) end += 1;
+
+                for (s64 i = start, j = end - 1; i < j; ++i, --j) nb_sort_swap(data[i], data[j]);
+            } else {
+                end += 1;
+                while ((end < count) && !less(data[end], data[end - 1])) end += 1;
+            }
+        }
+
+        if (end - start < NB_MERGE_SORT_MIN_RUN) {
+            end = nb_min(start + NB_MERGE_SORT_MIN_RUN, count);
+            nb_sort_insertion(data + start, end - start, less);
+        }
+
+        runs[run_count++] = start;
+        start = end;
+    }
+    runs[run_count] = count;
+
+    while (run_count > 1) {
+        s64 merged = 0;
+        for (s64 run = 0; run + 1 < run_count; run += 2) {
+            nb_stable_sort_merge(data + runs[run], runs[run + 1] - runs[run], runs[run + 2] - runs[run + 1], temp, less);
+            runs[merged++] = runs[run];
+        }
+
+        if (run_count & 1) runs[merged++] = runs[run_count - 1];
+        runs[merged] = count;
+        run_count = merged;
+    }
+
+    nb_set_temporary_storage_mark(mark);
+    return true;
+}
+
+template<typename T>
+bool nb_stable_sort(T *data, s64 count) {
+    return nb_stable_sort(data, count, NB_Sort_Less<T>());
+}
+#endif  // LANGUAGE_CPP
+
+
+
+/******** Utility functions ********/
+
+NB_INLINE u16 nb_swap2(u16 mem) {
+    u16 a = mem >> 8;
+    u16 b = (mem & 0xFF) << 8;
+    
+    u16 result = a | b;
+    return result;
+}
+
+NB_INLINE u32 nb_swap4(u32 mem) {
+    u32 a = (mem >> 24);
+    u32 b = (mem >> 16) & 0xFF;
+    u32 c = (mem >>  8) & 0xFF;
+    u32 d = (mem) & 0xFF;
+    
+    u32 result = (d << 24) | (c << 16) | (b << 8) | a;
+    return result;
+}
+
+NB_INLINE u32 nb_find_least_significant_set_bit(u32 value) {
+#if COMPILER_CL
+    unsigned long result = 0;
+    _BitScanForward(&result, value);
+    return (u32)result;
+#elif COMPILER_GCC
+    return (u32)__builtin_ctz(value);
+#else
+    for (u32 test = 0; test < 32; ++test) {
+        if (value & (1 << test)) {
+            return test;
+        }
+    }
+
+    return 0;
+#endif
+}
+
+// The value must not be 0.
+NB_INLINE u32 nb_find_least_significant_set_bit64(u64 value) {
+#if COMPILER_CL && ARCH_X64
+    unsigned long result = 0;
+    _BitScanForward64(&result, value);
+    return (u32)result;
+#elif COMPILER_GCC || COMPILER_CLANG
+    return (u32)__builtin_ctzll(value);
+#else
+    u32 low = (u32)value;
+    if (low) return nb_find_least_significant_set_bit(low);
+
+    return 32 + nb_find_least_significant_set_bit((u32)(value >> 32));
+#endif
+}
+
+NB_INLINE u32 nb_count_set_bits64(u64 value) {
+#if COMPILER_GCC || COMPILER_CLANG
+    return (u32)__builtin_popcountll(value);
+#else
+    value = value - ((value >> 1) & 0x5555555555555555ull);
+    value = (value & 0x3333333333333333ull) + ((value >> 2) & 0x3333333333333333ull);
+    value = (value + (value >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (u32)((value * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// The value must not be 0.
+NB_INLINE u32 nb_find_most_significant_set_bit(u32 value) {
+#if COMPILER_CL
+    unsigned long result = 0;
+    _BitScanReverse(&result, value);
+    return (u32)result;
+#elif COMPILER_GCC || COMPILER_CLANG
+    return (u32)(31 - __builtin_clz(value));
+#else
+    for (s32 test = 31; test >= 0; --test) {
+        if (value & (1u << test)) {
+            return (u32)test;
+        }
+    }
+
+    return 0;
+#endif
+}
+
+NB_INLINE u32 nb_find_most_significant_set_bit64(u64 value) {
+#if COMPILER_CL && ARCH_X64
+    unsigned long result = 0;
+    _BitScanReverse64(&result, value);
+    return (u32)result;
+#elif COMPILER_GCC || COMPILER_CLANG
+    return (u32)(63 - __builtin_clzll(value));
+#else
+    u32 high = (u32)(value >> 32);
+    if (high) return 32 + nb_find_most_significant_set_bit(high);
+
+    return nb_find_most_significant_set_bit((u32)value);
+#endif
+}
+
+NB_INLINE void 
+nb_swap_two_memory_blocks(u8 *a_, u8 *b_, s64 count) {
+    u8 *a = a_;
+    u8 *b = b_;
+
+    // Word at a time, memcpy compiles to plain unaligned loads and stores.
+    while (count >= 8) {
+        u64 x, y;
+        memcpy(&x, a, 8);
+        memcpy(&y, b, 8);
+        memcpy(a, &y, 8);
+        memcpy(b, &x, 8);
+
+        a += 8;
+        b += 8;
+        count -= 8;
+    }
+
+    if (count >= 4) {
+        u32 x, y;
+        memcpy(&x, a, 4);
+        memcpy(&y, b, 4);
+        memcpy(a, &y, 4);
+        memcpy(b, &x, 4);
+
+        a += 4;
+        b += 4;
+        count -= 4;
+    }
+
+    while (count--) {
+        u8 temp = *a;
+        *a++    = *b;
+        *b++    = temp;
+    }
+}
+
+#define nb_get_clamped(v, l, h) (((v) < (l)) ? (l) : (((v) > (h)) ? (h) : (v)))
+
+#if LANGUAGE_CPP
+NB_INLINE void nb_clamp(int *pointer, int low, int high) {
+    if (*pointer < low) { *pointer = low; }
+    if (*pointer > high) { *pointer = high; }
+}
+
+NB_INLINE void nb_clamp(float *pointer, float low, float high) {
+    if (*pointer < low) { *pointer = low; }
+    if (*pointer > high) { *pointer = high; }
+}
+#endif
+
+#ifndef Clamp
+#define Clamp nb_clamp
+#endif
+
+NB_INLINE NB_OS_Type nb_get_current_os(void) {
+    NB_OS_Type result = NB_OS_NONE;
+#if OS_WINDOWS
+    result = NB_OS_WINDOWS;
+#elif OS_LINUX
+    result = NB_OS_LINUX;
+#elif OS_MAC
+    result = NB_OS_MAC;
+#endif
+
+    return result;
+}
+
+NB_INLINE NB_Arch_Type nb_get_current_arch(void) {
+    NB_Arch_Type result = NB_ARCH_NONE;
+#if ARCH_X64
+    result = NB_ARCH_X64;
+#elif ARCH_X86
+    result = NB_ARCH_X86;
+#elif ARCH_ARM
+    result = NB_ARCH_ARM;
+#elif ARCH_ARM64
+    result = NB_ARCH_ARM64;
+#endif
+
+    return result;
+}
+
+NB_INLINE const char *nb_os_to_string(NB_OS_Type os) {
+    const char *result = null;
+    switch (os) {
+        case NB_OS_WINDOWS:
+            result = "Windows";
+            break;
+
+        case NB_OS_LINUX:
+            result = "Linux";
+            break;
+
+        case NB_OS_MAC:
+            result = "Mac";
+            break;
+
+        default: break;
+    }
+
+    return result;
+}
+
+NB_INLINE const char *nb_arch_to_string(NB_Arch_Type arch) {
+    const char *result = null;
+    switch (arch) {
+        case NB_ARCH_X64:
+            result = "X64";
+            break;
+
+        case NB_ARCH_X86:
+            result = "X86";
+            break;
+
+        case NB_ARCH_ARM:
+            result = "ARM";
+            break;
+
+        case NB_ARCH_ARM64:
+            result = "ARM64";
+            break;
+
+        default: break;
+    }
+
+    return result;
+}
+
+NB_INLINE void nb_panic(void) {
+    nb_write_new_string(S("Panic.\n"), true);
+#if NB_DEBUG
+    nb_debug_break();
+#else
+    // nb_abort();
+#endif
+}
+
+// Ratio helpers.
+
+NB_INLINE float nb_safe_ratio_0(float n, float d) {
+    float result = 0;
+
+    if (d != 0) {
+        result = n/d;
+    }
+
+    return result;
+}
+
+NB_INLINE float nb_safe_ratio_1(float n, float d) {
+    float result = 1;
+
+    if (d != 0) {
+        result = n/d;
+    }
+
+    return result;
+}
+
+NB_INLINE float nb_safe_ratio_n(float a, float b, float n) {
+    float result = n;
+
+    if (b != 0) {
+        result = a/b;
+    }
+
+    return result;
+}
+
+// String helpers.
+
+NB_INLINE bool nb_strings_are_equal(NB_String a, NB_String b) {
+    if (a.count != b.count) return false;
+
+    for (s64 index = 0; index < a.count; ++index) {
+        if (a.data[index] != b.data[index]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+NB_INLINE bool nb_cstrings_are_equal(char *a, char *b) {
+    bool result = (a == b);
+
+    if (a && b) {
+        while (*a && *b && (*a == *b)) {
+            ++a;
+            ++b;
+        }
+
+        result = ((*a == 0) && (*b == 0));
+    }
+
+    return result;
+}
+
+NB_INLINE bool 
+nb_strings_are_equal_length(s64 length_a, char *a, s64 length_b, char *b) {
+    if (length_a != length_b) return false;
+
+    for (s64 index = 0; index < length_a; ++index) {
+        if (a[index] != b[index]) return false;
+    }
+
+    return true;
+}
+
+NB_INLINE bool 
+nb_strings_are_equal_first_length(s64 length_a, char *a, char *b) {
+    char *it = b;
+    for (s64 index = 0; index < length_a; ++index, ++it) {
+        if ((*it == 0) || (a[index] != *it)) {
+            return false;
+        }
+    }
+
+    bool result = (*it == 0);
+    return result;
+}
+
+NB_INLINE bool nb_is_end_of_line(int c) {
+    bool result = ((c == '\n') || (c == '\r'));
+    return result;
+}
+
+NB_INLINE bool nb_is_white_space(int c) {
+    bool result = ((c == ' ')  || 
+                   (c == '\t') ||
+                   (c == '\v') || 
+                   (c == '\f') || 
+                   (c == '\n') ||
+                   (c == '\r'));
+
+    return result;
+}
+
+NB_INLINE bool nb_is_digit(int c) {
+    bool result = (c >= '0') && (c <= '9');
+    return result;
+}
+
+NB_INLINE s64 nb_string_length(const char *s) {
+    if (!s) return 0;
+
+    const char *it = s;
+    while (*it++);
+
+    return (s64)(it-1 - s);
+}
+
+NB_INLINE char *nb_eat_spaces(char *s) {
+    char *it = s;
+    while (*it == ' ') {
+        it++;
+    }
+
+    return it;
+}
+
+NB_INLINE char *nb_get_extension(char *s) {
+    char *result = null;
+
+    char *it = s;
+    while (*it) {
+        if (*it == '.') result = it;
+
+        it++;
+    }
+
+    return result;
+}
+
+NB_INLINE char *
+nb_find_character_from_right(char *s, u8 c) {
+    s64 length = nb_string_length(s);
+
+    for (s64 i = length - 1; i >= 0; --i) {
+        if (s[i] == c) {
+            return s + i;
+        }
+    }
+
+    return null;
+}
+
+NB_INLINE char *nb_path_cleanup(char *s) {
+    char *it = s;
+    while (*it) {
+        if (*it == '\\') *it = '/';
+
+        it++;
+    }
+
+    return s;
+}
+
+NB_INLINE void nb_advance(NB_String *s, s64 amount) {
+    s->data  += amount;
+    s->count -= amount;
+}
+
+#endif  // NB_INCLUDE_GENERAL_H
+
+
+
+
+
+
+
+
+
+
+
+
+
+/******** General Implementation ********/
+
+#ifdef NB_IMPLEMENTATION
+
+#include <inttypes.h>
+
+// MinGW's printf does not understand the PRId64 format.
+#if OS_WINDOWS && COMPILER_GCC
+#define NB_FMT_S64 "I64d"
+#else
+#define NB_FMT_S64 PRId64
+#endif
 
 NB_Logger_Proc *nb_current_logger = nb_default_logger;
 const char *nb_current_logger_ident = null;
 u32 nb_current_logger_mode = NB_LOG_NONE;
 
-NB_EXTERN const char *nb_logger_push_ident(const char *ident) {
-    const char *result = nb_current_logger_ident;
-    nb_current_logger_ident = ident;
+NB_EXTERN const char *nb_logger_push_ident(const char *ident) {
+    const char *result = nb_current_logger_ident;
+    nb_current_logger_ident = ident;
+
+    return result;
+}
+
+NB_EXTERN u32 nb_logger_push_mode(u32 mode) {
+    u32 result = nb_current_logger_mode;
+    nb_current_logger_mode = mode;
+
+    return result;
+}
+
+nb_thread_local NB_Allocator nb_current_allocator = {nb_heap_allocator, null};
+
+nb_thread_local NB_Allocator nb_allocator_stack[NB_ALLOCATOR_STACK_SIZE];
+nb_thread_local s32 nb_allocator_stack_count;
+
+NB_EXTERN void nb_push_allocator(NB_Allocator a) {
+    assert(nb_allocator_stack_count < NB_ALLOCATOR_STACK_SIZE);
+
+    nb_allocator_stack[nb_allocator_stack_count] = nb_current_allocator;
+    nb_allocator_stack_count += 1;
+    nb_current_allocator = a;
+}
+
+NB_EXTERN NB_Allocator nb_pop_allocator(void) {
+    assert(nb_allocator_stack_count > 0);
+
+    NB_Allocator result = nb_current_allocator;
+    nb_allocator_stack_count -= 1;
+    nb_current_allocator = nb_allocator_stack[nb_allocator_stack_count];
+    return result;
+}
+
+
+// Shared by every thread, the heap is.
+typedef struct NB_Heap_Stats {
+    volatile s64 live_bytes;
+    volatile s64 peak_bytes;
+    volatile s64 allocation_count;
+    volatile s64 failed_count;
+} NB_Heap_Stats;
+
+#if NB_HEAP_STATS
+static NB_Heap_Stats nb_heap_stats;
+#endif
+
+// Block sizes are the usable sizes reported by the heap.
+static void
+nb_heap_stats_add(s64 block_size) {
+#if NB_HEAP_STATS
+    nb_atomic_max64(&nb_heap_stats.peak_bytes, nb_atomic_add64(&nb_heap_stats.live_bytes, block_size));
+    nb_atomic_add64(&nb_heap_stats.allocation_count, 1);
+#else
+    UNUSED(block_size);
+#endif
+}
+
+static void
+nb_heap_stats_remove(s64 block_size) {
+#if NB_HEAP_STATS
+    nb_atomic_add64(&nb_heap_stats.live_bytes, -block_size);
+#else
+    UNUSED(block_size);
+#endif
+}
+
+static void
+nb_heap_stats_fail(void) {
+#if NB_HEAP_STATS
+    nb_atomic_add64(&nb_heap_stats.failed_count, 1);
+#endif
+}
+
+static void *
+nb_heap_query_stats(NB_Allocator_Stats *stats) {
+#if NB_HEAP_STATS
+    stats->live_bytes       = nb_atomic_load64(&nb_heap_stats.live_bytes);
+    stats->peak_bytes       = nb_atomic_load64(&nb_heap_stats.peak_bytes);
+    stats->allocation_count = nb_atomic_load64(&nb_heap_stats.allocation_count);
+    stats->failed_count     = nb_atomic_load64(&nb_heap_stats.failed_count);
+    return stats;
+#else
+    UNUSED(stats);
+    return null;
+#endif
+}
+
+// Share of the free memory that is not part of the largest free block.
+NB_INLINE float nb_allocator_fragmentation(s64 free_bytes, s64 largest_free_block) {
+    if (free_bytes <= 0) return 0;
+    return 1.0f - (float)largest_free_block / (float)free_bytes;
+}
+
+NB_EXTERN bool
+nb_allocator_query_stats(NB_Allocator allocator, NB_Allocator_Stats *stats) {
+    nb_memory_zero_struct(stats);
+    if (!allocator.proc) return false;
+
+    return allocator.proc(NB_ALLOCATOR_QUERY_STATS, 0, 0, stats, allocator.data) != null;
+}
+
+typedef struct NB_Registered_Allocator {
+    const char *name;
+    NB_Allocator allocator;
+} NB_Registered_Allocator;
+
+static NB_Registered_Allocator nb_allocator_registry[NB_ALLOCATOR_REGISTRY_SIZE] = {
+    {"Heap", {nb_heap_allocator, null}},
+};
+static s32 nb_allocator_registry_count = 1;
+static volatile s32 nb_allocator_registry_lock;
+
+NB_EXTERN bool
+nb_register_allocator(const char *name, NB_Allocator allocator) {
+    bool result = false;
+
+    nb_spin_lock(&nb_allocator_registry_lock);
+    if (nb_allocator_registry_count < NB_ALLOCATOR_REGISTRY_SIZE) {
+        NB_Registered_Allocator *it = nb_allocator_registry + nb_allocator_registry_count;
+        it->name      = name;
+        it->allocator = allocator;
+        nb_allocator_registry_count += 1;
+        result = true;
+    }
+    nb_spin_unlock(&nb_allocator_registry_lock);
+
+    return result;
+}
+
+NB_EXTERN void
+nb_unregister_allocator(NB_Allocator allocator) {
+    nb_spin_lock(&nb_allocator_registry_lock);
+    for (s32 index = 0; index < nb_allocator_registry_count; ++index) {
+        NB_Registered_Allocator *it = nb_allocator_registry + index;
+        if ((it->allocator.proc == allocator.proc) && (it->allocator.data == allocator.data)) {
+            // Keep the registration order for the report.
+            memmove(it, it + 1, (umm)(nb_allocator_registry_count - index - 1) * size_of(*it));
+            nb_allocator_registry_count -= 1;
+            break;
+        }
+    }
+    nb_spin_unlock(&nb_allocator_registry_lock);
+}
+
+NB_EXTERN void
+nb_allocator_report(void) {
+    // The procs may allocate or log, they are not called under the lock.
+    NB_Registered_Allocator registry[NB_ALLOCATOR_REGISTRY_SIZE];
+
+    nb_spin_lock(&nb_allocator_registry_lock);
+    s32 count = nb_allocator_registry_count;
+    memcpy(registry, nb_allocator_registry, (umm)count * size_of(registry[0]));
+    nb_spin_unlock(&nb_allocator_registry_lock);
+
+    for (s32 index = 0; index < count; ++index) {
+        NB_Registered_Allocator *it = registry + index;
+
+        NB_Allocator_Stats stats;
+        if (!nb_allocator_query_stats(it->allocator, &stats)) {
+            nb_log_print(NB_LOG_NONE, "Memory", "%s: no statistics", it->name);
+            continue;
+        }
+
+        nb_log_print(NB_LOG_NONE, "Memory", 
+                     "%s: live: %" NB_FMT_S64 " bytes, peak: %" NB_FMT_S64 " bytes, reserved: %" NB_FMT_S64 " bytes, allocations: %" NB_FMT_S64 ", failed: %" NB_FMT_S64 ", fragmentation: %.1f%%",
+                     it->name,
+                     stats.live_bytes,
+                     stats.peak_bytes,
+                     stats.reserved_bytes,
+                     stats.allocation_count,
+                     stats.failed_count,
+                     (double)(stats.fragmentation * 100.0f));
+    }
+}
+
+nb_thread_local NB_Allocation_Site nb_allocation_site;
+nb_thread_local s32 nb_allocation_site_depth;
+
+// @Cleanup:
+nb_thread_local NB_Temporary_Storage nb_temporary_storage;
+nb_thread_local NB_Allocator nb_temporary_allocator = {nb_temporary_storage_proc, null};
+
+nb_thread_local NB_Frame_Storage nb_frame_storage;
+nb_thread_local NB_Allocator nb_frame_allocator = {nb_frame_storage_proc, null};
+
+nb_thread_local NB_Arena nb_scratch_arenas[NB_SCRATCH_ARENA_COUNT];
+
+
+#if OS_WINDOWS
+
+#ifdef NB_INCLUDE_WINDEFS
+#include "windefs.h"
+#else
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#define UNICODE
+#define _UNICODE
+
+#define WIN32_LEAN_AND_MEAN
+#define VC_EXTRALEAN
+#include <windows.h>
+#endif
+
+
+#if COMPILER_CL
+#pragma comment(lib, "User32.lib")
+#endif
+
+
+void nb_write_string(const char *s, bool to_standard_error) {
+    DWORD written = 0;
+    HANDLE handle = to_standard_error ? GetStdHandle(STD_ERROR_HANDLE) : GetStdHandle(STD_OUTPUT_HANDLE);
+    s32 status = WriteFile(handle, s, (DWORD)nb_string_length(s), &written, null);
+    UNUSED(status);
+}
+
+void nb_write_string_count(const char *s, u32 count, bool to_standard_error) {
+    DWORD written = 0;
+    HANDLE handle = to_standard_error ? GetStdHandle(STD_ERROR_HANDLE) : GetStdHandle(STD_OUTPUT_HANDLE);
+    s32 status = WriteFile(handle, s, count, &written, null);
+    UNUSED(status);
+}
+
+void nb_write_new_string(NB_String s, bool to_standard_error) {
+    DWORD written = 0;
+    HANDLE handle = to_standard_error ? GetStdHandle(STD_ERROR_HANDLE) : GetStdHandle(STD_OUTPUT_HANDLE);
+    s32 status = WriteFile(handle, s.data, (DWORD)s.count, &written, null);
+    UNUSED(status);
+}
+
+static const char *ansi_system_console_text_colors[NB_TEXT_COUNT] = {
+    "\x1b[30m",   // NB_TEXT_BLACK
+    "\x1b[34m",   // NB_TEXT_DARK_BLUE
+    "\x1b[32m",   // NB_TEXT_DARK_GREEN
+    "\x1b[36m",   // NB_TEXT_LIGHT_BLUE
+    "\x1b[31m",   // NB_TEXT_DARK_RED
+    "\x1b[35m",   // NB_TEXT_MAGENTA
+    "\x1b[33m",   // NB_TEXT_ORANGE
+    "\x1b[37m",   // NB_TEXT_LIGHT_GRAY
+    "\x1b[90m",   // NB_TEXT_GRAY
+    "\x1b[94m",   // NB_TEXT_BLUE
+    "\x1b[92m",   // NB_TEXT_GREEN
+    "\x1b[96m",   // NB_TEXT_CYAN
+    "\x1b[91m",   // NB_TEXT_RED
+    "\x1b[95m",   // NB_TEXT_PURPLE
+    "\x1b[93m",   // NB_TEXT_YELLOW
+    "\x1b[97m",   // NB_TEXT_WHITE
+};
+
+static u8 w32_system_console_text_colors[NB_TEXT_COUNT] = {
+    0,   // NB_TEXT_BLACK
+    1,   // NB_TEXT_DARK_BLUE
+    2,   // NB_TEXT_DARK_GREEN
+    3,   // NB_TEXT_LIGHT_BLUE
+    4,   // NB_TEXT_DARK_RED
+    5,   // NB_TEXT_MAGENTA
+    6,   // NB_TEXT_ORANGE
+    7,   // NB_TEXT_LIGHT_GRAY
+    8,   // NB_TEXT_GRAY
+    9,   // NB_TEXT_BLUE
+    10,  // NB_TEXT_GREEN
+    11,  // NB_TEXT_CYAN
+    12,  // NB_TEXT_RED
+    13,  // NB_TEXT_PURPLE
+    14,  // NB_TEXT_YELLOW
+    15,  // NB_TEXT_WHITE
+};
+
+NB_EXTERN void 
+nb_set_console_text_color(NB_System_Console_Text_Color color, 
+                          bool to_standard_error) {
+#ifdef NB_WINDOWS_CONSOLE_USE_ANSI
+    nb_write_string(ansi_system_console_text_colors[color], to_standard_error);
+#else
+    HANDLE handle = to_standard_error ? GetStdHandle(STD_ERROR_HANDLE) : GetStdHandle(STD_OUTPUT_HANDLE);
+    SetConsoleTextAttribute(handle, w32_system_console_text_colors[color]);
+#endif
+}
+
+NB_EXTERN void 
+nb_set_console_text_color_ansi(NB_System_Console_Text_Color color, 
+                               bool to_standard_error) {
+    nb_write_string(ansi_system_console_text_colors[color], to_standard_error);
+}
+
+#include <stdio.h>
+
+NB_EXTERN bool 
+nb_abort_error_message(const char *title, 
+                       const char *message, 
+                       const char *details) {
+    char *full_message = tprint("%s%s", message, details);
+
+    int id = MessageBoxA(null, full_message, title, 
+                         MB_ABORTRETRYIGNORE|MB_ICONERROR|MB_SYSTEMMODAL|MB_DEFBUTTON3);
+    if (id == IDABORT) {
+        ExitProcess(0);
+    }
+
+    return (id == IDRETRY);
+}
+
+#if NB_ENABLE_ASSERTS
+#include <dbghelp.h>
+#if COMPILER_CL
+#pragma comment(lib, "Dbghelp.lib")
+#endif
+
+#include <inttypes.h>
+
+// Windows Server 2003 and Windows XP: The sum of the FramesToSkip and FramesToCapture parameters must be less than 63.
+#define NB_MAX_STACK_FRAMES 63
+#define NB_MAX_SYMBOL_NAME 255
+
+NB_EXTERN char *nb_get_stacktrace(void) {
+    char *result = null;
+    HANDLE process = GetCurrentProcess();
+ 
+    static BOOL initted = false;
+    if (!initted) {
+        initted = SymInitialize(process, null, TRUE);
+        SymSetOptions(SYMOPT_LOAD_LINES);
+    }
+
+    if (initted == TRUE) {
+        void *stack[NB_MAX_STACK_FRAMES];
+
+        u8 buf[size_of(SYMBOL_INFO) + (NB_MAX_SYMBOL_NAME+1)];
+
+        SYMBOL_INFO *symbol_info = (SYMBOL_INFO *)buf;
+        symbol_info->MaxNameLen = NB_MAX_SYMBOL_NAME;
+        symbol_info->SizeOfStruct = size_of(SYMBOL_INFO);
+
+        IMAGEHLP_LINEW64 line64 = {};
+        line64.SizeOfStruct = size_of(IMAGEHLP_LINEW64);
+
+        u16 frames = CaptureStackBackTrace(0, NB_MAX_STACK_FRAMES, stack, null);
+        if (frames > 0) {
+            // Lines are appended in scratch memory, only the final
+            // string goes to the temporary storage.
+            NB_Scratch scratch = nb_get_scratch(null, 0);
+
+            NB_Small_String lines;
+            nb_small_string_init(&lines, nb_scratch_allocator(scratch));
+            nb_small_string_append_cstring(&lines, "Caller stack:\n");
+
+            for (u16 index = 0; index < frames; ++index) {
+                DWORD64 dw_displacement64;
+                BOOL ok = SymFromAddr(process, (DWORD64)(stack[index]), &dw_displacement64, symbol_info);
+                if (!ok) continue;
+
+                s64 call_line;
+                s64 stack_line;
+
+                DWORD64 call_address = (DWORD64)(stack[index]);  // Caller location.
+                DWORD64 stack_address = symbol_info->Address;    // Procedure location.
+
+                DWORD dw_displacement;
+                ok = SymGetLineFromAddrW64(process, call_address, &dw_displacement, &line64);
+                if (!ok) continue;
+
+                call_line = line64.LineNumber;
+
+                ok = SymGetLineFromAddrW64(process, stack_address, &dw_displacement, &line64);
+                if (!ok) continue;
+
+                stack_line = line64.LineNumber;
+
+#if COMPILER_GCC
+                nb_small_string_print(&lines, "0x%016I64u: %s(%I64d) Line %I64d\n", 
+                                      stack_address, 
+                                      symbol_info->Name, 
+                                      stack_line, 
+                                      call_line);
+#else
+                nb_small_string_print(&lines, "0x%016" PRIXPTR ": %s(%" PRId64 ") Line %" PRId64 "\n", 
+                                      stack_address, 
+                                      symbol_info->Name, 
+                                      stack_line, 
+                                      call_line);
+#endif
+            }
+
+            result = tprint("%s", nb_small_string_cstring(&lines));
+            nb_release_scratch(scratch);
+        }
+    } else {
+        nb_write_string("[backtrace] Error: Failed to SymInitialize.\n", true);
+    }
+
+    return result;
+}
+
+#undef NB_MAX_STACK_FRAMES
+#undef NB_MAX_SYMBOL_NAME
+
+#endif  // NB_ENABLE_ASSERTS
+
+NB_EXTERN wchar_t *
+nb_w32_utf8_to_wide(const char *s, NB_Allocator allocator) {
+    nb_push_allocator(allocator);
+    wchar_t *result = null;
+
+    if (s) {
+        s64 byte_count = nb_string_length(s);
+
+        int len = MultiByteToWideChar(CP_UTF8, 0, s, (int)byte_count, null, 0);
+        if (len > 0) {
+            result = nb_new_array(wchar_t, len+1);
+            MultiByteToWideChar(CP_UTF8, 0, s, (int)byte_count, result, len);
+            result[len] = 0;
+        }
+    }
+
+    nb_pop_allocator();
+    return result;
+}
+
+
+// HeapAlloc only aligns to NB_HEAP_DEFAULT_ALIGNMENT, bigger alignments
+// over-allocate and keep the HeapAlloc pointer right before the block.
+static void *
+nb_w32_heap_alloc_aligned(s64 size, s64 alignment, DWORD flags) {
+    assert(nb_is_power_of_2(alignment));
+
+    u8 *memory = (u8 *)HeapAlloc(GetProcessHeap(), flags, (umm)(size + alignment + size_of(void *)));
+    if (!memory) return null;
+
+    u8 *result = nb_align_forward_pointer(memory + size_of(void *), alignment);
+    ((void **)result)[-1] = memory;
+    return result;
+}
+
+static void
+nb_w32_heap_free_aligned(void *memory) {
+    if (memory) HeapFree(GetProcessHeap(), 0, ((void **)memory)[-1]);
+}
+
+NB_INLINE s64 nb_w32_heap_block_size(void *memory, s64 alignment) {
+#if NB_HEAP_STATS
+    if (!memory) return 0;
+    if (alignment > NB_HEAP_DEFAULT_ALIGNMENT) memory = ((void **)memory)[-1];
+
+    return (s64)HeapSize(GetProcessHeap(), 0, memory);
+#else
+    UNUSED(memory);
+    UNUSED(alignment);
+    return 0;
+#endif
+}
+
+NB_EXTERN void *
+nb_heap_allocator(NB_Allocator_Mode mode, 
+                  s64 size, s64 old_size, 
+                  void *old_memory, 
+                  void *allocator_data) {
+    UNUSED(allocator_data);
+
+    // NB_ALLOCATOR_LARGE_PAGES is ignored, heap blocks can't be backed
+    // by large pages, use nb_os_reserve_large() instead.
+    s64 alignment = nb_allocator_mode_alignment(mode);
+    DWORD flags   = (mode & NB_ALLOCATOR_NO_ZERO) ? 0 : HEAP_ZERO_MEMORY;
+
+    switch (nb_allocator_base_mode(mode)) {
+        case NB_ALLOCATOR_ALLOCATE: {
+            void *result;
+            if (alignment > NB_HEAP_DEFAULT_ALIGNMENT) {
+                result = nb_w32_heap_alloc_aligned(size, alignment, flags);
+            } else {
+                result = HeapAlloc(GetProcessHeap(), flags, (umm)size);
+            }
+
+            if (!result) {
+                nb_heap_stats_fail();
+                return null;
+            }
+
+            nb_heap_stats_add(nb_w32_heap_block_size(result, alignment));
+            return result;
+        } break;
+
+        case NB_ALLOCATOR_RESIZE: {
+            s64 old_block_size = nb_w32_heap_block_size(old_memory, alignment);
+            void *result;
+
+            if (alignment > NB_HEAP_DEFAULT_ALIGNMENT) {
+                result = nb_w32_heap_alloc_aligned(size, alignment, flags);
+
+                if (result && old_memory) {
+                    memcpy(result, old_memory, (umm)nb_min(old_size, size));
+                    nb_w32_heap_free_aligned(old_memory);
+                }
+            } else if (!old_memory) {
+                result = HeapAlloc(GetProcessHeap(), flags, (umm)size);
+            } else {
+                // Grows in place when the heap can, the new tail is zeroed
+                // unless NO_ZERO is passed.
+                result = HeapReAlloc(GetProcessHeap(), flags, old_memory, (umm)size);
+            }
+
+            if (!result) {
+                nb_heap_stats_fail();
+                return null;
+            }
+
+            nb_heap_stats_remove(old_block_size);
+            nb_heap_stats_add(nb_w32_heap_block_size(result, alignment));
+            return result;
+        } break;
+
+        case NB_ALLOCATOR_FREE: {
+            nb_heap_stats_remove(nb_w32_heap_block_size(old_memory, alignment));
+
+            if (alignment > NB_HEAP_DEFAULT_ALIGNMENT) {
+                nb_w32_heap_free_aligned(old_memory);
+                return null;
+            }
+
+            HeapFree(GetProcessHeap(), 0, old_memory);
+            return null;
+        } break;
+
+        case NB_ALLOCATOR_FREE_ALL: {
+            // Not supported.
+            assert(!"Not supported");
+            return null;
+        } break;
+
+        case NB_ALLOCATOR_QUERY_STATS:
+            return nb_heap_query_stats((NB_Allocator_Stats *)old_memory);
+
+        default: {
+            assert(false);
+            return null;
+        } break;
+    }
+}
+
+
+NB_EXTERN void *nb_os_reserve(s64 size) {
+    return VirtualAlloc(null, (SIZE_T)size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+NB_EXTERN bool nb_os_commit(void *memory, s64 size) {
+    void *result = VirtualAlloc(memory, (SIZE_T)size, MEM_COMMIT, PAGE_READWRITE);
+    return (result != null);
+}
+
+NB_EXTERN void nb_os_decommit(void *memory, s64 size) {
+    VirtualFree(memory, (SIZE_T)size, MEM_DECOMMIT);
+}
+
+NB_EXTERN void nb_os_release(void *memory, s64 size) {
+    UNUSED(size);
+    VirtualFree(memory, 0, MEM_RELEASE);
+}
+
+NB_EXTERN s64 nb_os_get_page_size(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (s64)info.dwPageSize;
+}
+
+#if COMPILER_CL
+#pragma comment(lib, "Advapi32.lib")
+#endif
+
+// MEM_LARGE_PAGES needs SeLockMemoryPrivilege, it must be granted to the
+// user ("Lock pages in memory" policy) and enabled in the process token.
+static bool
+nb_w32_enable_lock_memory_privilege(void) {
+    HANDLE token;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES|TOKEN_QUERY, &token)) {
+        return false;
+    }
+
+    bool result = false;
+
+    TOKEN_PRIVILEGES privileges;
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+    if (LookupPrivilegeValueW(null, L"SeLockMemoryPrivilege", &privileges.Privileges[0].Luid)) {
+        // Succeeds even when the privilege is not held, the last error tells.
+        if (AdjustTokenPrivileges(token, FALSE, &privileges, 0, null, null)) {
+            result = (GetLastError() == ERROR_SUCCESS);
+        }
+    }
+
+    CloseHandle(token);
+    return result;
+}
+
+NB_EXTERN s64 nb_os_get_large_page_size(void) {
+    static s64 large_page_size = -1;
+
+    if (large_page_size < 0) {
+        s64 result = 0;
+        if (nb_w32_enable_lock_memory_privilege()) {
+            result = (s64)GetLargePageMinimum();
+        }
+
+        large_page_size = result;
+    }
+
+    return large_page_size;
+}
+
+NB_EXTERN void *nb_os_reserve_large(s64 size, s64 *page_size, bool *committed) {
+    s64 large_page_size = nb_os_get_large_page_size();
+
+    if (large_page_size > 0) {
+        assert((size % large_page_size) == 0);
+
+        // Large pages can't be reserved alone, they are committed
+        // and locked at once.
+        void *result = VirtualAlloc(null, (SIZE_T)size, 
+                                    MEM_RESERVE|MEM_COMMIT|MEM_LARGE_PAGES, 
+                                    PAGE_READWRITE);
+        if (result) {
+            *page_size = large_page_size;
+            *committed = true;
+            return result;
+        }
+    }
+
+    *page_size = nb_os_get_page_size();
+    *committed = false;
+    return nb_os_reserve(size);
+}
+
+#endif  // OS_WINDOWS
+
+
+
+#if OS_LINUX
+
+#include <unistd.h>
+#include <stdlib.h>
+
+void nb_write_string(const char *s, bool to_standard_error) {
+    int handle = to_standard_error ? STDERR_FILENO : STDOUT_FILENO;
+    ssize_t written = write(handle, s, nb_string_length(s));
+    UNUSED(written);
+}
+
+void nb_write_string_count(const char *s, u32 count, bool to_standard_error) {
+    int handle = to_standard_error ? STDERR_FILENO : STDOUT_FILENO;
+    ssize_t written = write(handle, s, count);
+    UNUSED(written);
+}
+
+void nb_write_new_string(NB_String s, bool to_standard_error) {
+    int handle = to_standard_error ? STDERR_FILENO : STDOUT_FILENO;
+    ssize_t written = write(handle, s.data, s.count);
+    UNUSED(written);
+}
+
+static const char *ansi_system_console_text_colors[NB_TEXT_COUNT] = {
+    "\x1b[30m",   // NB_TEXT_BLACK
+    "\x1b[34m",   // NB_TEXT_DARK_BLUE
+    "\x1b[32m",   // NB_TEXT_DARK_GREEN
+    "\x1b[36m",   // NB_TEXT_LIGHT_BLUE
+    "\x1b[31m",   // NB_TEXT_DARK_RED
+    "\x1b[35m",   // NB_TEXT_MAGENTA
+    "\x1b[33m",   // NB_TEXT_ORANGE
+    "\x1b[37m",   // NB_TEXT_LIGHT_GRAY
+    "\x1b[90m",   // NB_TEXT_GRAY
+    "\x1b[94m",   // NB_TEXT_BLUE
+    "\x1b[92m",   // NB_TEXT_GREEN
+    "\x1b[96m",   // NB_TEXT_CYAN
+    "\x1b[91m",   // NB_TEXT_RED
+    "\x1b[95m",   // NB_TEXT_PURPLE
+    "\x1b[93m",   // NB_TEXT_YELLOW
+    "\x1b[97m",   // NB_TEXT_WHITE
+};
+
+NB_EXTERN void 
+nb_set_console_text_color(NB_System_Console_Text_Color color, 
+                          bool to_standard_error) {
+    // Checking if the handle is connected to a terminal.
+    if (isatty(to_standard_error ? STDERR_FILENO : STDOUT_FILENO)) {
+        nb_write_string(ansi_system_console_text_colors[color], to_standard_error);
+    }
+}
+
+NB_EXTERN void 
+nb_set_console_text_color_ansi(NB_System_Console_Text_Color color, 
+                               bool to_standard_error) {
+    nb_write_string(ansi_system_console_text_colors[color], to_standard_error);
+}
+
+
+#include <stdio.h>
+
+
+NB_EXTERN bool 
+nb_abort_error_message(const char *title, 
+                       const char *message, 
+                       const char *details) {
+    UNUSED(title);
+    UNUSED(message);
+    UNUSED(details);
+
+    fflush(stderr);
+    return true;
+}
+
+#if NB_ENABLE_ASSERTS
+
+#include <execinfo.h>
+#include <inttypes.h>
+
+NB_EXTERN char *nb_get_stacktrace(void) {
+    char *result = null;
+
+    // @Note: to print the stack, compile with -rdynamic.
+    const int MAX_STACK_FRAMES = 64;
+    void *stack[MAX_STACK_FRAMES];
+
+    int frames = backtrace(stack, MAX_STACK_FRAMES);
+    if (frames > 0) {
+        // Lines are appended in scratch memory, only the final
+        // string goes to the temporary storage.
+        NB_Scratch scratch = nb_get_scratch(null, 0);
+
+        NB_Small_String lines;
+        nb_small_string_init(&lines, nb_scratch_allocator(scratch));
+        nb_small_string_append_cstring(&lines, "Caller stack:\n");
+
+        char **symbols = backtrace_symbols(stack, frames);
+        if (symbols) {
+            for (int index = 0; index < frames; index++) {
+                void *stack_address = stack[index];
+
+                // @Todo: line numbers...
+                s64 stack_line = 0;
+                s64 call_line  = 0;
+
+#if COMPILER_GCC
+                nb_small_string_print(&lines, "0x%016zu: %s(%ld) Line %ld\n", 
+                                      (size_t)stack_address, 
+                                      symbols[index], 
+                                      stack_line, call_line);
+#else
+                nb_small_string_print(&lines, "0x%016" PRIXPTR ": %s(%" PRId64 ") Line %" PRId64 "\n", 
+                                      (size_t)stack_address, 
+                                      symbols[index], 
+                                      stack_line, call_line);
+#endif
+            }
+
+            free(symbols);
+        }
+
+        result = tprint("%s", nb_small_string_cstring(&lines));
+        nb_release_scratch(scratch);
+    }
+
+    return result;
+}
+
+#endif  // NB_ENABLE_ASSERTS
+
+
+#include <sys/mman.h>
+#include <malloc.h>
+
+// The _DEFAULT_SOURCE define at the top of this file came too late if a
+// system header was included first under strict -std=c99/c11.
+#ifndef MAP_ANONYMOUS
+#error "nb.h: MAP_ANONYMOUS is not declared, include nb.h first or define _DEFAULT_SOURCE"
+#endif
+
+typedef struct NB_Linux_Huge_Pages {
+    bool queried;
+    bool transparent;    // THP not disabled, MADV_HUGEPAGE may work.
+    s64  page_size;      // "Hugepagesize" in /proc/meminfo.
+    s64  hugetlb_total;  // Pages preallocated for MAP_HUGETLB.
+} NB_Linux_Huge_Pages;
+
+static NB_Linux_Huge_Pages nb_linux_huge_pages;
+
+static NB_Linux_Huge_Pages *
+nb_linux_get_huge_pages(void) {
+    NB_Linux_Huge_Pages *info = &nb_linux_huge_pages;
+    if (info->queried) return info;
+
+    char line[128];
+
+    FILE *file = fopen("/proc/meminfo", "r");
+    if (file) {
+        while (fgets(line, size_of(line), file)) {
+            long value;
+            if (sscanf(line, "Hugepagesize: %ld kB", &value) == 1) {
+                info->page_size = (s64)value * 1024;
+            } else if (sscanf(line, "HugePages_Total: %ld", &value) == 1) {
+                info->hugetlb_total = (s64)value;
+            }
+        }
+
+        fclose(file);
+    }
+
+    // "always [madvise] never", the bracketed one is active.
+    file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (file) {
+        if (fgets(line, size_of(line), file)) {
+            info->transparent = (strstr(line, "[never]") == null);
+        }
+
+        fclose(file);
+    }
+
+#ifndef MADV_HUGEPAGE
+    info->transparent = false;
+#endif
+
+    info->queried = true;
+    return info;
+}
+
+NB_INLINE s64 nb_linux_heap_block_size(void *memory) {
+#if NB_HEAP_STATS
+    return memory ? (s64)malloc_usable_size(memory) : 0;
+#else
+    UNUSED(memory);
+    return 0;
+#endif
+}
+
+// Only the full large pages of the block are advised, the block is
+// aligned to the large page size so that there is no head to skip.
+static void
+nb_linux_advise_huge_pages(void *memory, s64 size, s64 large_page_size) {
+#ifdef MADV_HUGEPAGE
+    s64 advised_size = size & ~(large_page_size - 1);
+    if (advised_size > 0) madvise(memory, (size_t)advised_size, MADV_HUGEPAGE);
+#else
+    UNUSED(memory);
+    UNUSED(size);
+    UNUSED(large_page_size);
+#endif
+}
+
+NB_EXTERN void *
+nb_heap_allocator(NB_Allocator_Mode mode, 
+                  s64 size, s64 old_size, 
+                  void *old_memory, 
+                  void *allocator_data) {
+    UNUSED(allocator_data);
+
+    s64 alignment = nb_allocator_mode_alignment(mode);
+    bool zero     = (mode & NB_ALLOCATOR_ZERO) != 0;
+
+    // Blocks spanning at least one large page start on a large page
+    // boundary, smaller ones ignore the hint.
+    s64 large_page_size = 0;
+    if (mode & NB_ALLOCATOR_LARGE_PAGES) {
+        NB_Linux_Huge_Pages *info = nb_linux_get_huge_pages();
+        if (info->transparent && (info->page_size > 0) && (size >= info->page_size)) {
+            large_page_size = info->page_size;
+            alignment = nb_max(alignment, large_page_size);
+        }
+    }
+
+    switch (nb_allocator_base_mode(mode)) {
+        case NB_ALLOCATOR_ALLOCATE: {
+            void *result = null;
+
+            if (alignment > NB_HEAP_DEFAULT_ALIGNMENT) {
+                if (posix_memalign(&result, (umm)alignment, (umm)size) != 0) result = null;
+
+                // Advised before the first touch, so the faults
+                // already get large pages.
+                if (result && large_page_size) nb_linux_advise_huge_pages(result, size, large_page_size);
+
+                if (result && zero) memset(result, 0, (umm)size);
+            } else if (zero) {
+                // @Todo: mmap?
+                result = calloc(1, (umm)size);
+            } else {
+                result = malloc((umm)size);
+            }
+
+            if (!result) {
+                nb_heap_stats_fail();
+                return null;
+            }
+
+            nb_heap_stats_add(nb_linux_heap_block_size(result));
+            return result;
+        } break;
+
+        case NB_ALLOCATOR_RESIZE: {
+            s64 old_block_size = nb_linux_heap_block_size(old_memory);
+            void *result;
+
+            if (alignment > NB_HEAP_DEFAULT_ALIGNMENT) {
+                // realloc does not keep the alignment.
+                if (posix_memalign(&result, (umm)alignment, (umm)size) != 0) {
+                    nb_heap_stats_fail();
+                    return null;
+                }
+
+                if (large_page_size) nb_linux_advise_huge_pages(result, size, large_page_size);
+
+                if (old_memory) {
+                    memcpy(result, old_memory, (umm)nb_min(old_size, size));
+                    free(old_memory);
+                }
+            } else {
+                // realloc grows in place when it can, and glibc uses
+                // mremap for the large mmap'ed blocks, so no copy either.
+                result = realloc(old_memory, (umm)size);
+                if (!result) {
+                    nb_heap_stats_fail();
+                    return null;
+                }
+            }
+
+            nb_heap_stats_remove(old_block_size);
+            nb_heap_stats_add(nb_linux_heap_block_size(result));
+
+            if (!old_memory) old_size = 0;
+            if (zero && (size > old_size)) {
+                memset((u8 *)result + old_size, 0, (umm)(size - old_size));
+            }
+
+            return result;
+        } break;
+
+        case NB_ALLOCATOR_FREE: {
+            nb_heap_stats_remove(nb_linux_heap_block_size(old_memory));
+            free(old_memory);
+            return null;
+        } break;
+
+        case NB_ALLOCATOR_FREE_ALL: {
+            // Not supported.
+            assert(!"Not supported");
+            return null;
+        } break;
+
+        case NB_ALLOCATOR_QUERY_STATS:
+            return nb_heap_query_stats((NB_Allocator_Stats *)old_memory);
+
+        default: {
+            assert(false);
+            return null;
+        } break;
+    }
+    return null;
+}
+
+
+NB_EXTERN void *nb_os_reserve(s64 size) {
+    void *result = mmap(null, (size_t)size, PROT_NONE,
+                        MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (result == MAP_FAILED) return null;
+
+    return result;
+}
+
+NB_EXTERN bool nb_os_commit(void *memory, s64 size) {
+    int status = mprotect(memory, (size_t)size, PROT_READ|PROT_WRITE);
+    return (status == 0);
+}
+
+NB_EXTERN void nb_os_decommit(void *memory, s64 size) {
+    // Give the pages back to the OS but keep the range reserved.
+    madvise(memory, (size_t)size, MADV_DONTNEED);
+    mprotect(memory, (size_t)size, PROT_NONE);
+}
+
+NB_EXTERN void nb_os_release(void *memory, s64 size) {
+    munmap(memory, (size_t)size);
+}
+
+NB_EXTERN s64 nb_os_get_page_size(void) {
+    return (s64)sysconf(_SC_PAGESIZE);
+}
+
+NB_EXTERN s64 nb_os_get_large_page_size(void) {
+    NB_Linux_Huge_Pages *info = nb_linux_get_huge_pages();
+    if (!info->transparent && (info->hugetlb_total <= 0)) return 0;
+
+    return info->page_size;
+}
+
+NB_EXTERN void *nb_os_reserve_large(s64 size, s64 *page_size, bool *committed) {
+    NB_Linux_Huge_Pages *info = nb_linux_get_huge_pages();
+    s64 large_page_size = nb_os_get_large_page_size();
+
+    UNUSED(info);
+
+    *page_size = nb_os_get_page_size();
+    *committed = false;
+
+    if (large_page_size <= 0) return nb_os_reserve(size);
+    assert((size % large_page_size) == 0);
+
+#ifdef MAP_HUGETLB
+    if (info->hugetlb_total > 0) {
+        // The pages come from the preallocated pool and are reserved
+        // by mmap, it fails when the pool is too small.
+        void *result = mmap(null, (size_t)size, PROT_READ|PROT_WRITE,
+                            MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+        if (result != MAP_FAILED) {
+            *page_size = large_page_size;
+            *committed = true;
+            return result;
+        }
+    }
+#endif
+
+#ifdef MADV_HUGEPAGE
+    if (info->transparent) {
+        // Huge pages only back aligned extents, over-reserve and trim
+        // the range to the large page size.
+        s64 padded_size = size + large_page_size;
+        u8 *memory = (u8 *)nb_os_reserve(padded_size);
+        if (!memory) return null;
+
+        u8 *result = nb_align_forward_pointer(memory, large_page_size);
+        s64 head = result - memory;
+        s64 tail = padded_size - head - size;
+
+        if (head > 0) munmap(memory, (size_t)head);
+        if (tail > 0) munmap(result + size, (size_t)tail);
+
+        if (madvise(result, (size_t)size, MADV_HUGEPAGE) == 0) {
+            *page_size = large_page_size;
+        }
+
+        return result;
+    }
+#endif
+
+    return nb_os_reserve(size);
+}
+
+#endif  // OS_LINUX
+
+
+
+#define NB_TS_BLOCK_HEADER_SIZE nb_align_forward(size_of(NB_Temporary_Storage_Block), 16)
+
+static bool
+nb_temporary_storage_push_block(NB_Temporary_Storage *ts, s64 nbytes) {
+    NB_Temporary_Storage_Block *block = null;
+
+    // Recycle a released block if one is big enough.
+    NB_Temporary_Storage_Block **it = &ts->free_blocks;
+    while (*it) {
+        if ((*it)->size >= nbytes) {
+            block = *it;
+            *it = block->previous;
+            break;
+        }
+
+        it = &(*it)->previous;
+    }
+
+    if (!block) {
+        // Double the chained blocks, so a buffer growing by resizes is
+        // copied a logarithmic number of times, not once per block.
+        s64 block_size = nb_max(ts->size, nbytes);
+        if (ts->overflow) block_size = nb_max(block_size, 2 * ts->overflow->size);
+
+        block = (NB_Temporary_Storage_Block *)ts->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_ALLOCATE, NB_ALLOCATOR_NO_ZERO), 
+                                                                 NB_TS_BLOCK_HEADER_SIZE + block_size, 0, 
+                                                                 null, 
+                                                                 ts->allocator.data);
+        if (!block) return false;
+
+        block->size = block_size;
+    }
+
+    block->start    = ts->occupied;
+    block->previous = ts->overflow;
+    ts->overflow    = block;
+    return true;
+}
+
+static void
+nb_temporary_storage_free_block_list(NB_Temporary_Storage *ts, NB_Temporary_Storage_Block *block) {
+    while (block) {
+        NB_Temporary_Storage_Block *previous = block->previous;
+        ts->allocator.proc(NB_ALLOCATOR_FREE, 0, 0, block, ts->allocator.data);
+        block = previous;
+    }
+}
+
+NB_EXTERN void *
+nb_talloc(NB_Temporary_Storage *ts, s64 nbytes) {
+    assert(ts->allocator.proc != null);
+
+    if (!ts->data) {
+        if (!ts->size) ts->size = NB_TS_SIZE_DEFAULT;
+
+        ts->data = (u8 *)ts->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_ALLOCATE, NB_ALLOCATOR_NO_ZERO), 
+                                            ts->size, 0, 
+                                            null, 
+                                            ts->allocator.data);
+        if (!ts->data) {
+            ts->failed_count += 1;
+            return null;
+        }
+    }
+
+    NB_Temporary_Storage_Block *block = ts->overflow;
+    s64 end = block ? (block->start + block->size) : ts->size;
+
+    if (nbytes > (end - ts->occupied)) {
+        if (!nb_temporary_storage_push_block(ts, nbytes)) {
+            ts->failed_count += 1;
+            return null;
+        }
+
+        block = ts->overflow;
+    }
+
+    u8 *result;
+    if (block) {
+        result = (u8 *)block + NB_TS_BLOCK_HEADER_SIZE + (ts->occupied - block->start);
+    } else {
+        result = ts->data + ts->occupied;
+    }
+
+    ts->occupied += nbytes;
+    if (ts->occupied > ts->high_water_mark) {
+        ts->high_water_mark = ts->occupied;
+    }
+
+    ts->allocation_count += 1;
+    return result;
+}
+
+NB_EXTERN void
+nb_temporary_storage_release_blocks(NB_Temporary_Storage *ts, s64 mark) {
+    // Blocks chained after the mark are empty once we rewind to it.
+    while (ts->overflow && (ts->overflow->start >= mark)) {
+        NB_Temporary_Storage_Block *block = ts->overflow;
+        ts->overflow = block->previous;
+
+        block->previous = ts->free_blocks;
+        ts->free_blocks = block;
+    }
+}
+
+NB_EXTERN void
+nb_temporary_storage_reset(NB_Temporary_Storage *ts) {
+    nb_temporary_storage_release_blocks(ts, 0);
+    ts->occupied = 0;
+
+    if (ts->high_water_mark > ts->peak_bytes) {
+        ts->peak_bytes = ts->high_water_mark;
+    }
+
+    if (ts->high_water_mark > ts->size) {
+        // Grow the base block so the next frames fit without chaining.
+        s64 new_size = nb_align_forward(ts->high_water_mark, NB_KB(4));
+
+#if NB_DEBUG
+        u32 old_mode = nb_logger_push_mode(NB_LOG_WARNING);
+        const char *old_ident = nb_logger_push_ident("Temporary_Storage");
+
+#if OS_WINDOWS && COMPILER_GCC
+        Log("Growing the base block to the highest water mark: %I64d", 
+            new_size);
+#else
+        Log("Growing the base block to the highest water mark: %" PRId64, 
+            new_size);
+#endif
+
+        nb_logger_push_mode(old_mode);
+        nb_logger_push_ident(old_ident);
+#endif // NB_DEBUG
+
+        nb_temporary_storage_free_block_list(ts, ts->free_blocks);
+        ts->free_blocks = null;
+
+        if (ts->data) {
+            ts->allocator.proc(NB_ALLOCATOR_FREE, 0, 0, ts->data, ts->allocator.data);
+            ts->data = null;
+        }
+
+        ts->size = new_size;
+    }
+
+    ts->high_water_mark = 0;
+}
+
+NB_EXTERN void *
+nb_talloc_align(NB_Temporary_Storage *ts, s64 size, s64 alignment) {
+    assert(nb_is_power_of_2(alignment));
+
+    s64 nbytes = size;
+
+    s64 extra = (alignment - (nbytes % alignment)) % alignment;
+    nbytes += extra;
+
+    if (!ts->allocator.proc) {
+        ts->allocator.proc = nb_heap_allocator;
+        ts->allocator.data = null;
+    }
+
+    // Pad up to the alignment from the current top, or assume the worst
+    // case when the storage is not allocated yet or a block gets chained.
+    // Small alignments too: nb_talloc() hands out odd sizes unpadded.
+    s64 padding = alignment;
+    if (ts->data) {
+        NB_Temporary_Storage_Block *block = ts->overflow;
+        u8 *top;
+        s64 end;
+        if (block) {
+            top = (u8 *)block + NB_TS_BLOCK_HEADER_SIZE + (ts->occupied - block->start);
+            end = block->start + block->size;
+        } else {
+            top = ts->data + ts->occupied;
+            end = ts->size;
+        }
+
+        if ((nbytes + alignment) <= (end - ts->occupied)) {
+            padding = nb_align_forward_pointer(top, alignment) - top;
+        }
+    }
+
+    u8 *result = (u8 *)nb_talloc(ts, padding + nbytes);
+    if (!result) return null;
+
+    return nb_align_forward_pointer(result, alignment);
+}
+
+NB_EXTERN NB_ALLOCATOR_PROC(nb_temporary_storage_proc) {
+    NB_Temporary_Storage *ts = allocator_data ? (NB_Temporary_Storage *)allocator_data : &nb_temporary_storage;
+
+    if (!ts->allocator.proc) {
+        ts->allocator.proc = nb_heap_allocator;
+        ts->allocator.data = null;
+    }
+
+    s64 nbytes = size;
+    s64 alignment = 8;
+
+    s64 extra = (alignment - (nbytes % alignment)) % alignment;
+    nbytes += extra;
+
+    if (nb_allocator_mode_alignment(mode) > alignment) {
+        alignment = nb_allocator_mode_alignment(mode);
+    }
+
+    switch (nb_allocator_base_mode(mode)) {
+        case NB_ALLOCATOR_ALLOCATE: {
+/*
+            if (!ts->data) {
+                if (!ts->size) ts->size = NB_TS_SIZE_DEFAULT;
+
+                ts->data = (u8 *)ts->allocator.proc(NB_ALLOCATOR_ALLOCATE, 
+                                                    ts->size, 0, 
+                                                    null, 
+                                                    ts->allocator.data);
+                if (!ts->data) return null;
+            }
+
+#if NB_DEBUG
+            if (nbytes > (ts->size - ts->occupied)) {
+                ts->high_water_mark += nbytes;
+
+                u32 old_mode = nb_logger_push_mode(NB_LOG_WARNING);
+                const char *old_ident = nb_logger_push_ident("Temporary_Storage");
+
+#if OS_WINDOWS && COMPILER_GCC
+                Log("Attempting to allocate from the heap, highest water mark: %I64d\n", 
+                    ts->high_water_mark);
+#else
+                Log("Attempting to allocate from the heap, highest water mark: %" PRId64 "\n", 
+                    ts->high_water_mark);
+#endif
+
+                nb_logger_push_mode(old_mode);
+                nb_logger_push_ident(old_ident);
+                return nb_heap_allocator(NB_ALLOCATOR_ALLOCATE, nbytes, 0, null, null);
+            }
+#else
+            // @Cleanup:
+            assert(nbytes <= (ts->size - ts->occupied));
+#endif
+
+            void *result = ts->data + ts->occupied;
+            ts->occupied += nbytes;
+            return result;
+*/
+            // A plain nb_talloc of an odd size may have left the top unaligned.
+            void *result = nb_talloc_align(ts, nbytes, alignment);
+
+            if (result && (mode & NB_ALLOCATOR_ZERO)) {
+                memset(result, 0, (umm)size);
+            }
+
+            return result;
+        } break;
+
+        case NB_ALLOCATOR_RESIZE: {
+            // Bump allocators do not resize so we allocate
+            // a new chunk of memory using the new size.
+
+
+/*
+            // @Cutnpaste: from ALLOCATOR_ALLOCATE.
+#if NB_DEBUG
+            if (nbytes > (ts->size - ts->occupied)) {
+                ts->high_water_mark += nbytes;
+
+                u32 old_mode = nb_logger_push_mode(NB_LOG_WARNING);
+                const char *old_ident = nb_logger_push_ident("Temporary_Storage");
+
+#if OS_WINDOWS && COMPILER_GCC
+                Log("Attempting to allocate from the heap, highest water mark: %I64d\n", 
+                    ts->high_water_mark);
+#else
+                Log("Attempting to allocate from the heap, highest water mark: %" PRId64 "\n", 
+                    ts->high_water_mark);
+#endif
+
+                nb_logger_push_mode(old_mode);
+                nb_logger_push_ident(old_ident);
+                return nb_heap_allocator(NB_ALLOCATOR_ALLOCATE, nbytes, 0, null, null);
+            }
+#else
+            // @Cleanup:
+            assert(nbytes <= (ts->size - ts->occupied));
+#endif
+
+            void *result = ts->data + ts->occupied;
+            ts->occupied += nbytes;
+*/
+
+            if (old_memory && ts->data) {
+                // Extend the last allocation in place.
+                s64 old_nbytes = nb_align_forward(old_size, 8);
+
+                NB_Temporary_Storage_Block *block = ts->overflow;
+                u8 *top;
+                s64 end;
+                if (block) {
+                    top = (u8 *)block + NB_TS_BLOCK_HEADER_SIZE + (ts->occupied - block->start);
+                    end = block->start + block->size;
+                } else {
+                    top = ts->data + ts->occupied;
+                    end = ts->size;
+                }
+
+                if (((u8 *)old_memory + old_nbytes == top) &&
+                    ((nbytes - old_nbytes) <= (end - ts->occupied))) {
+                    ts->occupied += nbytes - old_nbytes;
+                    if (ts->occupied > ts->high_water_mark) {
+                        ts->high_water_mark = ts->occupied;
+                    }
+
+                    if ((mode & NB_ALLOCATOR_ZERO) && (size > old_size)) {
+                        memset((u8 *)old_memory + old_size, 0, (umm)(size - old_size));
+                    }
+
+                    return old_memory;
+                }
+            }
+
+            void *result = nb_talloc_align(ts, nbytes, alignment);
+            if (!result) return null;
+
+            if (!old_memory) old_size = 0;
+            if (old_size > 0) {
+                memcpy(result, old_memory, (umm)nb_min(old_size, nbytes));
+            }
+
+            if ((mode & NB_ALLOCATOR_ZERO) && (size > old_size)) {
+                memset((u8 *)result + old_size, 0, (umm)(size - old_size));
+            }
+
+            return result;
+        } break;
+
+        case NB_ALLOCATOR_FREE:
+            // Not supported.
+            assert(false);
+            return null;
+
+        case NB_ALLOCATOR_FREE_ALL: {
+            nb_temporary_storage_free_block_list(ts, ts->overflow);
+            nb_temporary_storage_free_block_list(ts, ts->free_blocks);
+            ts->overflow    = null;
+            ts->free_blocks = null;
+
+            ts->allocator.proc(NB_ALLOCATOR_FREE, 0, 0, ts->data, ts->allocator.data);
+            ts->data = null;
+            ts->size = 0;
+            ts->occupied = 0;
+
+            if (ts->high_water_mark > ts->peak_bytes) {
+                ts->peak_bytes = ts->high_water_mark;
+            }
+            ts->high_water_mark = 0;
+            return null;
+        } break;
+
+        case NB_ALLOCATOR_QUERY_STATS: {
+            NB_Allocator_Stats *stats = (NB_Allocator_Stats *)old_memory;
+
+            stats->live_bytes       = ts->occupied;
+            stats->peak_bytes       = nb_max(ts->peak_bytes, ts->high_water_mark);
+            stats->allocation_count = ts->allocation_count;
+            stats->failed_count     = ts->failed_count;
+
+            // The free space is the end of the current block, and the
+            // released blocks waiting to be recycled.
+            NB_Temporary_Storage_Block *block = ts->overflow;
+            s64 end = block ? (block->start + block->size) : ts->size;
+
+            s64 free_bytes   = ts->data ? (end - ts->occupied) : 0;
+            s64 largest_free = free_bytes;
+            s64 reserved     = ts->data ? ts->size : 0;
+
+            for (; block; block = block->previous) reserved += block->size;
+
+            for (block = ts->free_blocks; block; block = block->previous) {
+                reserved     += block->size;
+                free_bytes   += block->size;
+                largest_free  = nb_max(largest_free, block->size);
+            }
+
+            stats->reserved_bytes = reserved;
+            stats->fragmentation  = nb_allocator_fragmentation(free_bytes, largest_free);
+            return stats;
+        } break;
+
+        default:
+            assert(false);
+            return null;
+    }
+}
+
+
+
+NB_EXTERN bool
+nb_arena_init(NB_Arena *arena, s64 reserve_size) {
+    assert(arena->base == null);
+
+    s64 page_size = nb_os_get_page_size();
+    bool committed = false;
+
+    if (arena->flags & NB_ARENA_LARGE_PAGES) {
+        page_size = nb_max(page_size, nb_os_get_large_page_size());
+        reserve_size = nb_align_forward(reserve_size, page_size);
+
+        arena->base = (u8 *)nb_os_reserve_large(reserve_size, &page_size, &committed);
+    } else {
+        reserve_size = nb_align_forward(reserve_size, page_size);
+
+        arena->base = (u8 *)nb_os_reserve(reserve_size);
+    }
+
+    if (!arena->base) return false;
+
+    arena->reserved  = reserve_size;
+    arena->committed = committed ? reserve_size : 0;
+    arena->occupied  = 0;
+    arena->high_water_mark = 0;
+    arena->page_size = page_size;
+    return true;
+}
+
+NB_EXTERN bool
+nb_arena_init_ex(NB_Arena *arena, s64 reserve_size, u32 flags) {
+    arena->flags = flags;
+    return nb_arena_init(arena, reserve_size);
+}
+
+NB_EXTERN void
+nb_arena_release(NB_Arena *arena) {
+    if (arena->base) {
+        nb_os_release(arena->base, arena->reserved);
+    }
+
+    u32 flags = arena->flags;
+    nb_memory_zero_struct(arena);
+    arena->flags = flags;
+}
+
+// Commits the pages up to 'end' and moves the arena top there.
+static bool
+nb_arena_commit_up_to(NB_Arena *arena, s64 end) {
+    if (end > arena->reserved) {
+#if NB_DEBUG
+        nb_log_print(NB_LOG_WARNING, "Arena", "Out of reserved memory.");
+#endif
+        return false;
+    }
+
+    if (end > arena->committed) {
+        // Commits whole large pages, a transparent huge page is only
+        // used once its entire extent is accessible.
+        s64 commit_size = nb_max(arena->page_size, (s64)NB_ARENA_COMMIT_SIZE);
+        s64 commit_end  = nb_align_forward(end, commit_size);
+        if (commit_end > arena->reserved) commit_end = arena->reserved;
+
+        if (!nb_os_commit(arena->base + arena->committed, commit_end - arena->committed)) {
+            return false;
+        }
+
+        arena->committed = commit_end;
+    }
+
+    arena->occupied = end;
+    if (arena->occupied > arena->high_water_mark) {
+        arena->high_water_mark = arena->occupied;
+    }
+
+    return true;
+}
+
+NB_EXTERN void *
+nb_arena_alloc_align(NB_Arena *arena, s64 size, s64 alignment) {
+    assert(size >= 0);
+    assert(nb_is_power_of_2(alignment));
+
+    if (!arena->base) {
+        // Large page arenas come from nb_arena_init_ex(), a lazy reserve
+        // would pin NB_ARENA_RESERVE_DEFAULT of physical memory.
+        assert(!(arena->flags & NB_ARENA_LARGE_PAGES));
+
+        if ((arena->flags & NB_ARENA_LARGE_PAGES) ||
+            !nb_arena_init(arena, NB_ARENA_RESERVE_DEFAULT)) {
+            arena->failed_count += 1;
+            return null;
+        }
+    }
+
+    // The base is page aligned, so aligning the offset aligns the address.
+    s64 start = nb_align_forward(arena->occupied, alignment);
+    s64 end   = start + size;
+
+    if (!nb_arena_commit_up_to(arena, end)) {
+        arena->failed_count += 1;
+        return null;
+    }
+
+    arena->allocation_count += 1;
+    return arena->base + start;
+}
+
+// Adds to 'stats', so the frame storage can sum its arenas.
+static void
+nb_arena_add_stats(NB_Arena *arena, NB_Allocator_Stats *stats) {
+    // The free memory is the contiguous end of the range.
+    stats->live_bytes       += arena->occupied;
+    stats->peak_bytes       += arena->high_water_mark;
+    stats->allocation_count += arena->allocation_count;
+    stats->failed_count     += arena->failed_count;
+    stats->reserved_bytes   += arena->committed;
+}
+
+NB_EXTERN void *
+nb_arena_alloc(NB_Arena *arena, s64 size) {
+    return nb_arena_alloc_align(arena, size, 8);
+}
+
+NB_EXTERN NB_ALLOCATOR_PROC(nb_arena_proc) {
+    NB_Arena *arena = (NB_Arena *)allocator_data;
+    assert(arena != null);
+
+    s64 alignment = nb_max(nb_allocator_mode_alignment(mode), 8);
+    bool zero     = (mode & NB_ALLOCATOR_ZERO) != 0;
+
+    // Bytes past the high water mark were never handed out, the
+    // freshly committed pages are already zero.
+    s64 dirty_end = arena->high_water_mark;
+
+    switch (nb_allocator_base_mode(mode)) {
+        case NB_ALLOCATOR_ALLOCATE: {
+            u8 *result = (u8 *)nb_arena_alloc_align(arena, size, alignment);
+
+            if (result && zero) {
+                s64 start = result - arena->base;
+                if (start < dirty_end) {
+                    memset(result, 0, (umm)(nb_min(start + size, dirty_end) - start));
+                }
+            }
+
+            return result;
+        } break;
+
+        case NB_ALLOCATOR_RESIZE: {
+            if (!old_memory) old_size = 0;
+
+            u8 *result = (u8 *)old_memory;
+
+            if (old_memory && ((u8 *)old_memory + old_size == arena->base + arena->occupied)) {
+                // Last allocation, extend it in place.
+                s64 start = (u8 *)old_memory - arena->base;
+                if (!nb_arena_commit_up_to(arena, start + size)) {
+                    arena->failed_count += 1;
+                    return null;
+                }
+            } else {
+                result = (u8 *)nb_arena_alloc_align(arena, size, alignment);
+                if (!result) return null;
+
+                if (old_size > 0) {
+                    memcpy(result, old_memory, (umm)nb_min(old_size, size));
+                }
+            }
+
+            if (zero && (size > old_size)) {
+                s64 start = (result + old_size) - arena->base;
+                if (start < dirty_end) {
+                    memset(result + old_size, 0, (umm)(nb_min(start + (size - old_size), dirty_end) - start));
+                }
+            }
+
+            return result;
+        } break;
+
+        case NB_ALLOCATOR_FREE:
+            // Individual frees are ignored.
+            return null;
+
+        case NB_ALLOCATOR_FREE_ALL:
+            nb_reset_arena(arena);
+            return null;
+
+        case NB_ALLOCATOR_QUERY_STATS:
+            nb_arena_add_stats(arena, (NB_Allocator_Stats *)old_memory);
+            return old_memory;
+
+        default:
+            assert(false);
+            return null;
+    }
+}
+
+
+
+NB_INLINE s32 nb_frame_storage_get_buffer_count(NB_Frame_Storage *fs) {
+    if (fs->buffer_count <= 0) return NB_FRAME_BUFFER_COUNT;
+    return fs->buffer_count;
+}
+
+NB_EXTERN void
+nb_frame_storage_init(NB_Frame_Storage *fs, s32 buffer_count, s64 reserve_size) {
+    assert(buffer_count <= NB_FRAME_BUFFER_COUNT);
+
+    nb_memory_zero_struct(fs);
+    fs->buffer_count = buffer_count;
+    fs->reserve_size = reserve_size;
+}
+
+NB_EXTERN void
+nb_frame_storage_release(NB_Frame_Storage *fs) {
+    for (s32 index = 0; index < NB_FRAME_BUFFER_COUNT; ++index) {
+        nb_arena_release(fs->arenas + index);
+    }
+
+    fs->current = 0;
+    fs->frame_index = 0;
+}
+
+static NB_Arena *
+nb_frame_storage_get_arena(NB_Frame_Storage *fs) {
+    NB_Arena *arena = fs->arenas + fs->current;
+
+    if (!arena->base) {
+        s64 reserve_size = fs->reserve_size;
+        if (!reserve_size) reserve_size = NB_FRAME_STORAGE_RESERVE_DEFAULT;
+
+        if (!nb_arena_init(arena, reserve_size)) return null;
+    }
+
+    return arena;
+}
+
+NB_EXTERN void *
+nb_frame_storage_alloc(NB_Frame_Storage *fs, s64 size, s64 alignment) {
+    NB_Arena *arena = nb_frame_storage_get_arena(fs);
+    if (!arena) return null;
+
+    return nb_arena_alloc_align(arena, size, alignment);
+}
+
+NB_EXTERN void
+nb_frame_storage_advance(NB_Frame_Storage *fs) {
+    fs->current = (fs->current + 1) % nb_frame_storage_get_buffer_count(fs);
+    fs->frame_index += 1;
+
+    // The oldest frame is done, its memory gets reused.
+    nb_reset_arena(fs->arenas + fs->current);
+}
+
+NB_EXTERN NB_ALLOCATOR_PROC(nb_frame_storage_proc) {
+    NB_Frame_Storage *fs = allocator_data ? (NB_Frame_Storage *)allocator_data : &nb_frame_storage;
+
+    if (nb_allocator_base_mode(mode) == NB_ALLOCATOR_FREE_ALL) {
+        for (s32 index = 0; index < NB_FRAME_BUFFER_COUNT; ++index) {
+            nb_reset_arena(fs->arenas + index);
+        }
+
+        return null;
+    }
+
+    if (nb_allocator_base_mode(mode) == NB_ALLOCATOR_QUERY_STATS) {
+        // Every frame in flight is live.
+        for (s32 index = 0; index < NB_FRAME_BUFFER_COUNT; ++index) {
+            nb_arena_add_stats(fs->arenas + index, (NB_Allocator_Stats *)old_memory);
+        }
+
+        return old_memory;
+    }
+
+    NB_Arena *arena = nb_frame_storage_get_arena(fs);
+    if (!arena) return null;
+
+    // Memory from the previous frames is not the top of the current
+    // arena, so resizing it copies into the current frame.
+    return nb_arena_proc(mode, size, old_size, old_memory, arena);
+}
+
+NB_EXTERN void
+nb_frame_advance(void) {
+    nb_frame_storage_advance(&nb_frame_storage);
+}
+
+NB_EXTERN void *
+nb_falloc(s64 size) {
+    return nb_frame_storage_alloc(&nb_frame_storage, size, 8);
+}
+
+
+
+NB_EXTERN NB_Scratch
+nb_get_scratch(NB_Arena **conflicts, s32 conflict_count) {
+    NB_Scratch result;
+    result.arena = null;
+    result.mark  = 0;
+
+    for (s32 index = 0; index < NB_SCRATCH_ARENA_COUNT; ++index) {
+        NB_Arena *arena = nb_scratch_arenas + index;
+
+        bool is_conflicting = false;
+        for (s32 conflict_index = 0; conflict_index < conflict_count; ++conflict_index) {
+            if (conflicts[conflict_index] == arena) {
+                is_conflicting = true;
+                break;
+            }
+        }
+
+        if (!is_conflicting) {
+            result.arena = arena;
+            result.mark  = arena->occupied;
+            break;
+        }
+    }
+
+    // Raise NB_SCRATCH_ARENA_COUNT past the number of conflicts.
+    assert(result.arena != null);
+    return result;
+}
+
+NB_EXTERN void
+nb_release_scratch(NB_Scratch scratch) {
+    nb_set_arena_mark(scratch.arena, scratch.mark);
+}
+
+
+
+NB_EXTERN void
+nb_pool_init(NB_Pool *pool,
+             s64 slot_size, s64 alignment,
+             s64 slots_per_slab,
+             NB_Allocator allocator) {
+    assert(slot_size > 0);
+
+    if (alignment < (s64)size_of(void *)) alignment = size_of(void *);
+    assert(nb_is_power_of_2(alignment));
+
+    if (slots_per_slab <= 0) slots_per_slab = NB_POOL_SLOTS_PER_SLAB_DEFAULT;
+
+    nb_memory_zero_struct(pool);
+
+    // Free slots store the next pointer in place.
+    pool->slot_size      = nb_align_forward(nb_max(slot_size, (s64)size_of(void *)), alignment);
+    pool->alignment      = alignment;
+    pool->slots_per_slab = slots_per_slab;
+    pool->allocator      = allocator;
+
+    if (!pool->allocator.proc) {
+        pool->allocator.proc = nb_heap_allocator;
+        pool->allocator.data = null;
+    }
+}
+
+NB_EXTERN void
+nb_pool_release(NB_Pool *pool) {
+    NB_Pool_Slab *slab = pool->slabs;
+    while (slab) {
+        NB_Pool_Slab *next = slab->next;
+        pool->allocator.proc(NB_ALLOCATOR_FREE, 0, 0, slab, pool->allocator.data);
+        slab = next;
+    }
+
+    pool->free_list    = null;
+    pool->slabs        = null;
+    pool->current_slab = null;
+    pool->slab_cursor  = 0;
+    pool->live_count   = 0;
+    pool->slab_count   = 0;
+}
+
+NB_INLINE u8 *nb_pool_get_first_slot(NB_Pool *pool, NB_Pool_Slab *slab) {
+    return nb_align_forward_pointer((u8 *)slab + size_of(NB_Pool_Slab), pool->alignment);
+}
+
+NB_EXTERN void *
+nb_pool_alloc(NB_Pool *pool) {
+    assert(pool->slot_size > 0);
+
+    void *result = pool->free_list;
+
+    if (result) {
+        pool->free_list = *(void **)result;
+    } else {
+        if (!pool->current_slab || (pool->slab_cursor == pool->slots_per_slab)) {
+            NB_Pool_Slab *slab = pool->current_slab ? pool->current_slab->next : pool->slabs;
+
+            if (!slab) {
+                // Slack for aligning the first slot past the header.
+                s64 slab_size = size_of(NB_Pool_Slab) + pool->alignment +
+                                pool->slot_size * pool->slots_per_slab;
+
+                slab = (NB_Pool_Slab *)pool->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_ALLOCATE, NB_ALLOCATOR_NO_ZERO),
+                                                            slab_size, 0,
+                                                            null,
+                                                            pool->allocator.data);
+                if (!slab) {
+                    pool->failed_count += 1;
+                    return null;
+                }
+
+                slab->next = null;
+                if (pool->current_slab) {
+                    pool->current_slab->next = slab;
+                } else {
+                    pool->slabs = slab;
+                }
+
+                pool->slab_count += 1;
+            }
+
+            pool->current_slab = slab;
+            pool->slab_cursor  = 0;
+        }
+
+        result = nb_pool_get_first_slot(pool, pool->current_slab) + pool->slab_cursor * pool->slot_size;
+        pool->slab_cursor += 1;
+    }
+
+    pool->live_count += 1;
+    if (pool->live_count > pool->peak_count) {
+        pool->peak_count = pool->live_count;
+    }
+
+    pool->allocation_count += 1;
+    return result;
+}
+
+NB_EXTERN void
+nb_pool_free(NB_Pool *pool, void *memory) {
+    if (!memory) return;
+
+    assert(pool->live_count > 0);
+    assert(((umm)memory & (pool->alignment-1)) == 0);
+
+    *(void **)memory = pool->free_list;
+    pool->free_list  = memory;
+    pool->live_count -= 1;
+}
+
+NB_EXTERN void
+nb_pool_reset(NB_Pool *pool) {
+    pool->free_list    = null;
+    pool->current_slab = pool->slabs;
+    pool->slab_cursor  = 0;
+    pool->live_count   = 0;
+}
+
+NB_EXTERN NB_ALLOCATOR_PROC(nb_pool_proc) {
+    NB_Pool *pool = (NB_Pool *)allocator_data;
+    assert(pool != null);
+
+    UNUSED(old_size);
+
+    // Slots are aligned once for the whole pool.
+    assert(nb_allocator_mode_alignment(mode) <= pool->alignment);
+
+    switch (nb_allocator_base_mode(mode)) {
+        case NB_ALLOCATOR_ALLOCATE: {
+            assert(size <= pool->slot_size);
+
+            void *result = nb_pool_alloc(pool);
+            if (result && (mode & NB_ALLOCATOR_ZERO)) {
+                memset(result, 0, (umm)size);
+            }
+
+            return result;
+        } break;
+
+        case NB_ALLOCATOR_RESIZE: {
+            // Every slot has the same size.
+            assert(size <= pool->slot_size);
+            if (old_memory) {
+                if ((mode & NB_ALLOCATOR_ZERO) && (size > old_size)) {
+                    memset((u8 *)old_memory + old_size, 0, (umm)(size - old_size));
+                }
+
+                return old_memory;
+            }
+
+            void *result = nb_pool_alloc(pool);
+            if (result && (mode & NB_ALLOCATOR_ZERO)) {
+                memset(result, 0, (umm)size);
+            }
+
+            return result;
+        } break;
+
+        case NB_ALLOCATOR_FREE:
+            nb_pool_free(pool, old_memory);
+            return null;
+
+        case NB_ALLOCATOR_FREE_ALL:
+            nb_pool_reset(pool);
+            return null;
+
+        case NB_ALLOCATOR_QUERY_STATS: {
+            // Every free slot fits any request, there is no fragmentation.
+            NB_Allocator_Stats *stats = (NB_Allocator_Stats *)old_memory;
+            stats->live_bytes       = pool->live_count * pool->slot_size;
+            stats->peak_bytes       = pool->peak_count * pool->slot_size;
+            stats->allocation_count = pool->allocation_count;
+            stats->failed_count     = pool->failed_count;
+            stats->reserved_bytes   = pool->slab_count * pool->slots_per_slab * pool->slot_size;
+            return stats;
+        } break;
+
+        default:
+            assert(false);
+            return null;
+    }
+}
+
+
+
+NB_INLINE u64 nb_tracking_hash_pointer(void *memory) {
+    u64 h = (u64)(umm)memory;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
+
+NB_INLINE u64 nb_tracking_hash_site(const char *file, s32 line) {
+    return nb_tracking_hash_pointer((void *)file) ^ ((u64)line * 0x9e3779b97f4a7c15ull);
+}
+
+static s64
+nb_tracking_find_allocation(NB_Tracking_Allocator *tracker, void *memory) {
+    s64 mask  = tracker->allocation_capacity - 1;
+    s64 index = (s64)(nb_tracking_hash_pointer(memory) & (u64)mask);
+
+    // Returns the slot holding memory or the empty slot it would go in.
+    while (tracker->allocations[index].memory &&
+           (tracker->allocations[index].memory != memory)) {
+        index = (index + 1) & mask;
+    }
+
+    return index;
+}
+
+static bool
+nb_tracking_grow_allocations(NB_Tracking_Allocator *tracker) {
+    NB_Tracked_Allocation *old_allocations = tracker->allocations;
+    s64 old_capacity = tracker->allocation_capacity;
+
+    s64 new_capacity = old_capacity ? (old_capacity * 2) : 1024;
+    NB_Tracked_Allocation *allocations = (NB_Tracked_Allocation *)nb_heap_alloc(new_capacity * size_of(NB_Tracked_Allocation));
+    if (!allocations) return false;
+
+    nb_memory_zero(allocations, new_capacity * size_of(NB_Tracked_Allocation));
+
+    tracker->allocations = allocations;
+    tracker->allocation_capacity = new_capacity;
+
+    for (s64 index = 0; index < old_capacity; ++index) {
+        if (old_allocations[index].memory) {
+            s64 slot = nb_tracking_find_allocation(tracker, old_allocations[index].memory);
+            tracker->allocations[slot] = old_allocations[index];
+        }
+    }
+
+    if (old_allocations) nb_heap_free(old_allocations);
+    return true;
+}
+
+static NB_Allocation_Site_Stats *
+nb_tracking_get_site(NB_Tracking_Allocator *tracker, const char *file, s32 line) {
+    if ((tracker->site_count + 1) * 10 > tracker->site_capacity * 7) {
+        NB_Allocation_Site_Stats *old_sites = tracker->sites;
+        s64 old_capacity = tracker->site_capacity;
+
+        s64 new_capacity = old_capacity ? (old_capacity * 2) : 256;
+        NB_Allocation_Site_Stats *sites = (NB_Allocation_Site_Stats *)nb_heap_alloc(new_capacity * size_of(NB_Allocation_Site_Stats));
+        if (!sites) return null;
+
+        nb_memory_zero(sites, new_capacity * size_of(NB_Allocation_Site_Stats));
+
+        for (s64 index = 0; index < old_capacity; ++index) {
+            NB_Allocation_Site_Stats *it = old_sites + index;
+            if (!it->file) continue;
+
+            s64 slot = (s64)(nb_tracking_hash_site(it->file, it->line) & (u64)(new_capacity - 1));
+            while (sites[slot].file) slot = (slot + 1) & (new_capacity - 1);
+            sites[slot] = *it;
+        }
+
+        if (old_sites) nb_heap_free(old_sites);
+
+        tracker->sites = sites;
+        tracker->site_capacity = new_capacity;
+    }
+
+    s64 mask = tracker->site_capacity - 1;
+    s64 slot = (s64)(nb_tracking_hash_site(file, line) & (u64)mask);
+
+    while (tracker->sites[slot].file) {
+        NB_Allocation_Site_Stats *it = tracker->sites + slot;
+        if ((it->file == file) && (it->line == line)) return it;
+
+        slot = (slot + 1) & mask;
+    }
+
+    NB_Allocation_Site_Stats *result = tracker->sites + slot;
+    result->file = file;
+    result->line = line;
+    tracker->site_count += 1;
+    return result;
+}
+
+static void
+nb_tracking_add(NB_Tracking_Allocator *tracker, void *memory, s64 size) {
+    if ((tracker->allocation_count + 1) * 10 > tracker->allocation_capacity * 7) {
+        if (!nb_tracking_grow_allocations(tracker)) return;
+    }
+
+    NB_Allocation_Site site = nb_allocation_site;
+    if (!site.file) {
+        site.file = "<unknown>";
+        site.line = 0;
+    }
+
+    s64 slot = nb_tracking_find_allocation(tracker, memory);
+    NB_Tracked_Allocation *it = tracker->allocations + slot;
+    assert(it->memory == null);
+
+    it->memory = memory;
+    it->size   = size;
+    it->file   = site.file;
+    it->line   = site.line;
+    it->stacktrace = null;
+
+#if NB_ENABLE_ASSERTS
+    if (tracker->capture_stacktraces) {
+        s64 mark = nb_get_temporary_storage_mark();
+
+        char *stacktrace = nb_get_stacktrace();
+        if (stacktrace) {
+            s64 length = nb_string_length(stacktrace);
+            it->stacktrace = (char *)nb_heap_alloc(length + 1);
+            if (it->stacktrace) memcpy(it->stacktrace, stacktrace, (umm)length + 1);
+        }
+
+        nb_set_temporary_storage_mark(mark);
+    }
+#endif
+
+    tracker->allocation_count += 1;
+    tracker->total_count += 1;
+    tracker->live_bytes  += size;
+    if (tracker->live_bytes > tracker->peak_bytes) {
+        tracker->peak_bytes = tracker->live_bytes;
+    }
+
+    NB_Allocation_Site_Stats *stats = nb_tracking_get_site(tracker, site.file, site.line);
+    if (stats) {
+        stats->live_bytes  += size;
+        stats->live_count  += 1;
+        stats->total_count += 1;
+        if (stats->live_bytes > stats->peak_bytes) {
+            stats->peak_bytes = stats->live_bytes;
+        }
+    }
+}
+
+static bool
+nb_tracking_remove(NB_Tracking_Allocator *tracker, void *memory) {
+    if (!tracker->allocation_capacity) return false;
+
+    s64 mask = tracker->allocation_capacity - 1;
+    s64 hole = nb_tracking_find_allocation(tracker, memory);
+
+    NB_Tracked_Allocation *it = tracker->allocations + hole;
+    if (!it->memory) return false;
+
+    NB_Allocation_Site_Stats *stats = nb_tracking_get_site(tracker, it->file, it->line);
+    if (stats) {
+        stats->live_bytes -= it->size;
+        stats->live_count -= 1;
+    }
+
+    tracker->live_bytes -= it->size;
+    tracker->allocation_count -= 1;
+
+    if (it->stacktrace) nb_heap_free(it->stacktrace);
+
+    // Backward shift deletion, keeps the probe chains intact without tombstones.
+    s64 index = (hole + 1) & mask;
+    while (tracker->allocations[index].memory) {
+        s64 home = (s64)(nb_tracking_hash_pointer(tracker->allocations[index].memory) & (u64)mask);
+
+        if (((index - home) & mask) >= ((index - hole) & mask)) {
+            tracker->allocations[hole] = tracker->allocations[index];
+            hole = index;
+        }
+
+        index = (index + 1) & mask;
+    }
+
+    nb_memory_zero_struct(tracker->allocations + hole);
+    return true;
+}
+
+NB_EXTERN void
+nb_tracking_allocator_init(NB_Tracking_Allocator *tracker,
+                           NB_Allocator parent,
+                           bool capture_stacktraces) {
+    nb_memory_zero_struct(tracker);
+
+    tracker->parent = parent;
+    tracker->capture_stacktraces = capture_stacktraces;
+
+    if (!tracker->parent.proc) {
+        tracker->parent.proc = nb_heap_allocator;
+        tracker->parent.data = null;
+    }
+}
+
+NB_EXTERN void
+nb_tracking_allocator_release(NB_Tracking_Allocator *tracker) {
+    for (s64 index = 0; index < tracker->allocation_capacity; ++index) {
+        if (tracker->allocations[index].stacktrace) {
+            nb_heap_free(tracker->allocations[index].stacktrace);
+        }
+    }
+
+    if (tracker->allocations) nb_heap_free(tracker->allocations);
+    if (tracker->sites) nb_heap_free(tracker->sites);
+
+    tracker->allocations = null;
+    tracker->allocation_count = 0;
+    tracker->allocation_capacity = 0;
+
+    tracker->sites = null;
+    tracker->site_count = 0;
+    tracker->site_capacity = 0;
+}
+
+NB_EXTERN NB_ALLOCATOR_PROC(nb_tracking_allocator_proc) {
+    NB_Tracking_Allocator *tracker = (NB_Tracking_Allocator *)allocator_data;
+    assert(tracker != null);
+
+    void *result = tracker->parent.proc(mode, size, old_size, old_memory, tracker->parent.data);
+
+    switch (nb_allocator_base_mode(mode)) {
+        case NB_ALLOCATOR_ALLOCATE:
+            if (result) nb_tracking_add(tracker, result, size);
+            else if (size > 0) tracker->failed_count += 1;
+            break;
+
+        case NB_ALLOCATOR_RESIZE:
+            if (result) {
+                if (old_memory) nb_tracking_remove(tracker, old_memory);
+                nb_tracking_add(tracker, result, size);
+            } else if (size > 0) {
+                tracker->failed_count += 1;
+            }
+            break;
+
+        case NB_ALLOCATOR_FREE:
+            if (old_memory && !nb_tracking_remove(tracker, old_memory)) {
+                nb_log_print(NB_LOG_WARNING, "Memory", 
+                             "Freeing an untracked pointer %p at %s:%d", 
+                             old_memory,
+                             nb_allocation_site.file ? nb_allocation_site.file : "<unknown>",
+                             nb_allocation_site.line);
+            }
+            break;
+
+        case NB_ALLOCATOR_FREE_ALL: {
+            for (s64 index = 0; index < tracker->allocation_capacity; ++index) {
+                NB_Tracked_Allocation *it = tracker->allocations + index;
+                if (it->stacktrace) nb_heap_free(it->stacktrace);
+                it->memory = null;
+                it->stacktrace = null;
+            }
+
+            for (s64 index = 0; index < tracker->site_capacity; ++index) {
+                tracker->sites[index].live_bytes = 0;
+                tracker->sites[index].live_count = 0;
+            }
+
+            tracker->allocation_count = 0;
+            tracker->live_bytes = 0;
+        } break;
+
+        case NB_ALLOCATOR_QUERY_STATS: {
+            // The parent knows the reserved memory and the fragmentation,
+            // the tracked allocations give the rest.
+            NB_Allocator_Stats *stats = (NB_Allocator_Stats *)old_memory;
+            stats->live_bytes       = tracker->live_bytes;
+            stats->peak_bytes       = tracker->peak_bytes;
+            stats->allocation_count = tracker->total_count;
+            stats->failed_count     = tracker->failed_count;
+            result = stats;
+        } break;
+
+        default: break;
+    }
+
+    // The site belongs to this allocation only, unless a caller pinned it.
+    if (nb_allocation_site_depth == 0) {
+        nb_allocation_site.file = null;
+        nb_allocation_site.line = 0;
+    }
+
+    return result;
+}
+
+NB_EXTERN void
+nb_tracking_allocator_report(NB_Tracking_Allocator *tracker) {
+    nb_log_print(NB_LOG_NONE, "Memory", 
+                 "Live: %" NB_FMT_S64 " bytes in %" NB_FMT_S64 " allocations, peak: %" NB_FMT_S64 " bytes, total allocations: %" NB_FMT_S64,
+                 tracker->live_bytes,
+                 tracker->allocation_count,
+                 tracker->peak_bytes,
+                 tracker->total_count);
+
+    for (s64 index = 0; index < tracker->site_capacity; ++index) {
+        NB_Allocation_Site_Stats *it = tracker->sites + index;
+        if (!it->file) continue;
+
+        nb_log_print(NB_LOG_NONE, "Memory", 
+                     "    %s:%d live: %" NB_FMT_S64 " bytes in %" NB_FMT_S64 " allocations, peak: %" NB_FMT_S64 " bytes, total allocations: %" NB_FMT_S64,
+                     it->file, it->line,
+                     it->live_bytes,
+                     it->live_count,
+                     it->peak_bytes,
+                     it->total_count);
+    }
+}
+
+NB_EXTERN s64
+nb_tracking_allocator_report_leaks(NB_Tracking_Allocator *tracker) {
+    s64 result = 0;
+
+    for (s64 index = 0; index < tracker->allocation_capacity; ++index) {
+        NB_Tracked_Allocation *it = tracker->allocations + index;
+        if (!it->memory) continue;
+
+        nb_log_print(NB_LOG_WARNING, "Memory", 
+                     "Leaked %" NB_FMT_S64 " bytes at %s:%d",
+                     it->size, it->file, it->line);
+
+        if (it->stacktrace) {
+            nb_write_string(it->stacktrace, true);
+        }
+
+        result += 1;
+    }
+
+    if (result) {
+        nb_log_print(NB_LOG_WARNING, "Memory", 
+                     "%" NB_FMT_S64 " leaks, %" NB_FMT_S64 " bytes.",
+                     result, tracker->live_bytes);
+    }
+
+    return result;
+}
+
+
+
+#define NB_TLSF_BLOCK_FREE_BIT      ((umm)1)
+#define NB_TLSF_BLOCK_PREV_FREE_BIT ((umm)2)
+
+// Only the size field is overhead on used blocks, prev_physical
+// belongs to the previous block.
+#define NB_TLSF_BLOCK_OVERHEAD     ((umm)size_of(umm))
+#define NB_TLSF_BLOCK_START_OFFSET ((umm)(size_of(NB_TLSF_Block *) + size_of(umm)))
+
+#define NB_TLSF_BLOCK_SIZE_MIN ((umm)(size_of(NB_TLSF_Block) - size_of(NB_TLSF_Block *)))
+#define NB_TLSF_BLOCK_SIZE_MAX ((umm)1 << NB_TLSF_FL_INDEX_MAX)
+
+NB_INLINE umm nb_tlsf_block_size(NB_TLSF_Block *block) {
+    return block->size & ~(NB_TLSF_BLOCK_FREE_BIT | NB_TLSF_BLOCK_PREV_FREE_BIT);
+}
+
+NB_INLINE void nb_tlsf_block_set_size(NB_TLSF_Block *block, umm size) {
+    block->size = size | (block->size & (NB_TLSF_BLOCK_FREE_BIT | NB_TLSF_BLOCK_PREV_FREE_BIT));
+}
+
+NB_INLINE bool nb_tlsf_block_is_free(NB_TLSF_Block *block) {
+    return (block->size & NB_TLSF_BLOCK_FREE_BIT) != 0;
+}
+
+NB_INLINE bool nb_tlsf_block_is_prev_free(NB_TLSF_Block *block) {
+    return (block->size & NB_TLSF_BLOCK_PREV_FREE_BIT) != 0;
+}
+
+NB_INLINE void nb_tlsf_block_set_free(NB_TLSF_Block *block, bool free) {
+    if (free) block->size |=  NB_TLSF_BLOCK_FREE_BIT;
+    else      block->size &= ~NB_TLSF_BLOCK_FREE_BIT;
+}
+
+NB_INLINE void nb_tlsf_block_set_prev_free(NB_TLSF_Block *block, bool free) {
+    if (free) block->size |=  NB_TLSF_BLOCK_PREV_FREE_BIT;
+    else      block->size &= ~NB_TLSF_BLOCK_PREV_FREE_BIT;
+}
+
+NB_INLINE NB_TLSF_Block *nb_tlsf_block_from_pointer(void *memory) {
+    return (NB_TLSF_Block *)((u8 *)memory - NB_TLSF_BLOCK_START_OFFSET);
+}
+
+NB_INLINE u8 *nb_tlsf_block_to_pointer(NB_TLSF_Block *block) {
+    return (u8 *)block + NB_TLSF_BLOCK_START_OFFSET;
+}
+
+NB_INLINE NB_TLSF_Block *nb_tlsf_block_next(NB_TLSF_Block *block) {
+    return (NB_TLSF_Block *)(nb_tlsf_block_to_pointer(block) + nb_tlsf_block_size(block) - NB_TLSF_BLOCK_OVERHEAD);
+}
+
+NB_INLINE NB_TLSF_Block *nb_tlsf_block_link_next(NB_TLSF_Block *block) {
+    NB_TLSF_Block *next = nb_tlsf_block_next(block);
+    next->prev_physical = block;
+    return next;
+}
+
+NB_INLINE void nb_tlsf_block_mark_as_free(NB_TLSF_Block *block) {
+    NB_TLSF_Block *next = nb_tlsf_block_link_next(block);
+    nb_tlsf_block_set_prev_free(next, true);
+    nb_tlsf_block_set_free(block, true);
+}
+
+NB_INLINE void nb_tlsf_block_mark_as_used(NB_TLSF_Block *block) {
+    NB_TLSF_Block *next = nb_tlsf_block_next(block);
+    nb_tlsf_block_set_prev_free(next, false);
+    nb_tlsf_block_set_free(block, false);
+}
+
+// First level is the power of 2 range, second level splits it linearly.
+static void
+nb_tlsf_mapping_insert(umm size, s32 *fl_index, s32 *sl_index) {
+    s32 fl, sl;
+
+    if (size < NB_TLSF_SMALL_BLOCK_SIZE) {
+        fl = 0;
+        sl = (s32)(size / (NB_TLSF_SMALL_BLOCK_SIZE / NB_TLSF_SL_INDEX_COUNT));
+    } else {
+        fl = (s32)nb_find_most_significant_set_bit64(size);
+        sl = (s32)(size >> (fl - NB_TLSF_SL_INDEX_COUNT_LOG2)) ^ (1 << NB_TLSF_SL_INDEX_COUNT_LOG2);
+        fl -= (NB_TLSF_FL_INDEX_SHIFT - 1);
+    }
+
+    *fl_index = fl;
+    *sl_index = sl;
+}
+
+// Rounds up to the next list, so any block found there fits.
+static void
+nb_tlsf_mapping_search(umm size, s32 *fl_index, s32 *sl_index) {
+    if (size >= NB_TLSF_SMALL_BLOCK_SIZE) {
+        umm round = ((umm)1 << (nb_find_most_significant_set_bit64(size) - NB_TLSF_SL_INDEX_COUNT_LOG2)) - 1;
+        size += round;
+    }
+
+    nb_tlsf_mapping_insert(size, fl_index, sl_index);
+}
+
+static NB_TLSF_Block *
+nb_tlsf_search_suitable_block(NB_TLSF *tlsf, s32 *fl_index, s32 *sl_index) {
+    s32 fl = *fl_index;
+    s32 sl = *sl_index;
+
+    u32 sl_map = tlsf->sl_bitmap[fl] & (~0u << sl);
+    if (!sl_map) {
+        u32 fl_map = tlsf->fl_bitmap & (~0u << (fl + 1));
+        if (!fl_map) return null;
+
+        fl = (s32)nb_find_least_significant_set_bit(fl_map);
+        sl_map = tlsf->sl_bitmap[fl];
+    }
+
+    sl = (s32)nb_find_least_significant_set_bit(sl_map);
+
+    *fl_index = fl;
+    *sl_index = sl;
+    return tlsf->blocks[fl][sl];
+}
+
+static void
+nb_tlsf_remove_free_block(NB_TLSF *tlsf, NB_TLSF_Block *block, s32 fl, s32 sl) {
+    NB_TLSF_Block *prev = block->prev_free;
+    NB_TLSF_Block *next = block->next_free;
+
+    if (next) next->prev_free = prev;
+
+    if (prev) {
+        prev->next_free = next;
+    } else {
+        tlsf->blocks[fl][sl] = next;
+
+        if (!next) {
+            tlsf->sl_bitmap[fl] &= ~(1u << sl);
+            if (!tlsf->sl_bitmap[fl]) {
+                tlsf->fl_bitmap &= ~(1u << fl);
+            }
+        }
+    }
+}
+
+static void
+nb_tlsf_insert_free_block(NB_TLSF *tlsf, NB_TLSF_Block *block, s32 fl, s32 sl) {
+    NB_TLSF_Block *head = tlsf->blocks[fl][sl];
+
+    block->next_free = head;
+    block->prev_free = null;
+    if (head) head->prev_free = block;
+
+    tlsf->blocks[fl][sl] = block;
+    tlsf->fl_bitmap     |= (1u << fl);
+    tlsf->sl_bitmap[fl] |= (1u << sl);
+}
+
+static void
+nb_tlsf_block_remove(NB_TLSF *tlsf, NB_TLSF_Block *block) {
+    s32 fl, sl;
+    nb_tlsf_mapping_insert(nb_tlsf_block_size(block), &fl, &sl);
+    nb_tlsf_remove_free_block(tlsf, block, fl, sl);
+}
+
+static void
+nb_tlsf_block_insert(NB_TLSF *tlsf, NB_TLSF_Block *block) {
+    s32 fl, sl;
+    nb_tlsf_mapping_insert(nb_tlsf_block_size(block), &fl, &sl);
+    nb_tlsf_insert_free_block(tlsf, block, fl, sl);
+}
+
+NB_INLINE bool nb_tlsf_block_can_split(NB_TLSF_Block *block, umm size) {
+    return nb_tlsf_block_size(block) >= size_of(NB_TLSF_Block) + size;
+}
+
+// Splits the tail past 'size' off the block, returns the tail.
+static NB_TLSF_Block *
+nb_tlsf_block_split(NB_TLSF_Block *block, umm size) {
+    NB_TLSF_Block *remaining = (NB_TLSF_Block *)(nb_tlsf_block_to_pointer(block) + size - NB_TLSF_BLOCK_OVERHEAD);
+    umm remaining_size = nb_tlsf_block_size(block) - (size + NB_TLSF_BLOCK_OVERHEAD);
+
+    remaining->size = remaining_size;
+    nb_tlsf_block_set_size(block, size);
+    nb_tlsf_block_mark_as_free(remaining);
+
+    return remaining;
+}
+
+static NB_TLSF_Block *
+nb_tlsf_block_absorb(NB_TLSF_Block *prev, NB_TLSF_Block *block) {
+    prev->size += nb_tlsf_block_size(block) + NB_TLSF_BLOCK_OVERHEAD;
+    nb_tlsf_block_link_next(prev);
+    return prev;
+}
+
+static NB_TLSF_Block *
+nb_tlsf_block_merge_prev(NB_TLSF *tlsf, NB_TLSF_Block *block) {
+    if (nb_tlsf_block_is_prev_free(block)) {
+        NB_TLSF_Block *prev = block->prev_physical;
+        nb_tlsf_block_remove(tlsf, prev);
+        block = nb_tlsf_block_absorb(prev, block);
+    }
+
+    return block;
+}
+
+static NB_TLSF_Block *
+nb_tlsf_block_merge_next(NB_TLSF *tlsf, NB_TLSF_Block *block) {
+    NB_TLSF_Block *next = nb_tlsf_block_next(block);
+
+    if (nb_tlsf_block_is_free(next)) {
+        nb_tlsf_block_remove(tlsf, next);
+        block = nb_tlsf_block_absorb(block, next);
+    }
+
+    return block;
+}
+
+static void
+nb_tlsf_block_trim_free(NB_TLSF *tlsf, NB_TLSF_Block *block, umm size) {
+    if (nb_tlsf_block_can_split(block, size)) {
+        NB_TLSF_Block *remaining = nb_tlsf_block_split(block, size);
+        nb_tlsf_block_link_next(block);
+        nb_tlsf_block_set_prev_free(remaining, true);
+        nb_tlsf_block_insert(tlsf, remaining);
+    }
+}
+
+static void
+nb_tlsf_block_trim_used(NB_TLSF *tlsf, NB_TLSF_Block *block, umm size) {
+    if (nb_tlsf_block_can_split(block, size)) {
+        NB_TLSF_Block *remaining = nb_tlsf_block_split(block, size);
+        nb_tlsf_block_set_prev_free(remaining, false);
+
+        remaining = nb_tlsf_block_merge_next(tlsf, remaining);
+        nb_tlsf_block_insert(tlsf, remaining);
+    }
+}
+
+// Gives the leading 'size' bytes back to the free lists, returns the rest.
+static NB_TLSF_Block *
+nb_tlsf_block_trim_free_leading(NB_TLSF *tlsf, NB_TLSF_Block *block, umm size) {
+    NB_TLSF_Block *remaining = block;
+
+    if (nb_tlsf_block_can_split(block, size)) {
+        remaining = nb_tlsf_block_split(block, size - NB_TLSF_BLOCK_OVERHEAD);
+        nb_tlsf_block_set_prev_free(remaining, true);
+
+        nb_tlsf_block_link_next(block);
+        nb_tlsf_block_insert(tlsf, block);
+    }
+
+    return remaining;
+}
+
+static NB_TLSF_Block *
+nb_tlsf_block_locate_free(NB_TLSF *tlsf, umm size) {
+    if (!size) return null;
+
+    s32 fl, sl;
+    nb_tlsf_mapping_search(size, &fl, &sl);
+
+    // Requests past the last list round up out of range.
+    if (fl >= NB_TLSF_FL_INDEX_COUNT) return null;
+
+    NB_TLSF_Block *block = nb_tlsf_search_suitable_block(tlsf, &fl, &sl);
+    if (block) {
+        assert(nb_tlsf_block_size(block) >= size);
+        nb_tlsf_remove_free_block(tlsf, block, fl, sl);
+    }
+
+    return block;
+}
+
+static void *
+nb_tlsf_block_prepare_used(NB_TLSF *tlsf, NB_TLSF_Block *block, umm size) {
+    if (!block) {
+        tlsf->failed_count += 1;
+        return null;
+    }
+
+    nb_tlsf_block_trim_free(tlsf, block, size);
+    nb_tlsf_block_mark_as_used(block);
+
+    tlsf->used_bytes += (s64)nb_tlsf_block_size(block);
+    if (tlsf->used_bytes > tlsf->peak_bytes) {
+        tlsf->peak_bytes = tlsf->used_bytes;
+    }
+
+    tlsf->allocation_count += 1;
+
+    return nb_tlsf_block_to_pointer(block);
+}
+
+// 0 for the requests that cannot be satisfied.
+static umm
+nb_tlsf_adjust_request_size(s64 size, umm alignment) {
+    if (size <= 0) return 0;
+
+    umm aligned = nb_align_forward((umm)size, alignment);
+    if (aligned >= NB_TLSF_BLOCK_SIZE_MAX) return 0;
+
+    return nb_max(aligned, NB_TLSF_BLOCK_SIZE_MIN);
+}
+
+static bool
+nb_tlsf_add_pool(NB_TLSF *tlsf, u8 *memory, s64 size) {
+    // The free block and the zero sized sentinel at the end.
+    s64 pool_overhead = 2 * (s64)NB_TLSF_BLOCK_OVERHEAD;
+    if (size <= pool_overhead) return false;
+
+    umm pool_bytes = (umm)(size - pool_overhead) & ~(umm)(NB_TLSF_ALIGN_SIZE - 1);
+
+    if ((pool_bytes < NB_TLSF_BLOCK_SIZE_MIN) || (pool_bytes >= NB_TLSF_BLOCK_SIZE_MAX)) {
+        return false;
+    }
+
+    // The prev_physical field falls before the pool, it is never read
+    // since the first block has no previous block.
+    NB_TLSF_Block *block = (NB_TLSF_Block *)(memory - NB_TLSF_BLOCK_OVERHEAD);
+    block->size = pool_bytes;
+    nb_tlsf_block_set_free(block, true);
+    nb_tlsf_block_set_prev_free(block, false);
+    nb_tlsf_block_insert(tlsf, block);
+
+    NB_TLSF_Block *sentinel = nb_tlsf_block_link_next(block);
+    sentinel->size = 0;
+    nb_tlsf_block_set_free(sentinel, false);
+    nb_tlsf_block_set_prev_free(sentinel, true);
+
+    return true;
+}
+
+NB_EXTERN bool
+nb_tlsf_init(NB_TLSF *tlsf, void *memory, s64 size) {
+    nb_memory_zero_struct(tlsf);
+    return nb_tlsf_add_region(tlsf, memory, size);
+}
+
+NB_EXTERN bool
+nb_tlsf_init_reserve(NB_TLSF *tlsf, s64 size) {
+    nb_memory_zero_struct(tlsf);
+
+    size = nb_align_forward(size, nb_os_get_page_size());
+
+    u8 *base = (u8 *)nb_os_reserve(size);
+    if (!base) return false;
+
+    // Committing everything up front keeps the allocations O(1),
+    // the pages are still only backed on first touch.
+    if (!nb_os_commit(base, size) || !nb_tlsf_add_region(tlsf, base, size)) {
+        nb_os_release(base, size);
+        return false;
+    }
+
+    tlsf->reserved_base = base;
+    tlsf->reserved_size = size;
+    return true;
+}
+
+NB_EXTERN bool
+nb_tlsf_add_region(NB_TLSF *tlsf, void *memory, s64 size) {
+    assert(memory != null);
+
+    u8 *start = nb_align_forward_pointer(memory, NB_TLSF_ALIGN_SIZE);
+    size -= start - (u8 *)memory;
+
+    s64 header_size = nb_align_forward(size_of(NB_TLSF_Region), NB_TLSF_ALIGN_SIZE);
+    if (size <= header_size) return false;
+
+    if (!nb_tlsf_add_pool(tlsf, start + header_size, size - header_size)) {
+#if NB_DEBUG
+        nb_log_print(NB_LOG_WARNING, "TLSF", "Region size out of range.");
+#endif
+        return false;
+    }
+
+    NB_TLSF_Region *region = (NB_TLSF_Region *)start;
+    region->next = tlsf->regions;
+    region->size = size;
+    tlsf->regions = region;
+    return true;
+}
+
+NB_EXTERN void
+nb_tlsf_release(NB_TLSF *tlsf) {
+    if (tlsf->reserved_base) {
+        nb_os_release(tlsf->reserved_base, tlsf->reserved_size);
+    }
+
+    nb_memory_zero_struct(tlsf);
+}
+
+NB_EXTERN void
+nb_tlsf_reset(NB_TLSF *tlsf) {
+    tlsf->fl_bitmap = 0;
+    nb_memory_zero_array(tlsf->sl_bitmap);
+    nb_memory_zero_array(tlsf->blocks);
+
+    s64 header_size = nb_align_forward(size_of(NB_TLSF_Region), NB_TLSF_ALIGN_SIZE);
+
+    for (NB_TLSF_Region *region = tlsf->regions; region; region = region->next) {
+        nb_tlsf_add_pool(tlsf, (u8 *)region + header_size, region->size - header_size);
+    }
+
+    tlsf->used_bytes = 0;
+}
+
+NB_EXTERN void *
+nb_tlsf_alloc(NB_TLSF *tlsf, s64 size) {
+    umm adjusted = nb_tlsf_adjust_request_size(size, NB_TLSF_ALIGN_SIZE);
+    NB_TLSF_Block *block = nb_tlsf_block_locate_free(tlsf, adjusted);
+    return nb_tlsf_block_prepare_used(tlsf, block, adjusted);
+}
+
+NB_EXTERN void *
+nb_tlsf_alloc_align(NB_TLSF *tlsf, s64 size, s64 alignment) {
+    assert(nb_is_power_of_2(alignment));
+
+    if (alignment <= NB_TLSF_ALIGN_SIZE) return nb_tlsf_alloc(tlsf, size);
+
+    umm adjusted = nb_tlsf_adjust_request_size(size, NB_TLSF_ALIGN_SIZE);
+    if (!adjusted) {
+        tlsf->failed_count += 1;
+        return null;
+    }
+
+    // Room to move the start forward, the leading gap must be big
+    // enough to become a free block of its own.
+    umm gap_minimum = size_of(NB_TLSF_Block);
+    umm size_with_gap = nb_tlsf_adjust_request_size((s64)(adjusted + (umm)alignment + gap_minimum), (umm)alignment);
+
+    NB_TLSF_Block *block = nb_tlsf_block_locate_free(tlsf, size_with_gap);
+    if (block) {
+        u8 *pointer = nb_tlsf_block_to_pointer(block);
+        u8 *aligned = nb_align_forward_pointer(pointer, alignment);
+        umm gap = (umm)(aligned - pointer);
+
+        if (gap && (gap < gap_minimum)) {
+            umm offset = nb_max(gap_minimum - gap, (umm)alignment);
+            aligned = nb_align_forward_pointer(aligned + offset, alignment);
+            gap = (umm)(aligned - pointer);
+        }
+
+        if (gap) {
+            block = nb_tlsf_block_trim_free_leading(tlsf, block, gap);
+        }
+    }
+
+    return nb_tlsf_block_prepare_used(tlsf, block, adjusted);
+}
+
+NB_EXTERN void
+nb_tlsf_free(NB_TLSF *tlsf, void *memory) {
+    if (!memory) return;
+
+    NB_TLSF_Block *block = nb_tlsf_block_from_pointer(memory);
+    assert(!nb_tlsf_block_is_free(block));
+
+    tlsf->used_bytes -= (s64)nb_tlsf_block_size(block);
+
+    nb_tlsf_block_mark_as_free(block);
+    block = nb_tlsf_block_merge_prev(tlsf, block);
+    block = nb_tlsf_block_merge_next(tlsf, block);
+    nb_tlsf_block_insert(tlsf, block);
+}
+
+// Grows into the next block when it is free, or shrinks the block.
+static bool
+nb_tlsf_resize_in_place(NB_TLSF *tlsf, void *memory, s64 size) {
+    NB_TLSF_Block *block = nb_tlsf_block_from_pointer(memory);
+    NB_TLSF_Block *next  = nb_tlsf_block_next(block);
+
+    umm current_size  = nb_tlsf_block_size(block);
+    umm combined_size = current_size + nb_tlsf_block_size(next) + NB_TLSF_BLOCK_OVERHEAD;
+    umm adjusted      = nb_tlsf_adjust_request_size(size, NB_TLSF_ALIGN_SIZE);
+
+    if (!adjusted) return false;
+
+    if (adjusted > current_size) {
+        if (!nb_tlsf_block_is_free(next) || (adjusted > combined_size)) return false;
+
+        nb_tlsf_block_merge_next(tlsf, block);
+        nb_tlsf_block_mark_as_used(block);
+    }
+
+    nb_tlsf_block_trim_used(tlsf, block, adjusted);
+
+    tlsf->used_bytes += (s64)nb_tlsf_block_size(block) - (s64)current_size;
+    if (tlsf->used_bytes > tlsf->peak_bytes) {
+        tlsf->peak_bytes = tlsf->used_bytes;
+    }
+
+    return true;
+}
+
+NB_EXTERN void *
+nb_tlsf_realloc(NB_TLSF *tlsf, void *memory, s64 size) {
+    if (!memory) return nb_tlsf_alloc(tlsf, size);
+
+    if (size <= 0) {
+        nb_tlsf_free(tlsf, memory);
+        return null;
+    }
+
+    if (nb_tlsf_resize_in_place(tlsf, memory, size)) return memory;
+
+    void *result = nb_tlsf_alloc(tlsf, size);
+    if (result) {
+        umm current_size = nb_tlsf_block_size(nb_tlsf_block_from_pointer(memory));
+        memcpy(result, memory, nb_min(current_size, (umm)size));
+        nb_tlsf_free(tlsf, memory);
+    }
+
+    return result;
+}
+
+NB_EXTERN bool
+nb_tlsf_check(NB_TLSF *tlsf) {
+    for (s32 fl = 0; fl < NB_TLSF_FL_INDEX_COUNT; ++fl) {
+        bool fl_bit = (tlsf->fl_bitmap & (1u << fl)) != 0;
+        if (fl_bit != (tlsf->sl_bitmap[fl] != 0)) return false;
+
+        for (s32 sl = 0; sl < NB_TLSF_SL_INDEX_COUNT; ++sl) {
+            bool sl_bit = (tlsf->sl_bitmap[fl] & (1u << sl)) != 0;
+            NB_TLSF_Block *block = tlsf->blocks[fl][sl];
+
+            if (sl_bit != (block != null)) return false;
+
+            for (; block; block = block->next_free) {
+                if (!nb_tlsf_block_is_free(block)) return false;
+
+                // Free neighbours are always merged.
+                if (nb_tlsf_block_is_prev_free(block)) return false;
+
+                NB_TLSF_Block *next = nb_tlsf_block_next(block);
+                if (nb_tlsf_block_is_free(next)) return false;
+                if (!nb_tlsf_block_is_prev_free(next)) return false;
+                if (nb_tlsf_block_size(block) < NB_TLSF_BLOCK_SIZE_MIN) return false;
+
+                s32 block_fl, block_sl;
+                nb_tlsf_mapping_insert(nb_tlsf_block_size(block), &block_fl, &block_sl);
+                if ((block_fl != fl) || (block_sl != sl)) return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static NB_Allocator_Stats *
+nb_tlsf_query_stats(NB_TLSF *tlsf, NB_Allocator_Stats *stats) {
+    stats->live_bytes       = tlsf->used_bytes;
+    stats->peak_bytes       = tlsf->peak_bytes;
+    stats->allocation_count = tlsf->allocation_count;
+    stats->failed_count     = tlsf->failed_count;
+
+    for (NB_TLSF_Region *region = tlsf->regions; region; region = region->next) {
+        stats->reserved_bytes += region->size;
+    }
+
+    // Walks the free lists, this is not O(1).
+    s64 free_bytes   = 0;
+    s64 largest_free = 0;
+
+    for (s32 fl = 0; fl < NB_TLSF_FL_INDEX_COUNT; ++fl) {
+        if (!(tlsf->fl_bitmap & (1u << fl))) continue;
+
+        for (s32 sl = 0; sl < NB_TLSF_SL_INDEX_COUNT; ++sl) {
+            for (NB_TLSF_Block *block = tlsf->blocks[fl][sl]; block; block = block->next_free) {
+                s64 block_size = (s64)nb_tlsf_block_size(block);
+                free_bytes  += block_size;
+                largest_free = nb_max(largest_free, block_size);
+            }
+        }
+    }
+
+    stats->fragmentation = nb_allocator_fragmentation(free_bytes, largest_free);
+    return stats;
+}
+
+NB_EXTERN NB_ALLOCATOR_PROC(nb_tlsf_proc) {
+    NB_TLSF *tlsf = (NB_TLSF *)allocator_data;
+    assert(tlsf != null);
+
+    s64 alignment = nb_allocator_mode_alignment(mode);
+    bool zero     = (mode & NB_ALLOCATOR_ZERO) != 0;
+
+    switch (nb_allocator_base_mode(mode)) {
+        case NB_ALLOCATOR_ALLOCATE: {
+            void *result = nb_tlsf_alloc_align(tlsf, size, nb_max(alignment, NB_TLSF_ALIGN_SIZE));
+            if (result && zero) memset(result, 0, (umm)size);
+            return result;
+        } break;
+
+        case NB_ALLOCATOR_RESIZE: {
+            if (!old_memory) old_size = 0;
+
+            void *result;
+            if (alignment <= NB_TLSF_ALIGN_SIZE) {
+                result = nb_tlsf_realloc(tlsf, old_memory, size);
+            } else if (old_memory && nb_tlsf_resize_in_place(tlsf, old_memory, size)) {
+                // The block does not move, it stays aligned.
+                result = old_memory;
+            } else {
+                result = nb_tlsf_alloc_align(tlsf, size, alignment);
+                if (result && old_memory) {
+                    memcpy(result, old_memory, (umm)nb_min(old_size, size));
+                    nb_tlsf_free(tlsf, old_memory);
+                }
+            }
+
+            if (result && zero && (size > old_size)) {
+                memset((u8 *)result + old_size, 0, (umm)(size - old_size));
+            }
+
+            return result;
+        } break;
+
+        case NB_ALLOCATOR_FREE:
+            nb_tlsf_free(tlsf, old_memory);
+            return null;
+
+        case NB_ALLOCATOR_FREE_ALL:
+            nb_tlsf_reset(tlsf);
+            return null;
+
+        case NB_ALLOCATOR_QUERY_STATS:
+            return nb_tlsf_query_stats(tlsf, (NB_Allocator_Stats *)old_memory);
+
+        default:
+            assert(false);
+            return null;
+    }
+}
+
+
+
+#define NB_ARRAY_ALLOCATOR_FLAGS (NB_ALLOCATOR_NO_ZERO | nb_allocator_align_flag(NB_ARRAY_ALIGNMENT))
+
+NB_EXTERN void *
+nb_array_grow(void *array, s64 element_size, s64 capacity, NB_Allocator allocator) {
+    assert(element_size > 0);
+
+    NB_Array_Header *header = null;
+    s64 old_capacity = 0;
+    float growth_factor = NB_ARRAY_GROWTH_FACTOR;
+
+    if (array) {
+        header = nb_array_header(array);
+        if (header->capacity >= capacity) return array;
+
+        // The array keeps the allocator it was created with.
+        allocator     = header->allocator;
+        old_capacity  = header->capacity;
+        growth_factor = header->growth_factor;
+    } else if (!allocator.proc) {
+        allocator = nb_current_allocator;
+    }
+
+    assert(growth_factor > 1.0f);
+
+    s64 new_capacity = (s64)((float)old_capacity * growth_factor);
+    if (new_capacity <= old_capacity) new_capacity = old_capacity + 1;
+    if (new_capacity < capacity) new_capacity = capacity;
+    if (new_capacity < NB_ARRAY_CAPACITY_MIN) new_capacity = NB_ARRAY_CAPACITY_MIN;
+
+    s64 old_size = header ? (NB_ARRAY_HEADER_SIZE + old_capacity * element_size) : 0;
+    s64 new_size = NB_ARRAY_HEADER_SIZE + new_capacity * element_size;
+
+    NB_Array_Header *new_header = (NB_Array_Header *)allocator.proc(nb_allocator_mode(NB_ALLOCATOR_RESIZE, NB_ARRAY_ALLOCATOR_FLAGS),
+                                                                      new_size, old_size,
+                                                                      header,
+                                                                      allocator.data);
+    if (!new_header) return array;
+
+    if (!header) {
+        new_header->count         = 0;
+        new_header->growth_factor = growth_factor;
+        new_header->allocator     = allocator;
+    }
+
+    new_header->capacity = new_capacity;
+    return (u8 *)new_header + NB_ARRAY_HEADER_SIZE;
+}
+
+NB_EXTERN void
+nb_array_free_memory(void *array) {
+    if (!array) return;
+
+    NB_Array_Header *header = nb_array_header(array);
+    NB_Allocator allocator  = header->allocator;
+
+    allocator.proc(nb_allocator_mode(NB_ALLOCATOR_FREE, NB_ARRAY_ALLOCATOR_FLAGS), 0, 0, header, allocator.data);
+}
+
+NB_EXTERN void
+nb_array_remove_ordered_at(void *array, s64 element_size, s64 index) {
+    NB_Array_Header *header = nb_array_header(array);
+    assert((index >= 0) && (index < header->count));
+
+    u8 *at = (u8 *)array + index * element_size;
+    memmove(at, at + element_size, (umm)((header->count - index - 1) * element_size));
+    header->count -= 1;
+}
+
+
+#if NB_HASH_MAP_SSE2
+#include <emmintrin.h>
+#endif
+
+NB_EXTERN u64
+nb_hash_u64(u64 value) {
+    // MurmurHash3 finalizer, every input bit reaches every output bit.
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+#define nb_hash_rotate_left(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+NB_EXTERN u64
+nb_hash_bytes(void *data, s64 count, u64 seed) {
+    assert(count >= 0);
+
+    u8 *at = (u8 *)data;
+    u64 h  = seed ^ ((u64)count * 0x9e3779b97f4a7c15ull);
+
+    // Eight bytes per step, then the tail zero padded.
+    while (count >= 8) {
+        u64 v;
+        memcpy(&v, at, 8);
+
+        v *= 0x87c37b91114253d5ull;
+        v  = nb_hash_rotate_left(v, 31);
+        v *= 0x4cf5ad432745937full;
+
+        h ^= v;
+        h  = nb_hash_rotate_left(h, 27) * 5 + 0x52dce729;
+
+        at    += 8;
+        count -= 8;
+    }
+
+    if (count > 0) {
+        u64 v = 0;
+        memcpy(&v, at, (umm)count);
+
+        v *= 0x87c37b91114253d5ull;
+        v  = nb_hash_rotate_left(v, 31);
+        v *= 0x4cf5ad432745937full;
+        h ^= v;
+    }
+
+    return nb_hash_u64(h);
+}
+
+#define NB_HASH_MAP_ALLOCATOR_FLAGS (NB_ALLOCATOR_NO_ZERO | nb_allocator_align_flag(16))
+
+// The high 57 bits pick the home slot, the low 7 bits go in the control byte.
+#define nb_hash_map_h1(hash) ((hash) >> 7)
+#define nb_hash_map_h2(hash) ((u8)((hash) & 0x7F))
+
+typedef struct NB_Hash_Map_String_Slot {
+    NB_String key;
+    u64 hash;
+} NB_Hash_Map_String_Slot;
+
+// A bit mask of the group bytes that passed a test.
+#if NB_HASH_MAP_SSE2
+NB_INLINE u64 nb_hash_map_group_match(u8 *control, u8 h2) {
+    __m128i group = _mm_loadu_si128((__m128i *)control);
+    return (u64)(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2)));
+}
+
+NB_INLINE u64 nb_hash_map_group_empty(u8 *control) {
+    // Only the empty byte has its high bit set.
+    return (u64)(u32)_mm_movemask_epi8(_mm_loadu_si128((__m128i *)control));
+}
+
+NB_INLINE s64 nb_hash_map_mask_index(u64 mask) {
+    return (s64)nb_find_least_significant_set_bit64(mask);
+}
+#else
+#define NB_HASH_MAP_LSBS 0x0101010101010101ull
+#define NB_HASH_MAP_MSBS 0x8080808080808080ull
+
+NB_INLINE u64 nb_hash_map_group_match(u8 *control, u8 h2) {
+    u64 group;
+    memcpy(&group, control, 8);
+
+    // Sets the high bit of the zero bytes of x, a byte above a match can
+    // be a false positive, the caller checks the control byte anyway.
+    u64 x = group ^ (NB_HASH_MAP_LSBS * h2);
+    return (x - NB_HASH_MAP_LSBS) & ~x & NB_HASH_MAP_MSBS;
+}
+
+NB_INLINE u64 nb_hash_map_group_empty(u8 *control) {
+    u64 group;
+    memcpy(&group, control, 8);
+    return group & NB_HASH_MAP_MSBS;
+}
+
+NB_INLINE s64 nb_hash_map_mask_index(u64 mask) {
+    return (s64)(nb_find_least_significant_set_bit64(mask) >> 3);
+}
+#endif
+
+NB_INLINE void
+nb_hash_map_set_control(NB_Hash_Map *map, s64 index, u8 value) {
+    s64 mask = map->capacity - 1;
+    map->control[index] = value;
+
+    // Groups load past the end, the first bytes are mirrored there.
+    map->control[((index - (NB_HASH_MAP_GROUP_WIDTH - 1)) & mask) + (NB_HASH_MAP_GROUP_WIDTH - 1)] = value;
+}
+
+NB_INLINE u64
+nb_hash_map_slot_hash(NB_Hash_Map *map, u8 *slot) {
+    if (map->key_kind == NB_HASH_MAP_KEY_STRING) {
+        return ((NB_Hash_Map_String_Slot *)slot)->hash;
+    }
+
+    u64 key;
+    memcpy(&key, slot, 8);
+    return nb_hash_u64(key);
+}
+
+static s64
+nb_hash_map_find_slot(NB_Hash_Map *map, u64 hash, u64 key, NB_String string_key) {
+    if (!map->count) return -1;
+
+    s64 mask = map->capacity - 1;
+    s64 position = (s64)(nb_hash_map_h1(hash) & (u64)mask);
+    u8 h2 = nb_hash_map_h2(hash);
+
+    // Entries sit between their home slot and the first empty slot after it.
+    for (;;) {
+        u8 *group  = map->control + position;
+        u64 match  = nb_hash_map_group_match(group, h2);
+
+        while (match) {
+            s64 index = (position + nb_hash_map_mask_index(match)) & mask;
+            u8 *slot  = map->slots + index * map->slot_size;
+
+            if (map->control[index] == h2) {
+                if (map->key_kind == NB_HASH_MAP_KEY_STRING) {
+                    NB_Hash_Map_String_Slot *it = (NB_Hash_Map_String_Slot *)slot;
+                    if ((it->hash == hash) && (it->key.count == string_key.count) &&
+                        (!string_key.count || (memcmp(it->key.data, string_key.data, (umm)string_key.count) == 0))) {
+                        return index;
+                    }
+                } else {
+                    u64 slot_key;
+                    memcpy(&slot_key, slot, 8);
+                    if (slot_key == key) return index;
+                }
+            }
+
+            match &= match - 1;
+        }
+
+        if (nb_hash_map_group_empty(group)) return -1;
+
+        position = (position + NB_HASH_MAP_GROUP_WIDTH) & mask;
+    }
+}
+
+static s64
+nb_hash_map_find_empty(NB_Hash_Map *map, u64 hash) {
+    s64 mask = map->capacity - 1;
+    s64 position = (s64)(nb_hash_map_h1(hash) & (u64)mask);
+
+    // The table is never full, this ends.
+    for (;;) {
+        u64 empty = nb_hash_map_group_empty(map->control + position);
+        if (empty) return (position + nb_hash_map_mask_index(empty)) & mask;
+
+        position = (position + NB_HASH_MAP_GROUP_WIDTH) & mask;
+    }
+}
+
+NB_INLINE s64
+nb_hash_map_block_size(NB_Hash_Map *map, s64 capacity) {
+    return capacity * map->slot_size + capacity + NB_HASH_MAP_GROUP_WIDTH - 1;
+}
+
+static bool
+nb_hash_map_resize(NB_Hash_Map *map, s64 capacity) {
+    assert(nb_is_power_of_2(capacity));
+    assert(capacity >= NB_HASH_MAP_CAPACITY_MIN);
+
+    u8 *block = (u8 *)map->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_ALLOCATE, NB_HASH_MAP_ALLOCATOR_FLAGS),
+                                          nb_hash_map_block_size(map, capacity), 0,
+                                          null,
+                                          map->allocator.data);
+    if (!block) return false;
+
+    u8 *old_slots    = map->slots;
+    u8 *old_control  = map->control;
+    s64 old_capacity = map->capacity;
+
+    map->slots    = block;
+    map->control  = block + capacity * map->slot_size;
+    map->capacity = capacity;
+    map->growth_left = capacity * NB_HASH_MAP_LOAD_NUMERATOR / NB_HASH_MAP_LOAD_DENOMINATOR - map->count;
+    memset(map->control, NB_HASH_MAP_EMPTY, (umm)(capacity + NB_HASH_MAP_GROUP_WIDTH - 1));
+
+    for (s64 index = 0; index < old_capacity; ++index) {
+        if (old_control[index] == NB_HASH_MAP_EMPTY) continue;
+
+        u8 *old_slot = old_slots + index * map->slot_size;
+        u64 hash     = nb_hash_map_slot_hash(map, old_slot);
+        s64 target   = nb_hash_map_find_empty(map, hash);
+
+        nb_hash_map_set_control(map, target, nb_hash_map_h2(hash));
+        memcpy(map->slots + target * map->slot_size, old_slot, (umm)map->slot_size);
+    }
+
+    if (old_slots) {
+        map->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_FREE, NB_HASH_MAP_ALLOCATOR_FLAGS), 
+                            0, nb_hash_map_block_size(map, old_capacity), 
+                            old_slots, 
+                            map->allocator.data);
+    }
+
+    return true;
+}
+
+NB_EXTERN void
+nb_hash_map_init(NB_Hash_Map *map, NB_Hash_Map_Key key_kind, s64 value_size, s64 capacity, NB_Allocator allocator) {
+    assert(map);
+    assert(value_size >= 0);
+
+    s32 key_size = (key_kind == NB_HASH_MAP_KEY_STRING) ? (s32)size_of(NB_Hash_Map_String_Slot) : (s32)size_of(u64);
+
+    map->control     = null;
+    map->slots       = null;
+    map->count       = 0;
+    map->capacity    = 0;
+    map->growth_left = 0;
+
+    // Values are 8 bytes aligned.
+    map->key_kind     = key_kind;
+    map->value_size   = value_size;
+    map->value_offset = key_size;
+    map->slot_size    = (s32)nb_align_forward(key_size + value_size, 8);
+    map->allocator    = allocator.proc ? allocator : nb_current_allocator;
+
+    if (capacity > 0) nb_hash_map_reserve(map, capacity);
+}
+
+NB_EXTERN void
+nb_hash_map_release(NB_Hash_Map *map) {
+    if (map->slots) {
+        map->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_FREE, NB_HASH_MAP_ALLOCATOR_FLAGS), 
+                            0, nb_hash_map_block_size(map, map->capacity), 
+                            map->slots, 
+                            map->allocator.data);
+    }
+
+    map->control     = null;
+    map->slots       = null;
+    map->count       = 0;
+    map->capacity    = 0;
+    map->growth_left = 0;
+}
+
+NB_EXTERN void
+nb_hash_map_reset(NB_Hash_Map *map) {
+    if (!map->control) return;
+
+    memset(map->control, NB_HASH_MAP_EMPTY, (umm)(map->capacity + NB_HASH_MAP_GROUP_WIDTH - 1));
+    map->count       = 0;
+    map->growth_left = map->capacity * NB_HASH_MAP_LOAD_NUMERATOR / NB_HASH_MAP_LOAD_DENOMINATOR;
+}
+
+NB_EXTERN bool
+nb_hash_map_reserve(NB_Hash_Map *map, s64 count) {
+    s64 capacity = NB_HASH_MAP_CAPACITY_MIN;
+    while (capacity * NB_HASH_MAP_LOAD_NUMERATOR / NB_HASH_MAP_LOAD_DENOMINATOR < count) {
+        capacity *= 2;
+    }
+
+    if (capacity <= map->capacity) return true;
+    return nb_hash_map_resize(map, capacity);
+}
+
+static u8 *
+nb_hash_map_insert(NB_Hash_Map *map, u64 hash, u64 key, NB_String string_key) {
+    s64 index = nb_hash_map_find_slot(map, hash, key, string_key);
+    if (index >= 0) return map->slots + index * map->slot_size + map->value_offset;
+
+    if (map->growth_left <= 0) {
+        s64 capacity = map->capacity ? (map->capacity * 2) : NB_HASH_MAP_CAPACITY_MIN;
+        if (!nb_hash_map_resize(map, capacity)) return null;
+    }
+
+    index = nb_hash_map_find_empty(map, hash);
+    nb_hash_map_set_control(map, index, nb_hash_map_h2(hash));
+
+    u8 *slot = map->slots + index * map->slot_size;
+    if (map->key_kind == NB_HASH_MAP_KEY_STRING) {
+        NB_Hash_Map_String_Slot *it = (NB_Hash_Map_String_Slot *)slot;
+        it->key  = string_key;
+        it->hash = hash;
+    } else {
+        memcpy(slot, &key, 8);
+    }
+
+    memset(slot + map->value_offset, 0, (umm)map->value_size);
+
+    map->count       += 1;
+    map->growth_left -= 1;
+    return slot + map->value_offset;
+}
+
+static bool
+nb_hash_map_remove_slot(NB_Hash_Map *map, s64 index) {
+    if (index < 0) return false;
+
+    s64 mask = map->capacity - 1;
+    s64 hole = index;
+
+    // Backward shift: every entry of the cluster that may live in the hole
+    // moves there, so the probe invariant holds without tombstones.
+    for (s64 at = (index + 1) & mask; map->control[at] != NB_HASH_MAP_EMPTY; at = (at + 1) & mask) {
+        u8 *slot = map->slots + at * map->slot_size;
+        s64 home = (s64)(nb_hash_map_h1(nb_hash_map_slot_hash(map, slot)) & (u64)mask);
+
+        if (((at - home) & mask) >= ((at - hole) & mask)) {
+            memcpy(map->slots + hole * map->slot_size, slot, (umm)map->slot_size);
+            nb_hash_map_set_control(map, hole, map->control[at]);
+            hole = at;
+        }
+    }
+
+    nb_hash_map_set_control(map, hole, NB_HASH_MAP_EMPTY);
+    map->count       -= 1;
+    map->growth_left += 1;
+    return true;
+}
+
+NB_EXTERN void *
+nb_hash_map_find_u64(NB_Hash_Map *map, u64 key) {
+    assert(map->key_kind == NB_HASH_MAP_KEY_U64);
+
+    s64 index = nb_hash_map_find_slot(map, nb_hash_u64(key), key, nb_make_string(null, 0));
+    if (index < 0) return null;
+
+    return map->slots + index * map->slot_size + map->value_offset;
+}
+
+NB_EXTERN void *
+nb_hash_map_put_u64(NB_Hash_Map *map, u64 key) {
+    assert(map->key_kind == NB_HASH_MAP_KEY_U64);
+    return nb_hash_map_insert(map, nb_hash_u64(key), key, nb_make_string(null, 0));
+}
+
+NB_EXTERN bool
+nb_hash_map_remove_u64(NB_Hash_Map *map, u64 key) {
+    assert(map->key_kind == NB_HASH_MAP_KEY_U64);
+    return nb_hash_map_remove_slot(map, nb_hash_map_find_slot(map, nb_hash_u64(key), key, nb_make_string(null, 0)));
+}
+
+NB_EXTERN void *
+nb_hash_map_find_string(NB_Hash_Map *map, NB_String key) {
+    assert(map->key_kind == NB_HASH_MAP_KEY_STRING);
+
+    s64 index = nb_hash_map_find_slot(map, nb_hash_string(key), 0, key);
+    if (index < 0) return null;
+
+    return map->slots + index * map->slot_size + map->value_offset;
+}
+
+NB_EXTERN void *
+nb_hash_map_put_string(NB_Hash_Map *map, NB_String key) {
+    assert(map->key_kind == NB_HASH_MAP_KEY_STRING);
+    return nb_hash_map_insert(map, nb_hash_string(key), 0, key);
+}
+
+NB_EXTERN bool
+nb_hash_map_remove_string(NB_Hash_Map *map, NB_String key) {
+    assert(map->key_kind == NB_HASH_MAP_KEY_STRING);
+    return nb_hash_map_remove_slot(map, nb_hash_map_find_slot(map, nb_hash_string(key), 0, key));
+}
+
+NB_EXTERN bool
+nb_hash_map_next(NB_Hash_Map *map, s64 *cursor, void **key, void **value) {
+    for (s64 index = *cursor; index < map->capacity; ++index) {
+        if (map->control[index] == NB_HASH_MAP_EMPTY) continue;
+
+        u8 *slot = map->slots + index * map->slot_size;
+        if (key)   *key   = slot;
+        if (value) *value = slot + map->value_offset;
+
+        *cursor = index + 1;
+        return true;
+    }
+
+    *cursor = map->capacity;
+    return false;
+}
+
+
+
+NB_INLINE NB_Interner_Entry *
+nb_interner_entry(NB_Interner *interner, u32 id) {
+    // Chunk k starts at id FIRST_CHUNK_SIZE * (2^k - 1).
+    u32 chunk  = nb_find_most_significant_set_bit(id / NB_INTERNER_FIRST_CHUNK_SIZE + 1);
+    u32 offset = id - NB_INTERNER_FIRST_CHUNK_SIZE * ((1u << chunk) - 1);
+
+    return interner->chunks[chunk] + offset;
+}
+
+static s32
+nb_interner_lookup(NB_Interner *interner, NB_Interner_Table *table, NB_String s, u32 hash) {
+    s64 mask  = table->capacity - 1;
+    s64 index = (s64)hash & mask;
+
+    for (;;) {
+        s32 id = nb_atomic_load32(table->ids + index);
+        if (!id) return 0;
+
+        // The id is stored after its entry, the entry is complete.
+        NB_Interner_Entry *entry = nb_interner_entry(interner, (u32)id);
+        if ((entry->hash == hash) && (entry->count == (u32)s.count) && 
+            (memcmp(entry->data, s.data, (umm)s.count) == 0)) {
+            return id;
+        }
+
+        index = (index + 1) & mask;
+    }
+}
+
+static void
+nb_interner_table_insert(NB_Interner_Table *table, u32 hash, s32 id) {
+    s64 mask  = table->capacity - 1;
+    s64 index = (s64)hash & mask;
+
+    while (table->ids[index]) index = (index + 1) & mask;
+    nb_atomic_store32(table->ids + index, id);
+}
+
+// Returns a table with room for one more id, publishing a larger copy
+// when the current one is 3/4 full. Called with the lock held.
+static NB_Interner_Table *
+nb_interner_reserve_table(NB_Interner *interner, s32 count) {
+    NB_Interner_Table *table = interner->table;
+    if (table && ((s64)count * 4 < table->capacity * 3)) return table;
+
+    s64 capacity = table ? (table->capacity * 2) : NB_INTERNER_TABLE_SIZE_MIN;
+
+    NB_Interner_Table *new_table = (NB_Interner_Table *)nb_arena_alloc(&interner->arena, size_of(NB_Interner_Table));
+    if (!new_table) return null;
+
+    new_table->ids = (volatile s32 *)nb_arena_alloc(&interner->arena, capacity * size_of(s32));
+    if (!new_table->ids) return null;
+
+    new_table->capacity = capacity;
+    memset((void *)new_table->ids, 0, (umm)(capacity * size_of(s32)));
+
+    for (s32 id = 1; id < count; ++id) {
+        nb_interner_table_insert(new_table, nb_interner_entry(interner, (u32)id)->hash, id);
+    }
+
+    // Readers still walking the old table find a subset, they retry under the lock.
+    nb_atomic_store_pointer((void *volatile *)&interner->table, new_table);
+    return new_table;
+}
+
+NB_EXTERN void
+nb_interner_release(NB_Interner *interner) {
+    nb_arena_release(&interner->arena);
+    nb_memory_zero_struct(interner);
+}
+
+NB_EXTERN bool
+nb_interner_find(NB_Interner *interner, NB_String s, u32 *id) {
+    if (s.count == 0) {
+        *id = 0;
+        return true;
+    }
+
+    NB_Interner_Table *table = (NB_Interner_Table *)nb_atomic_load_pointer((void *volatile *)&interner->table);
+    if (!table) return false;
+
+    s32 found = nb_interner_lookup(interner, table, s, (u32)nb_hash_string(s));
+    if (!found) return false;
+
+    *id = (u32)found;
+    return true;
+}
+
+NB_EXTERN u32
+nb_intern(NB_Interner *interner, NB_String s) {
+    assert((s.count >= 0) && (s.count <= NB_MAX_S32));
+
+    u32 result;
+    if (nb_interner_find(interner, s, &result)) return result;
+
+    u32 hash = (u32)nb_hash_string(s);
+
+    nb_spin_lock(&interner->lock);
+
+    // Another thread may have added it since the lookup.
+    NB_Interner_Table *table = interner->table;
+    s32 id = table ? nb_interner_lookup(interner, table, s, hash) : 0;
+
+    if (!id) {
+        s32 count = interner->count ? interner->count : 1;
+        u32 chunk = nb_find_most_significant_set_bit((u32)count / NB_INTERNER_FIRST_CHUNK_SIZE + 1);
+        assert(chunk < NB_INTERNER_CHUNK_COUNT);
+
+        if (!interner->chunks[chunk]) {
+            s64 chunk_size = (s64)NB_INTERNER_FIRST_CHUNK_SIZE << chunk;
+            interner->chunks[chunk] = (NB_Interner_Entry *)nb_arena_alloc(&interner->arena, chunk_size * size_of(NB_Interner_Entry));
+        }
+
+        u8 *data = (u8 *)nb_arena_alloc_align(&interner->arena, s.count + 1, 1);
+        table    = nb_interner_reserve_table(interner, count);
+
+        if (interner->chunks[chunk] && data && table) {
+            memcpy(data, s.data, (umm)s.count);
+            data[s.count] = 0;
+
+            if (count == 1) {
+                NB_Interner_Entry *empty = interner->chunks[0];
+                empty->data  = (u8 *)"";
+                empty->count = 0;
+                empty->hash  = 0;
+            }
+
+            NB_Interner_Entry *entry = nb_interner_entry(interner, (u32)count);
+            entry->data  = data;
+            entry->count = (u32)s.count;
+            entry->hash  = hash;
+
+            id = count;
+            nb_atomic_store32(&interner->count, count + 1);
+            nb_interner_table_insert(table, hash, id);
+        } else {
+            nb_log_print(NB_LOG_ERROR, "Interner", "Out of memory while interning a string of %" NB_FMT_S64 " bytes.", s.count);
+        }
+    }
+
+    nb_spin_unlock(&interner->lock);
+    return (u32)id;
+}
+
+NB_EXTERN u32
+nb_intern_cstring(NB_Interner *interner, const char *s) {
+    return nb_intern(interner, nb_make_string((u8 *)s, s ? nb_string_length(s) : 0));
+}
+
+NB_EXTERN NB_String
+nb_interner_get(NB_Interner *interner, u32 id) {
+    if (id == 0) return nb_make_string((u8 *)"", 0);
+
+    assert((s32)id < nb_atomic_load32(&interner->count));
+
+    NB_Interner_Entry *entry = nb_interner_entry(interner, id);
+    return nb_make_string(entry->data, entry->count);
+}
+
+
+
+#define NB_HANDLE_POOL_ALLOCATOR_FLAGS (NB_ALLOCATOR_NO_ZERO | nb_allocator_align_flag(16))
+
+NB_INLINE u32
+nb_make_handle(u32 index, u32 generation) {
+    return (generation << NB_HANDLE_INDEX_BITS) | index;
+}
+
+static void *
+nb_handle_pool_resize_block(NB_Handle_Pool *pool, void *memory, s64 new_size, s64 old_size) {
+    return pool->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_RESIZE, NB_HANDLE_POOL_ALLOCATOR_FLAGS),
+                                new_size, old_size,
+                                memory,
+                                pool->allocator.data);
+}
+
+static bool
+nb_handle_pool_grow(NB_Handle_Pool *pool, u32 capacity) {
+    if (capacity > NB_HANDLE_CAPACITY_MAX) capacity = NB_HANDLE_CAPACITY_MAX;
+    if (capacity <= pool->capacity) return false;
+
+    s64 old_capacity = pool->capacity;
+
+    // Each block is updated as soon as it moved, a failure leaves the pool usable.
+    u8 *items = (u8 *)nb_handle_pool_resize_block(pool, pool->items, capacity * pool->item_size, old_capacity * pool->item_size);
+    if (!items) return false;
+    pool->items = items;
+
+    u32 *item_handles = (u32 *)nb_handle_pool_resize_block(pool, pool->item_handles, capacity * size_of(u32), old_capacity * size_of(u32));
+    if (!item_handles) return false;
+    pool->item_handles = item_handles;
+
+    NB_Handle_Slot *slots = (NB_Handle_Slot *)nb_handle_pool_resize_block(pool, pool->slots, capacity * size_of(NB_Handle_Slot), old_capacity * size_of(NB_Handle_Slot));
+    if (!slots) return false;
+    pool->slots = slots;
+
+    pool->capacity = capacity;
+    return true;
+}
+
+NB_EXTERN void
+nb_handle_pool_init(NB_Handle_Pool *pool, s64 item_size, s64 capacity, NB_Allocator allocator) {
+    assert(pool);
+    assert(item_size > 0);
+    assert((capacity >= 0) && (capacity <= NB_HANDLE_CAPACITY_MAX));
+
+    nb_memory_zero_struct(pool);
+    pool->item_size = item_size;
+    pool->free_head = NB_HANDLE_INDEX_MASK;
+    pool->free_tail = NB_HANDLE_INDEX_MASK;
+    pool->allocator = allocator.proc ? allocator : nb_current_allocator;
+
+    if (capacity > 0) nb_handle_pool_grow(pool, (u32)capacity);
+}
+
+NB_EXTERN void
+nb_handle_pool_release(NB_Handle_Pool *pool) {
+    void *blocks[] = {pool->items, pool->item_handles, pool->slots};
+
+    for (s64 index = 0; index < nb_array_count(blocks); ++index) {
+        if (!blocks[index]) continue;
+
+        pool->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_FREE, NB_HANDLE_POOL_ALLOCATOR_FLAGS), 
+                             0, 0, 
+                             blocks[index], 
+                             pool->allocator.data);
+    }
+
+    nb_handle_pool_init(pool, pool->item_size, 0, pool->allocator);
+}
+
+NB_EXTERN u32
+nb_handle_pool_add(NB_Handle_Pool *pool, void **item) {
+    u32 index;
+
+    if (pool->free_head != NB_HANDLE_INDEX_MASK) {
+        index = pool->free_head;
+        pool->free_head = pool->slots[index].dense_index;
+        if (pool->free_head == NB_HANDLE_INDEX_MASK) pool->free_tail = NB_HANDLE_INDEX_MASK;
+    } else {
+        if (pool->slot_count == pool->capacity) {
+            u32 capacity = pool->capacity ? (pool->capacity * 2) : 16;
+            if (!nb_handle_pool_grow(pool, capacity)) {
+                if (item) *item = null;
+                return NB_HANDLE_NONE;
+            }
+        }
+
+        index = pool->slot_count++;
+        pool->slots[index].generation = 1;
+    }
+
+    // The slots ever used never outnumber the capacity, so neither do the items.
+    NB_Handle_Slot *slot = pool->slots + index;
+    slot->dense_index = pool->count;
+
+    u32 handle = nb_make_handle(index, slot->generation);
+    pool->item_handles[pool->count] = handle;
+
+    void *result = nb_handle_pool_item(pool, pool->count);
+    memset(result, 0, (umm)pool->item_size);
+    pool->count += 1;
+
+    if (item) *item = result;
+    return handle;
+}
+
+NB_EXTERN bool
+nb_handle_pool_remove(NB_Handle_Pool *pool, u32 handle) {
+    if (!nb_handle_pool_get(pool, handle)) return false;
+
+    u32 index = nb_handle_index(handle);
+    NB_Handle_Slot *slot = pool->slots + index;
+
+    // The last item fills the hole.
+    u32 last = pool->count - 1;
+    if (slot->dense_index != last) {
+        memcpy(nb_handle_pool_item(pool, slot->dense_index), nb_handle_pool_item(pool, last), (umm)pool->item_size);
+
+        u32 moved = pool->item_handles[last];
+        pool->item_handles[slot->dense_index] = moved;
+        pool->slots[nb_handle_index(moved)].dense_index = slot->dense_index;
+    }
+
+    pool->count -= 1;
+
+    // Generation 0 is skipped, so a handle is never 0.
+    slot->generation = (slot->generation + 1) & NB_HANDLE_GENERATION_MASK;
+    if (slot->generation == 0) slot->generation = 1;
+
+    slot->dense_index = NB_HANDLE_INDEX_MASK;
+    if (pool->free_tail != NB_HANDLE_INDEX_MASK) {
+        pool->slots[pool->free_tail].dense_index = index;
+    } else {
+        pool->free_head = index;
+    }
+    pool->free_tail = index;
+
+    return true;
+}
+
+NB_EXTERN void
+nb_handle_pool_reset(NB_Handle_Pool *pool) {
+    while (pool->count) {
+        nb_handle_pool_remove(pool, pool->item_handles[pool->count - 1]);
+    }
+}
+
+
+
+#define NB_BUCKET_ARRAY_ALLOCATOR_FLAGS (NB_ALLOCATOR_NO_ZERO | nb_allocator_align_flag(NB_BUCKET_ARRAY_ALIGNMENT))
+
+NB_EXTERN void
+nb_bucket_array_init(NB_Bucket_Array *array, s64 item_size, NB_Allocator allocator) {
+    assert(array);
+    assert(item_size > 0);
+
+    nb_memory_zero_struct(array);
+    array->item_size = item_size;
+    array->allocator = allocator.proc ? allocator : nb_current_allocator;
+}
+
+NB_EXTERN void
+nb_bucket_array_release(NB_Bucket_Array *array) {
+    for (s64 index = 0; index < nb_array_length(array->buckets); ++index) {
+        array->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_FREE, NB_BUCKET_ARRAY_ALLOCATOR_FLAGS), 
+                              0, 0, 
+                              array->buckets[index], 
+                              array->allocator.data);
+    }
+
+    nb_array_free(array->buckets);
+    nb_array_free(array->unfull_buckets);
+    array->count = 0;
+}
+
+NB_EXTERN void *
+nb_bucket_array_add(NB_Bucket_Array *array, s64 *index) {
+    if (!array->buckets) {
+        nb_array_init(array->buckets, array->allocator, 4);
+        nb_array_init(array->unfull_buckets, array->allocator, 4);
+    }
+
+    if (!nb_array_length(array->unfull_buckets)) {
+        s64 bucket_size = NB_BUCKET_HEADER_SIZE + NB_BUCKET_ARRAY_BUCKET_SIZE * array->item_size;
+
+        // Both tables get room first, so a failure leaves nothing half done.
+        if (!nb_array_reserve(array->buckets, nb_array_length(array->buckets) + 1) ||
+            !nb_array_reserve(array->unfull_buckets, nb_array_length(array->buckets) + 1)) {
+            return null;
+        }
+
+        NB_Bucket *bucket = (NB_Bucket *)array->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_ALLOCATE, NB_BUCKET_ARRAY_ALLOCATOR_FLAGS),
+                                                               bucket_size, 0,
+                                                               null,
+                                                               array->allocator.data);
+        if (!bucket) return null;
+
+        bucket->occupied = 0;
+        nb_array_push(array->unfull_buckets, nb_array_length(array->buckets));
+        nb_array_push(array->buckets, bucket);
+    }
+
+    s64 bucket_index  = nb_array_last(array->unfull_buckets);
+    NB_Bucket *bucket = array->buckets[bucket_index];
+
+    s64 slot = (s64)nb_find_least_significant_set_bit64(~bucket->occupied);
+    bucket->occupied |= 1ull << slot;
+    if (bucket->occupied == ~0ull) nb_array_header(array->unfull_buckets)->count -= 1;
+
+    array->count += 1;
+    if (index) *index = bucket_index * NB_BUCKET_ARRAY_BUCKET_SIZE + slot;
+
+    void *result = (u8 *)bucket + NB_BUCKET_HEADER_SIZE + slot * array->item_size;
+    memset(result, 0, (umm)array->item_size);
+    return result;
+}
+
+NB_EXTERN bool
+nb_bucket_array_remove(NB_Bucket_Array *array, s64 index) {
+    if (!nb_bucket_array_get(array, index)) return false;
+
+    s64 bucket_index  = index / NB_BUCKET_ARRAY_BUCKET_SIZE;
+    NB_Bucket *bucket = array->buckets[bucket_index];
+
+    // unfull_buckets has room for every bucket, this push does not allocate.
+    if (bucket->occupied == ~0ull) nb_array_push(array->unfull_buckets, bucket_index);
+
+    bucket->occupied &= ~(1ull << (index % NB_BUCKET_ARRAY_BUCKET_SIZE));
+    array->count -= 1;
+    return true;
+}
+
+NB_EXTERN bool
+nb_bucket_array_next(NB_Bucket_Array *array, s64 *cursor, void **item) {
+    s64 bucket_count = nb_array_length(array->buckets);
+
+    for (s64 bucket_index = *cursor / NB_BUCKET_ARRAY_BUCKET_SIZE; bucket_index < bucket_count; ++bucket_index) {
+        NB_Bucket *bucket = array->buckets[bucket_index];
+
+        // Drops the slots before the cursor in its own bucket.
+        u64 occupied = bucket->occupied;
+        s64 first    = bucket_index * NB_BUCKET_ARRAY_BUCKET_SIZE;
+        if (*cursor > first) occupied &= ~0ull << (*cursor - first);
+
+        if (occupied) {
+            s64 slot = (s64)nb_find_least_significant_set_bit64(occupied);
+            *item    = (u8 *)bucket + NB_BUCKET_HEADER_SIZE + slot * array->item_size;
+            *cursor  = first + slot + 1;
+            return true;
+        }
+    }
+
+    *cursor = bucket_count * NB_BUCKET_ARRAY_BUCKET_SIZE;
+    return false;
+}
+
+
+
+#define NB_RING_ALLOCATOR_FLAGS (NB_ALLOCATOR_NO_ZERO | nb_allocator_align_flag(NB_CACHE_LINE_SIZE))
+
+NB_INLINE s64
+nb_ring_capacity(s64 capacity) {
+    s64 result = 2;
+    while (result < capacity) result *= 2;
+    return result;
+}
+
+NB_INLINE void *
+nb_ring_alloc(NB_Allocator allocator, s64 size) {
+    return allocator.proc(nb_allocator_mode(NB_ALLOCATOR_ALLOCATE, NB_RING_ALLOCATOR_FLAGS), 
+                          size, 0, 
+                          null, 
+                          allocator.data);
+}
+
+NB_INLINE void
+nb_ring_free(NB_Allocator allocator, void *memory) {
+    if (!memory) return;
+    allocator.proc(nb_allocator_mode(NB_ALLOCATOR_FREE, NB_RING_ALLOCATOR_FLAGS), 0, 0, memory, allocator.data);
+}
+
+// Copies 'count' items between a linear buffer and the ring, wrapping around.
+static void
+nb_ring_copy(u8 *ring_items, s64 capacity, s64 item_size, s64 position, u8 *items, s64 count, bool to_ring) {
+    s64 start = position & (capacity - 1);
+    s64 first = nb_min(count, capacity - start);
+
+    u8 *at = ring_items + start * item_size;
+    if (to_ring) {
+        memcpy(at, items, (umm)(first * item_size));
+        memcpy(ring_items, items + first * item_size, (umm)((count - first) * item_size));
+    } else {
+        memcpy(items, at, (umm)(first * item_size));
+        memcpy(items + first * item_size, ring_items, (umm)((count - first) * item_size));
+    }
+}
+
+NB_EXTERN bool
+nb_spsc_ring_init(NB_SPSC_Ring *ring, s64 item_size, s64 capacity, NB_Allocator allocator) {
+    assert(ring);
+    assert((item_size > 0) && (capacity > 0));
+
+    nb_memory_zero_struct(ring);
+    ring->item_size = item_size;
+    ring->capacity  = nb_ring_capacity(capacity);
+    ring->allocator = allocator.proc ? allocator : nb_current_allocator;
+
+    ring->items = (u8 *)nb_ring_alloc(ring->allocator, ring->capacity * item_size);
+    return ring->items != null;
+}
+
+NB_EXTERN void
+nb_spsc_ring_release(NB_SPSC_Ring *ring) {
+    nb_ring_free(ring->allocator, ring->items);
+    ring->items = null;
+}
+
+NB_EXTERN s64
+nb_spsc_ring_push(NB_SPSC_Ring *ring, void *items, s64 count) {
+    s64 tail = ring->tail;  // Only this thread writes it.
+
+    if (tail - ring->cached_head + count > ring->capacity) {
+        ring->cached_head = nb_atomic_load_acquire64(&ring->head);
+    }
+
+    s64 room = ring->capacity - (tail - ring->cached_head);
+    if (count > room) count = room;
+    if (count <= 0) return 0;
+
+    nb_ring_copy(ring->items, ring->capacity, ring->item_size, tail, (u8 *)items, count, true);
+    nb_atomic_store_release64(&ring->tail, tail + count);
+    return count;
+}
+
+NB_EXTERN s64
+nb_spsc_ring_pop(NB_SPSC_Ring *ring, void *items, s64 count) {
+    s64 head = ring->head;  // Only this thread writes it.
+
+    if (ring->cached_tail - head < count) {
+        ring->cached_tail = nb_atomic_load_acquire64(&ring->tail);
+    }
+
+    s64 available = ring->cached_tail - head;
+    if (count > available) count = available;
+    if (count <= 0) return 0;
+
+    nb_ring_copy(ring->items, ring->capacity, ring->item_size, head, (u8 *)items, count, false);
+    nb_atomic_store_release64(&ring->head, head + count);
+    return count;
+}
+
+NB_EXTERN bool
+nb_mpmc_ring_init(NB_MPMC_Ring *ring, s64 item_size, s64 capacity, NB_Allocator allocator) {
+    assert(ring);
+    assert((item_size > 0) && (capacity > 0));
+
+    nb_memory_zero_struct(ring);
+    ring->item_size = item_size;
+    ring->capacity  = nb_ring_capacity(capacity);
+    ring->allocator = allocator.proc ? allocator : nb_current_allocator;
+
+    ring->items     = (u8 *)nb_ring_alloc(ring->allocator, ring->capacity * item_size);
+    ring->sequences = (volatile s64 *)nb_ring_alloc(ring->allocator, ring->capacity * size_of(s64));
+    if (!ring->items || !ring->sequences) {
+        nb_mpmc_ring_release(ring);
+        return false;
+    }
+
+    // Cell i is ready for the push at position i.
+    for (s64 index = 0; index < ring->capacity; ++index) {
+        ring->sequences[index] = index;
+    }
+
+    return true;
+}
+
+NB_EXTERN void
+nb_mpmc_ring_release(NB_MPMC_Ring *ring) {
+    nb_ring_free(ring->allocator, ring->items);
+    nb_ring_free(ring->allocator, (void *)ring->sequences);
+    ring->items     = null;
+    ring->sequences = null;
+}
+
+//
+// A cell at 'position' is free for a push when its sequence is 'position',
+// and full for a pop when it is 'position + 1'. Popping sets it to
+// 'position + capacity', the push of the next lap.
+//
+// A run of cells checked ready stays ready until the position moves, as
+// only the thread that moved the position past a cell touches it, so one
+// successful compare exchange claims the whole run.
+//
+
+NB_EXTERN s64
+nb_mpmc_ring_push(NB_MPMC_Ring *ring, void *items, s64 count) {
+    s64 mask = ring->capacity - 1;
+    s64 position = nb_atomic_load_acquire64(&ring->enqueue_position);
+    s64 claimed;
+
+    for (;;) {
+        claimed = 0;
+        while ((claimed < count) && 
+               (nb_atomic_load_acquire64(ring->sequences + ((position + claimed) & mask)) == position + claimed)) {
+            claimed += 1;
+        }
+
+        if (!claimed) {
+            // Full unless another producer moved on meanwhile.
+            s64 current = nb_atomic_load_acquire64(&ring->enqueue_position);
+            if (current == position) return 0;
+
+            position = current;
+            continue;
+        }
+
+        s64 previous = nb_atomic_compare_exchange64(&ring->enqueue_position, position, position + claimed);
+        if (previous == position) break;
+
+        position = previous;
+        nb_cpu_relax();
+    }
+
+    nb_ring_copy(ring->items, ring->capacity, ring->item_size, position, (u8 *)items, claimed, true);
+
+    for (s64 index = 0; index < claimed; ++index) {
+        nb_atomic_store_release64(ring->sequences + ((position + index) & mask), position + index + 1);
+    }
+
+    return claimed;
+}
+
+NB_EXTERN s64
+nb_mpmc_ring_pop(NB_MPMC_Ring *ring, void *items, s64 count) {
+    s64 mask = ring->capacity - 1;
+    s64 position = nb_atomic_load_acquire64(&ring->dequeue_position);
+    s64 claimed;
+
+    for (;;) {
+        claimed = 0;
+        while ((claimed < count) && 
+               (nb_atomic_load_acquire64(ring->sequences + ((position + claimed) & mask)) == position + claimed + 1)) {
+            claimed += 1;
+        }
+
+        if (!claimed) {
+            s64 current = nb_atomic_load_acquire64(&ring->dequeue_position);
+            if (current == position) return 0;
+
+            position = current;
+            continue;
+        }
+
+        s64 previous = nb_atomic_compare_exchange64(&ring->dequeue_position, position, position + claimed);
+        if (previous == position) break;
+
+        position = previous;
+        nb_cpu_relax();
+    }
+
+    nb_ring_copy(ring->items, ring->capacity, ring->item_size, position, (u8 *)items, claimed, false);
+
+    for (s64 index = 0; index < claimed; ++index) {
+        nb_atomic_store_release64(ring->sequences + ((position + index) & mask), position + index + ring->capacity);
+    }
+
+    return claimed;
+}
+
+
+
+#define NB_SMALL_BUFFER_ALLOCATOR_FLAGS (NB_ALLOCATOR_NO_ZERO | nb_allocator_align_flag(16))
+
+// Moves an inline buffer to the heap, or grows the heap buffer.
+static void *
+nb_small_buffer_grow(NB_Allocator *allocator, void *heap, void *buffer, s64 used_size, s64 old_size, s64 new_size) {
+    if (!allocator->proc) *allocator = nb_current_allocator;
+
+    u8 *result;
+    if (heap) {
+        result = (u8 *)allocator->proc(nb_allocator_mode(NB_ALLOCATOR_RESIZE, NB_SMALL_BUFFER_ALLOCATOR_FLAGS),
+                                       new_size, old_size,
+                                       heap,
+                                       allocator->data);
+    } else {
+        result = (u8 *)allocator->proc(nb_allocator_mode(NB_ALLOCATOR_ALLOCATE, NB_SMALL_BUFFER_ALLOCATOR_FLAGS),
+                                       new_size, 0,
+                                       null,
+                                       allocator->data);
+        if (result) memcpy(result, buffer, (umm)used_size);
+    }
 
     return result;
 }
 
-NB_EXTERN u32 nb_logger_push_mode(u32 mode) {
-    u32 result = nb_current_logger_mode;
-    nb_current_logger_mode = mode;
+NB_EXTERN void
+nb_small_string_init(NB_Small_String *s, NB_Allocator allocator) {
+    s->heap      = null;
+    s->count     = 0;
+    s->capacity  = 0;
+    s->allocator = allocator;
+    s->buffer[0] = 0;
+}
+
+NB_EXTERN void
+nb_small_string_release(NB_Small_String *s) {
+    if (s->heap) {
+        s->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_FREE, NB_SMALL_BUFFER_ALLOCATOR_FLAGS), 0, 0, s->heap, s->allocator.data);
+    }
+
+    nb_small_string_init(s, s->allocator);
+}
+
+NB_EXTERN bool
+nb_small_string_reserve(NB_Small_String *s, s64 count) {
+    s64 capacity = s->heap ? s->capacity : (NB_SMALL_STRING_INLINE_SIZE - 1);
+    if (count <= capacity) return true;
+
+    s64 new_capacity = nb_max(count, capacity * 2);
+    char *heap = (char *)nb_small_buffer_grow(&s->allocator, s->heap, s->buffer, 
+                                              s->count + 1, 
+                                              s->heap ? (s->capacity + 1) : 0, 
+                                              new_capacity + 1);
+    if (!heap) return false;
+
+    s->heap     = heap;
+    s->capacity = new_capacity;
+    return true;
+}
+
+NB_EXTERN bool
+nb_small_string_append(NB_Small_String *s, NB_String text) {
+    if (!nb_small_string_reserve(s, s->count + text.count)) return false;
+
+    char *data = nb_small_string_cstring(s);
+    if (text.count) memcpy(data + s->count, text.data, (umm)text.count);
+
+    s->count += text.count;
+    data[s->count] = 0;
+    return true;
+}
+
+NB_EXTERN bool
+nb_small_string_append_cstring(NB_Small_String *s, const char *text) {
+    return nb_small_string_append(s, nb_make_string((u8 *)text, nb_string_length(text)));
+}
+
+NB_EXTERN bool
+nb_small_string_print_valist(NB_Small_String *s, const char *fmt, va_list arg_list) {
+    s64 capacity = s->heap ? s->capacity : (NB_SMALL_STRING_INLINE_SIZE - 1);
+    s64 room     = capacity - s->count + 1;
+
+    // Formats in place first, most strings fit.
+    va_list args;
+    va_copy(args, arg_list);
+    int len = vsnprintf(nb_small_string_cstring(s) + s->count, (size_t)room, fmt, args);
+    va_end(args);
+
+    if (len < 0) {
+        nb_small_string_cstring(s)[s->count] = 0;
+        return false;
+    }
+
+    if (len >= room) {
+        if (!nb_small_string_reserve(s, s->count + len)) {
+            nb_small_string_cstring(s)[s->count] = 0;
+            return false;
+        }
+
+        va_copy(args, arg_list);
+        vsnprintf(nb_small_string_cstring(s) + s->count, (size_t)len + 1, fmt, args);
+        va_end(args);
+    }
+
+    s->count += len;
+    return true;
+}
+
+NB_EXTERN bool
+nb_small_string_print(NB_Small_String *s, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    bool result = nb_small_string_print_valist(s, fmt, args);
+    va_end(args);
 
     return result;
 }
 
-NB_Allocator nb_current_allocator = {nb_heap_allocator, null};
+NB_EXTERN void
+nb_small_array_init(NB_Small_Array *array, s64 item_size, NB_Allocator allocator) {
+    assert(item_size > 0);
 
-// @Cleanup:
-nb_thread_local NB_Temporary_Storage nb_temporary_storage;
-nb_thread_local NB_Allocator nb_temporary_allocator = {nb_temporary_storage_proc, null};
+    array->heap      = null;
+    array->count     = 0;
+    array->capacity  = 0;
+    array->item_size = item_size;
+    array->allocator = allocator;
+}
 
+NB_EXTERN void
+nb_small_array_release(NB_Small_Array *array) {
+    if (array->heap) {
+        array->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_FREE, NB_SMALL_BUFFER_ALLOCATOR_FLAGS), 0, 0, array->heap, array->allocator.data);
+    }
 
-#if OS_WINDOWS
+    nb_small_array_init(array, array->item_size, array->allocator);
+}
 
-#ifdef NB_INCLUDE_WINDEFS
-#include "windefs.h"
+NB_EXTERN bool
+nb_small_array_reserve(NB_Small_Array *array, s64 count) {
+    assert(array->item_size > 0);
+
+    s64 capacity = array->heap ? array->capacity : (NB_SMALL_ARRAY_INLINE_SIZE / array->item_size);
+    if (count <= capacity) return true;
+
+    s64 new_capacity = nb_max(count, capacity * 2);
+    u8 *heap = (u8 *)nb_small_buffer_grow(&array->allocator, array->heap, array->buffer, 
+                                          array->count * array->item_size, 
+                                          array->heap ? (array->capacity * array->item_size) : 0, 
+                                          new_capacity * array->item_size);
+    if (!heap) return false;
+
+    array->heap     = heap;
+    array->capacity = new_capacity;
+    return true;
+}
+
+NB_EXTERN void *
+nb_small_array_add(NB_Small_Array *array, s64 count) {
+    if (!nb_small_array_reserve(array, array->count + count)) return null;
+
+    u8 *result = (u8 *)nb_small_array_items(array) + array->count * array->item_size;
+    array->count += count;
+    return result;
+}
+
+NB_EXTERN bool
+nb_small_array_push(NB_Small_Array *array, void *item) {
+    void *at = nb_small_array_add(array, 1);
+    if (!at) return false;
+
+    memcpy(at, item, (umm)array->item_size);
+    return true;
+}
+
+
+
+typedef enum NB_Bitset_Op {
+    NB_BITSET_AND,
+    NB_BITSET_OR,
+    NB_BITSET_XOR,
+    NB_BITSET_ANDNOT,
+} NB_Bitset_Op;
+
+typedef struct NB_Bitset_Kernels {
+    void (*binary)(u64 *dest, u64 *a, u64 *b, s64 word_count, NB_Bitset_Op op);
+    s64  (*popcount)(u64 *words, s64 word_count);
+} NB_Bitset_Kernels;
+
+static void
+nb_bitset_binary_scalar(u64 *dest, u64 *a, u64 *b, s64 word_count, NB_Bitset_Op op) {
+    switch (op) {
+        case NB_BITSET_AND:    for (s64 index = 0; index < word_count; ++index) dest[index] = a[index] &  b[index]; break;
+        case NB_BITSET_OR:     for (s64 index = 0; index < word_count; ++index) dest[index] = a[index] |  b[index]; break;
+        case NB_BITSET_XOR:    for (s64 index = 0; index < word_count; ++index) dest[index] = a[index] ^  b[index]; break;
+        case NB_BITSET_ANDNOT: for (s64 index = 0; index < word_count; ++index) dest[index] = a[index] & ~b[index]; break;
+    }
+}
+
+static s64
+nb_bitset_popcount_scalar(u64 *words, s64 word_count) {
+    s64 result = 0;
+    for (s64 index = 0; index < word_count; ++index) {
+        result += nb_count_set_bits64(words[index]);
+    }
+
+    return result;
+}
+
+static const NB_Bitset_Kernels nb_bitset_scalar_kernels = {
+    nb_bitset_binary_scalar,
+    nb_bitset_popcount_scalar,
+};
+
+#if NB_BITSET_AVX2
+#include <immintrin.h>
+
+#if COMPILER_GCC || COMPILER_CLANG
+#define NB_TARGET_AVX2 __attribute__((target("avx2")))
 #else
-#ifndef NOMINMAX
-#define NOMINMAX
+#define NB_TARGET_AVX2
 #endif
 
-#define UNICODE
-#define _UNICODE
+#define NB_BITSET_AVX2_LOOP(intrinsic, scalar_expression) \
+    for (; index + 4 <= word_count; index += 4) { \
+        __m256i va = _mm256_loadu_si256((__m256i *)(a + index)); \
+        __m256i vb = _mm256_loadu_si256((__m256i *)(b + index)); \
+        _mm256_storeu_si256((__m256i *)(dest + index), intrinsic); \
+    } \
+    for (; index < word_count; ++index) dest[index] = scalar_expression; \
+    break
+
+NB_TARGET_AVX2 static void
+nb_bitset_binary_avx2(u64 *dest, u64 *a, u64 *b, s64 word_count, NB_Bitset_Op op) {
+    s64 index = 0;
+
+    switch (op) {
+        case NB_BITSET_AND:    NB_BITSET_AVX2_LOOP(_mm256_and_si256(va, vb),    a[index] &  b[index]);
+        case NB_BITSET_OR:     NB_BITSET_AVX2_LOOP(_mm256_or_si256(va, vb),     a[index] |  b[index]);
+        case NB_BITSET_XOR:    NB_BITSET_AVX2_LOOP(_mm256_xor_si256(va, vb),    a[index] ^  b[index]);
+        case NB_BITSET_ANDNOT: NB_BITSET_AVX2_LOOP(_mm256_andnot_si256(vb, va), a[index] & ~b[index]);
+    }
+}
 
-#define WIN32_LEAN_AND_MEAN
-#define VC_EXTRALEAN
-#include <windows.h>
+NB_TARGET_AVX2 static s64
+nb_bitset_popcount_avx2(u64 *words, s64 word_count) {
+    // Counts the nibbles with a shuffle lookup and sums the bytes with sad (W. Mula).
+    __m256i lookup   = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    __m256i low_mask = _mm256_set1_epi8(0x0f);
+    __m256i total    = _mm256_setzero_si256();
+
+    s64 index = 0;
+    for (; index + 4 <= word_count; index += 4) {
+        __m256i v  = _mm256_loadu_si256((__m256i *)(words + index));
+        __m256i lo = _mm256_and_si256(v, low_mask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+
+        __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+    }
+
+    u64 lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, total);
+
+    s64 result = (s64)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    for (; index < word_count; ++index) {
+        result += nb_count_set_bits64(words[index]);
+    }
+
+    return result;
+}
+
+static const NB_Bitset_Kernels nb_bitset_avx2_kernels = {
+    nb_bitset_binary_avx2,
+    nb_bitset_popcount_avx2,
+};
 #endif
 
+NB_EXTERN bool
+nb_cpu_supports_avx2(void) {
+#if !(ARCH_X64 || ARCH_X86)
+    return false;
+#elif COMPILER_GCC || COMPILER_CLANG
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif COMPILER_CL
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
 
-#if COMPILER_CL
-#pragma comment(lib, "User32.lib")
+    // The OS must save the ymm registers too.
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || ((_xgetbv(0) & 6) != 6)) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
 #endif
+}
 
+static const NB_Bitset_Kernels *volatile nb_bitset_kernels;
 
-void nb_write_string(const char *s, bool to_standard_error) {
-    DWORD written = 0;
-    HANDLE handle = to_standard_error ? GetStdHandle(STD_ERROR_HANDLE) : GetStdHandle(STD_OUTPUT_HANDLE);
-    s32 status = WriteFile(handle, s, (DWORD)nb_string_length(s), &written, null);
-    UNUSED(status);
+static const NB_Bitset_Kernels *
+nb_bitset_get_kernels(void) {
+    const NB_Bitset_Kernels *result = (const NB_Bitset_Kernels *)nb_atomic_load_pointer((void *volatile *)&nb_bitset_kernels);
+    if (result) return result;
+
+    // Racing threads pick the same table.
+    result = &nb_bitset_scalar_kernels;
+#if NB_BITSET_AVX2
+    if (nb_cpu_supports_avx2()) result = &nb_bitset_avx2_kernels;
+#endif
+
+    nb_atomic_store_pointer((void *volatile *)&nb_bitset_kernels, (void *)result);
+    return result;
 }
 
-void nb_write_string_count(const char *s, u32 count, bool to_standard_error) {
-    DWORD written = 0;
-    HANDLE handle = to_standard_error ? GetStdHandle(STD_ERROR_HANDLE) : GetStdHandle(STD_OUTPUT_HANDLE);
-    s32 status = WriteFile(handle, s, count, &written, null);
-    UNUSED(status);
+NB_INLINE u64
+nb_bitset_last_word_mask(s64 count) {
+    return (count & 63) ? ((1ull << (count & 63)) - 1) : ~0ull;
 }
 
-void nb_write_new_string(NB_String s, bool to_standard_error) {
-    DWORD written = 0;
-    HANDLE handle = to_standard_error ? GetStdHandle(STD_ERROR_HANDLE) : GetStdHandle(STD_OUTPUT_HANDLE);
-    s32 status = WriteFile(handle, s.data, (DWORD)s.count, &written, null);
-    UNUSED(status);
+NB_EXTERN bool
+nb_bitset_init(NB_Bitset *set, s64 count, NB_Allocator allocator) {
+    assert(count >= 0);
+
+    set->words         = null;
+    set->count         = 0;
+    set->word_capacity = 0;
+    set->allocator     = allocator.proc ? allocator : nb_current_allocator;
+
+    return nb_bitset_resize(set, count);
 }
 
-static const char *ansi_system_console_text_colors[NB_TEXT_COUNT] = {
-    "\x1b[30m",   // NB_TEXT_BLACK
-    "\x1b[34m",   // NB_TEXT_DARK_BLUE
-    "\x1b[32m",   // NB_TEXT_DARK_GREEN
-    "\x1b[36m",   // NB_TEXT_LIGHT_BLUE
-    "\x1b[31m",   // NB_TEXT_DARK_RED
-    "\x1b[35m",   // NB_TEXT_MAGENTA
-    "\x1b[33m",   // NB_TEXT_ORANGE
-    "\x1b[37m",   // NB_TEXT_LIGHT_GRAY
-    "\x1b[90m",   // NB_TEXT_GRAY
-    "\x1b[94m",   // NB_TEXT_BLUE
-    "\x1b[92m",   // NB_TEXT_GREEN
-    "\x1b[96m",   // NB_TEXT_CYAN
-    "\x1b[91m",   // NB_TEXT_RED
-    "\x1b[95m",   // NB_TEXT_PURPLE
-    "\x1b[93m",   // NB_TEXT_YELLOW
-    "\x1b[97m",   // NB_TEXT_WHITE
-};
+NB_EXTERN void
+nb_bitset_init_buffer(NB_Bitset *set, u64 *words, s64 count) {
+    assert(words && (count >= 0));
 
-static u8 w32_system_console_text_colors[NB_TEXT_COUNT] = {
-    0,   // NB_TEXT_BLACK
-    1,   // NB_TEXT_DARK_BLUE
-    2,   // NB_TEXT_DARK_GREEN
-    3,   // NB_TEXT_LIGHT_BLUE
-    4,   // NB_TEXT_DARK_RED
-    5,   // NB_TEXT_MAGENTA
-    6,   // NB_TEXT_ORANGE
-    7,   // NB_TEXT_LIGHT_GRAY
-    8,   // NB_TEXT_GRAY
-    9,   // NB_TEXT_BLUE
-    10,  // NB_TEXT_GREEN
-    11,  // NB_TEXT_CYAN
-    12,  // NB_TEXT_RED
-    13,  // NB_TEXT_PURPLE
-    14,  // NB_TEXT_YELLOW
-    15,  // NB_TEXT_WHITE
-};
+    set->words         = words;
+    set->count         = count;
+    set->word_capacity = NB_BITSET_WORD_COUNT(count);
+    set->allocator.proc = null;
+    set->allocator.data = null;
+
+    memset(words, 0, (umm)(set->word_capacity * size_of(u64)));
+}
+
+NB_EXTERN void
+nb_bitset_release(NB_Bitset *set) {
+    if (set->allocator.proc && set->words) {
+        set->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_FREE, nb_allocator_align_flag(32)), 0, 0, set->words, set->allocator.data);
+    }
+
+    set->words         = null;
+    set->count         = 0;
+    set->word_capacity = 0;
+}
+
+NB_EXTERN bool
+nb_bitset_resize(NB_Bitset *set, s64 count) {
+    assert(count >= 0);
+
+    s64 word_count     = NB_BITSET_WORD_COUNT(count);
+    s64 old_word_count = NB_BITSET_WORD_COUNT(set->count);
+
+    if (word_count > set->word_capacity) {
+        if (!set->allocator.proc) return false;
+
+        s64 capacity = nb_max(word_count, set->word_capacity * 2);
+        u64 *words = (u64 *)set->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_RESIZE, NB_ALLOCATOR_NO_ZERO | nb_allocator_align_flag(32)),
+                                                capacity * size_of(u64), set->word_capacity * size_of(u64),
+                                                set->words,
+                                                set->allocator.data);
+        if (!words) return false;
+
+        set->words         = words;
+        set->word_capacity = capacity;
+    }
+
+    if (count > set->count) {
+        // The tail of the last word is already clear.
+        memset(set->words + old_word_count, 0, (umm)((word_count - old_word_count) * size_of(u64)));
+    } else if (word_count) {
+        set->words[word_count - 1] &= nb_bitset_last_word_mask(count);
+    }
+
+    set->count = count;
+    return true;
+}
+
+static void
+nb_bitset_fill_range(NB_Bitset *set, s64 first, s64 count, bool value) {
+    assert((first >= 0) && (count >= 0) && (first + count <= set->count));
+    if (!count) return;
+
+    s64 last       = first + count - 1;
+    s64 first_word = first >> 6;
+    s64 last_word  = last >> 6;
+
+    u64 first_mask = ~0ull << (first & 63);
+    u64 last_mask  = ~0ull >> (63 - (last & 63));
+
+    if (first_word == last_word) {
+        u64 mask = first_mask & last_mask;
+        if (value) set->words[first_word] |= mask;
+        else       set->words[first_word] &= ~mask;
+        return;
+    }
 
-NB_EXTERN void 
-nb_set_console_text_color(NB_System_Console_Text_Color color, 
-                          bool to_standard_error) {
-#ifdef NB_WINDOWS_CONSOLE_USE_ANSI
-    nb_write_string(ansi_system_console_text_colors[color], to_standard_error);
-#else
-    HANDLE handle = to_standard_error ? GetStdHandle(STD_ERROR_HANDLE) : GetStdHandle(STD_OUTPUT_HANDLE);
-    SetConsoleTextAttribute(handle, w32_system_console_text_colors[color]);
-#endif
+    if (value) set->words[first_word] |= first_mask;
+    else       set->words[first_word] &= ~first_mask;
+
+    memset(set->words + first_word + 1, value ? 0xFF : 0, (umm)((last_word - first_word - 1) * size_of(u64)));
+
+    if (value) set->words[last_word] |= last_mask;
+    else       set->words[last_word] &= ~last_mask;
 }
 
-NB_EXTERN void 
-nb_set_console_text_color_ansi(NB_System_Console_Text_Color color, 
-                               bool to_standard_error) {
-    nb_write_string(ansi_system_console_text_colors[color], to_standard_error);
+NB_EXTERN void
+nb_bitset_set_range(NB_Bitset *set, s64 first, s64 count) {
+    nb_bitset_fill_range(set, first, count, true);
 }
 
-#include <stdio.h>
+NB_EXTERN void
+nb_bitset_clear_range(NB_Bitset *set, s64 first, s64 count) {
+    nb_bitset_fill_range(set, first, count, false);
+}
 
-NB_EXTERN bool 
-nb_abort_error_message(const char *title, 
-                       const char *message, 
-                       const char *details) {
-    char *full_message = tprint("%s%s", message, details);
+NB_EXTERN void
+nb_bitset_clear_all(NB_Bitset *set) {
+    memset(set->words, 0, (umm)(NB_BITSET_WORD_COUNT(set->count) * size_of(u64)));
+}
 
-    int id = MessageBoxA(null, full_message, title, 
-                         MB_ABORTRETRYIGNORE|MB_ICONERROR|MB_SYSTEMMODAL|MB_DEFBUTTON3);
-    if (id == IDABORT) {
-        ExitProcess(0);
+NB_EXTERN s64
+nb_bitset_popcount(NB_Bitset *set) {
+    return nb_bitset_get_kernels()->popcount(set->words, NB_BITSET_WORD_COUNT(set->count));
+}
+
+NB_EXTERN s64
+nb_bitset_find_next_set(NB_Bitset *set, s64 from) {
+    assert(from >= 0);
+    if (from >= set->count) return -1;
+
+    s64 word_count = NB_BITSET_WORD_COUNT(set->count);
+    s64 word_index = from >> 6;
+    u64 word       = set->words[word_index] & (~0ull << (from & 63));
+
+    for (;;) {
+        // Bits past the count are clear, a hit is in range.
+        if (word) return (word_index << 6) + nb_find_least_significant_set_bit64(word);
+
+        word_index += 1;
+        if (word_index >= word_count) return -1;
+
+        word = set->words[word_index];
     }
+}
 
-    return (id == IDRETRY);
+NB_EXTERN s64
+nb_bitset_find_next_clear(NB_Bitset *set, s64 from) {
+    assert(from >= 0);
+    if (from >= set->count) return -1;
+
+    s64 word_count = NB_BITSET_WORD_COUNT(set->count);
+    s64 word_index = from >> 6;
+    u64 word       = ~set->words[word_index] & (~0ull << (from & 63));
+
+    for (;;) {
+        if (word) {
+            s64 result = (word_index << 6) + nb_find_least_significant_set_bit64(word);
+            return (result < set->count) ? result : -1;
+        }
+
+        word_index += 1;
+        if (word_index >= word_count) return -1;
+
+        word = ~set->words[word_index];
+    }
 }
 
-#if NB_ENABLE_ASSERTS
-#include <dbghelp.h>
-#if COMPILER_CL
-#pragma comment(lib, "Dbghelp.lib")
-#endif
+static void
+nb_bitset_binary(NB_Bitset *dest, NB_Bitset *a, NB_Bitset *b, NB_Bitset_Op op) {
+    assert((dest->count == a->count) && (a->count == b->count));
+    nb_bitset_get_kernels()->binary(dest->words, a->words, b->words, NB_BITSET_WORD_COUNT(a->count), op);
+}
 
-#include <inttypes.h>
+NB_EXTERN void nb_bitset_and(NB_Bitset *dest, NB_Bitset *a, NB_Bitset *b)    { nb_bitset_binary(dest, a, b, NB_BITSET_AND); }
+NB_EXTERN void nb_bitset_or(NB_Bitset *dest, NB_Bitset *a, NB_Bitset *b)     { nb_bitset_binary(dest, a, b, NB_BITSET_OR); }
+NB_EXTERN void nb_bitset_xor(NB_Bitset *dest, NB_Bitset *a, NB_Bitset *b)    { nb_bitset_binary(dest, a, b, NB_BITSET_XOR); }
+NB_EXTERN void nb_bitset_andnot(NB_Bitset *dest, NB_Bitset *a, NB_Bitset *b) { nb_bitset_binary(dest, a, b, NB_BITSET_ANDNOT); }
 
-// Windows Server 2003 and Windows XP: The sum of the FramesToSkip and FramesToCapture parameters must be less than 63.
-#define NB_MAX_STACK_FRAMES 63
-#define NB_MAX_SYMBOL_NAME 255
 
-NB_EXTERN char *nb_get_stacktrace(void) {
-    char *result = null;
-    HANDLE process = GetCurrentProcess();
- 
-    static BOOL initted = false;
-    if (!initted) {
-        initted = SymInitialize(process, null, TRUE);
-        SymSetOptions(SYMOPT_LOAD_LINES);
+
+NB_EXTERN void
+nb_heap_init(NB_Heap *heap, s64 capacity, NB_Allocator allocator) {
+    heap->entries   = null;
+    heap->count     = 0;
+    heap->capacity  = 0;
+    heap->allocator = allocator.proc ? allocator : nb_current_allocator;
+
+    if (capacity > 0) nb_heap_reserve(heap, capacity);
+}
+
+// The 3 padding entries put the children of entry i, 4i+1..4i+4, at the
+// start of a cache line.
+#define NB_HEAP_PADDING (NB_CACHE_LINE_SIZE / size_of(NB_Heap_Entry) - 1)
+
+NB_EXTERN void
+nb_heap_release(NB_Heap *heap) {
+    if (heap->entries) {
+        heap->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_FREE, nb_allocator_align_flag(NB_CACHE_LINE_SIZE)), 0, 0,
+                             heap->entries - NB_HEAP_PADDING, heap->allocator.data);
     }
 
-    if (initted == TRUE) {
-        void *stack[NB_MAX_STACK_FRAMES];
+    heap->entries  = null;
+    heap->count    = 0;
+    heap->capacity = 0;
+}
 
-        u8 buf[size_of(SYMBOL_INFO) + (NB_MAX_SYMBOL_NAME+1)];
+NB_EXTERN bool
+nb_heap_reserve(NB_Heap *heap, s64 capacity) {
+    if (capacity <= heap->capacity) return true;
 
-        SYMBOL_INFO *symbol_info = (SYMBOL_INFO *)buf;
-        symbol_info->MaxNameLen = NB_MAX_SYMBOL_NAME;
-        symbol_info->SizeOfStruct = size_of(SYMBOL_INFO);
+    s64 old_size = heap->entries ? (heap->capacity + NB_HEAP_PADDING) * size_of(NB_Heap_Entry) : 0;
+    NB_Heap_Entry *base = (NB_Heap_Entry *)heap->allocator.proc(nb_allocator_mode(NB_ALLOCATOR_RESIZE, NB_ALLOCATOR_NO_ZERO | nb_allocator_align_flag(NB_CACHE_LINE_SIZE)),
+                                                                (capacity + NB_HEAP_PADDING) * size_of(NB_Heap_Entry), old_size,
+                                                                heap->entries ? heap->entries - NB_HEAP_PADDING : null,
+                                                                heap->allocator.data);
+    if (!base) return false;
 
-        IMAGEHLP_LINEW64 line64 = {};
-        line64.SizeOfStruct = size_of(IMAGEHLP_LINEW64);
+    heap->entries  = base + NB_HEAP_PADDING;
+    heap->capacity = capacity;
+    return true;
+}
 
-        u16 frames = CaptureStackBackTrace(0, NB_MAX_STACK_FRAMES, stack, null);
-        if (frames > 0) {
-            result = tprint("Caller stack:\n");
-            for (u16 index = 0; index < frames; ++index) {
-                DWORD64 dw_displacement64;
-                BOOL ok = SymFromAddr(process, (DWORD64)(stack[index]), &dw_displacement64, symbol_info);
-                if (!ok) continue;
+NB_EXTERN bool
+nb_heap_push(NB_Heap *heap, u64 key, u64 value) {
+    if (heap->count == heap->capacity) {
+        if (!nb_heap_reserve(heap, nb_max(heap->capacity * 2, 16))) return false;
+    }
 
-                s64 call_line;
-                s64 stack_line;
+    NB_Heap_Entry *entries = heap->entries;
 
-                DWORD64 call_address = (DWORD64)(stack[index]);  // Caller location.
-                DWORD64 stack_address = symbol_info->Address;    // Procedure location.
+    // Moves the parents down the hole instead of swapping.
+    s64 index = heap->count;
+    while (index > 0) {
+        s64 parent = (index - 1) / NB_HEAP_ARITY;
+        if (entries[parent].key <= key) break;
 
-                DWORD dw_displacement;
-                ok = SymGetLineFromAddrW64(process, call_address, &dw_displacement, &line64);
-                if (!ok) continue;
+        entries[index] = entries[parent];
+        index = parent;
+    }
 
-                call_line = line64.LineNumber;
+    entries[index].key   = key;
+    entries[index].value = value;
 
-                ok = SymGetLineFromAddrW64(process, stack_address, &dw_displacement, &line64);
-                if (!ok) continue;
+    heap->count += 1;
+    return true;
+}
 
-                stack_line = line64.LineNumber;
+NB_EXTERN bool
+nb_heap_pop(NB_Heap *heap, NB_Heap_Entry *entry) {
+    if (!heap->count) return false;
 
-#if COMPILER_GCC
-                char *s = tprint("%s0x%016I64u: %s(%I64d) Line %I64d\n", 
-                                 result, 
-                                 stack_address, 
-                                 symbol_info->Name, 
-                                 stack_line, 
-                                 call_line);
-#else
-                char *s = tprint("%s0x%016" PRIXPTR ": %s(%" PRId64 ") Line %" PRId64 "\n", 
-                                 result, 
-                                 stack_address, 
-                                 symbol_info->Name, 
-                                 stack_line, 
-                                 call_line);
-#endif
-                result = s;
-            }
+    NB_Heap_Entry *entries = heap->entries;
+    if (entry) *entry = entries[0];
+
+    heap->count -= 1;
+    s64 count = heap->count;
+    if (!count) return true;
+
+    NB_Heap_Entry last = entries[count];
+
+    s64 index = 0;
+    for (;;) {
+        s64 first = index * NB_HEAP_ARITY + 1;
+        if (first >= count) break;
+
+        s64 end = nb_min(first + NB_HEAP_ARITY, count);
+        s64 smallest = first;
+        for (s64 child = first + 1; child < end; ++child) {
+            if (entries[child].key < entries[smallest].key) smallest = child;
         }
-    } else {
-        nb_write_string("[backtrace] Error: Failed to SymInitialize.\n", true);
+
+        if (last.key <= entries[smallest].key) break;
+
+        entries[index] = entries[smallest];
+        index = smallest;
     }
 
-    return result;
+    entries[index] = last;
+    return true;
 }
 
-#undef NB_MAX_STACK_FRAMES
-#undef NB_MAX_SYMBOL_NAME
 
-#endif  // NB_ENABLE_ASSERTS
 
-NB_EXTERN wchar_t *
-nb_w32_utf8_to_wide(const char *s, NB_Allocator allocator) {
-    NB_Allocator old_allocator = NB_SET_ALLOCATOR(allocator);
-    wchar_t *result = null;
+NB_EXTERN void
+nb_timer_wheel_init(NB_Timer_Wheel *wheel, s64 capacity, NB_Allocator allocator) {
+    nb_memory_zero_struct(wheel);
+    nb_handle_pool_init_type(&wheel->timers, NB_Timer, capacity, allocator);
 
-    if (s) {
-        s64 byte_count = nb_string_length(s);
+    for (s64 index = 0; index < nb_array_count(wheel->slots); ++index) {
+        wheel->slots[index] = NB_TIMER_WHEEL_NONE;
+    }
+}
 
-        int len = MultiByteToWideChar(CP_UTF8, 0, s, (int)byte_count, null, 0);
-        if (len > 0) {
-            result = nb_new_array(wchar_t, len+1);
-            MultiByteToWideChar(CP_UTF8, 0, s, (int)byte_count, result, len);
-            result[len] = 0;
-        }
+NB_EXTERN void
+nb_timer_wheel_release(NB_Timer_Wheel *wheel) {
+    if (wheel->links) {
+        wheel->timers.allocator.proc(nb_allocator_mode(NB_ALLOCATOR_FREE, 0), 0, 0, wheel->links, wheel->timers.allocator.data);
     }
 
-    NB_SET_ALLOCATOR(old_allocator);
-    return result;
+    nb_handle_pool_release(&wheel->timers);
+    nb_memory_zero_struct(wheel);
 }
 
+static void
+nb_timer_wheel_link(NB_Timer_Wheel *wheel, u32 index) {
+    NB_Timer_Link *link = wheel->links + index;
 
-NB_EXTERN void *
-nb_heap_allocator(NB_Allocator_Mode mode, 
-                  s64 size, s64 old_size, 
-                  void *old_memory, 
-                  void *allocator_data) {
-    UNUSED(allocator_data);
+    u64 delta = link->expires - wheel->now;
+    if (delta > NB_TIMER_WHEEL_MAX_DELAY) delta = NB_TIMER_WHEEL_MAX_DELAY;
 
-    switch (mode) {
-        case NB_ALLOCATOR_ALLOCATE:
-            return HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, (umm)size);
+    // The level whose slots are wider than the delta ...
+    u32 level = 0;
+    while ((level < NB_TIMER_WHEEL_LEVELS - 1) &&
+           (delta >> ((level + 1) * NB_TIMER_WHEEL_SLOT_BITS))) {
+        level += 1;
+    }
 
-        case NB_ALLOCATOR_RESIZE: {
-            // Allocate, copy, free.
+    // ... and the slot holding the deadline, parked ones use the farthest
+    // deadline in range.
+    u64 expires = wheel->now + delta;
+    u32 slot = (u32)(expires >> (level * NB_TIMER_WHEEL_SLOT_BITS)) & NB_TIMER_WHEEL_SLOT_MASK;
+    u32 slot_index = level * NB_TIMER_WHEEL_SLOTS + slot;
 
-            void *result = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, (umm)size);
-            if (result == null) return null;
+    u32 head = wheel->slots[slot_index];
+    if (head != NB_TIMER_WHEEL_NONE) wheel->links[head].prev = index;
 
-            if (old_memory && (old_size > 0)) {
-                memcpy(result, old_memory, (umm)old_size);
-                HeapFree(GetProcessHeap(), 0, old_memory);
-            }
+    link->prev = NB_TIMER_WHEEL_NONE;
+    link->next = head;
+    link->slot = slot_index;
 
-            return result;
-        } break;
+    wheel->slots[slot_index] = index;
+    wheel->occupied[level]  |= 1ull << slot;
+}
 
-        case NB_ALLOCATOR_FREE: {
-            HeapFree(GetProcessHeap(), 0, old_memory);
-            return null;
-        } break;
+static void
+nb_timer_wheel_unlink(NB_Timer_Wheel *wheel, u32 index) {
+    NB_Timer_Link *link = wheel->links + index;
 
-        case NB_ALLOCATOR_FREE_ALL: {
-            // Not supported.
-            assert(!"Not supported");
-            return null;
-        } break;
+    if (link->prev != NB_TIMER_WHEEL_NONE) wheel->links[link->prev].next = link->next;
+    else                                   wheel->slots[link->slot] = link->next;
 
-        default: {
-            assert(false);
-            return null;
-        } break;
+    if (link->next != NB_TIMER_WHEEL_NONE) wheel->links[link->next].prev = link->prev;
+
+    if (wheel->slots[link->slot] == NB_TIMER_WHEEL_NONE) {
+        wheel->occupied[link->slot / NB_TIMER_WHEEL_SLOTS] &= ~(1ull << (link->slot & NB_TIMER_WHEEL_SLOT_MASK));
     }
 }
 
-#endif  // OS_WINDOWS
+static void
+nb_timer_wheel_cascade(NB_Timer_Wheel *wheel, u32 level) {
+    u32 slot = (u32)(wheel->now >> (level * NB_TIMER_WHEEL_SLOT_BITS)) & NB_TIMER_WHEEL_SLOT_MASK;
 
+    // Wrapping this level too, the level above comes down first.
+    if ((slot == 0) && (level + 1 < NB_TIMER_WHEEL_LEVELS)) nb_timer_wheel_cascade(wheel, level + 1);
 
+    if (!(wheel->occupied[level] & (1ull << slot))) return;
 
-#if OS_LINUX
+    u32 slot_index = level * NB_TIMER_WHEEL_SLOTS + slot;
+    u32 index = wheel->slots[slot_index];
 
-#include <unistd.h>
-#include <stdlib.h>
+    wheel->slots[slot_index] = NB_TIMER_WHEEL_NONE;
+    wheel->occupied[level]  &= ~(1ull << slot);
 
-void nb_write_string(const char *s, bool to_standard_error) {
-    int handle = to_standard_error ? STDERR_FILENO : STDOUT_FILENO;
-    ssize_t written = write(handle, s, nb_string_length(s));
-    UNUSED(written);
-}
+    while (index != NB_TIMER_WHEEL_NONE) {
+        u32 next = wheel->links[index].next;
 
-void nb_write_string_count(const char *s, u32 count, bool to_standard_error) {
-    int handle = to_standard_error ? STDERR_FILENO : STDOUT_FILENO;
-    ssize_t written = write(handle, s, count);
-    UNUSED(written);
+        nb_timer_wheel_link(wheel, index);
+        index = next;
+    }
 }
 
-void nb_write_new_string(NB_String s, bool to_standard_error) {
-    int handle = to_standard_error ? STDERR_FILENO : STDOUT_FILENO;
-    ssize_t written = write(handle, s.data, s.count);
-    UNUSED(written);
-}
+static s64
+nb_timer_wheel_tick(NB_Timer_Wheel *wheel) {
+    wheel->now += 1;
 
-static const char *ansi_system_console_text_colors[NB_TEXT_COUNT] = {
-    "\x1b[30m",   // NB_TEXT_BLACK
-    "\x1b[34m",   // NB_TEXT_DARK_BLUE
-    "\x1b[32m",   // NB_TEXT_DARK_GREEN
-    "\x1b[36m",   // NB_TEXT_LIGHT_BLUE
-    "\x1b[31m",   // NB_TEXT_DARK_RED
-    "\x1b[35m",   // NB_TEXT_MAGENTA
-    "\x1b[33m",   // NB_TEXT_ORANGE
-    "\x1b[37m",   // NB_TEXT_LIGHT_GRAY
-    "\x1b[90m",   // NB_TEXT_GRAY
-    "\x1b[94m",   // NB_TEXT_BLUE
-    "\x1b[92m",   // NB_TEXT_GREEN
-    "\x1b[96m",   // NB_TEXT_CYAN
-    "\x1b[91m",   // NB_TEXT_RED
-    "\x1b[95m",   // NB_TEXT_PURPLE
-    "\x1b[93m",   // NB_TEXT_YELLOW
-    "\x1b[97m",   // NB_TEXT_WHITE
-};
+    u32 slot = (u32)wheel->now & NB_TIMER_WHEEL_SLOT_MASK;
+    if (slot == 0) nb_timer_wheel_cascade(wheel, 1);
 
-NB_EXTERN void 
-nb_set_console_text_color(NB_System_Console_Text_Color color, 
-                          bool to_standard_error) {
-    // Checking if the handle is connected to a terminal.
-    if (isatty(to_standard_error ? STDERR_FILENO : STDOUT_FILENO)) {
-        nb_write_string(ansi_system_console_text_colors[color], to_standard_error);
+    s64 fired = 0;
+
+    // The procs may add or cancel timers, so this takes one head at a time.
+    // New timers are at least a tick away and never land in this slot.
+    while (wheel->slots[slot] != NB_TIMER_WHEEL_NONE) {
+        u32 index = wheel->slots[slot];
+        nb_timer_wheel_unlink(wheel, index);
+
+        u32 handle = (wheel->timers.slots[index].generation << NB_HANDLE_INDEX_BITS) | index;
+        NB_Timer *timer = (NB_Timer *)nb_handle_pool_get(&wheel->timers, handle);
+
+        NB_Timer_Proc *proc = timer->proc;
+        void *data = timer->data;
+
+        if (timer->period) {
+            wheel->links[index].expires = wheel->now + timer->period;
+            nb_timer_wheel_link(wheel, index);
+        } else {
+            nb_handle_pool_remove(&wheel->timers, handle);
+        }
+
+        fired += 1;
+        if (proc) proc(data, handle);
     }
+
+    return fired;
 }
 
-NB_EXTERN void 
-nb_set_console_text_color_ansi(NB_System_Console_Text_Color color, 
-                               bool to_standard_error) {
-    nb_write_string(ansi_system_console_text_colors[color], to_standard_error);
+NB_EXTERN s64
+nb_timer_wheel_advance(NB_Timer_Wheel *wheel, u64 ticks) {
+    s64 fired = 0;
+
+    for (u64 tick = 0; tick < ticks; ++tick) {
+        if (!wheel->timers.count) {
+            // Nothing to fire or cascade, the empty slots need no visit.
+            wheel->now += ticks - tick;
+            break;
+        }
+
+        fired += nb_timer_wheel_tick(wheel);
+    }
+
+    return fired;
 }
 
+NB_EXTERN u32
+nb_timer_add(NB_Timer_Wheel *wheel, u64 delay, u64 period, NB_Timer_Proc *proc, void *data) {
+    NB_Timer *timer;
+    u32 handle = nb_handle_pool_add(&wheel->timers, (void **)&timer);
+    if (handle == NB_HANDLE_NONE) return NB_HANDLE_NONE;
+
+    // The links follow the slots of the pool.
+    if (wheel->link_capacity < wheel->timers.capacity) {
+        NB_Allocator allocator = wheel->timers.allocator;
+        NB_Timer_Link *links = (NB_Timer_Link *)allocator.proc(nb_allocator_mode(NB_ALLOCATOR_RESIZE, NB_ALLOCATOR_NO_ZERO),
+                                                               wheel->timers.capacity * size_of(NB_Timer_Link),
+                                                               wheel->link_capacity * size_of(NB_Timer_Link),
+                                                               wheel->links,
+                                                               allocator.data);
+        if (!links) {
+            nb_handle_pool_remove(&wheel->timers, handle);
+            return NB_HANDLE_NONE;
+        }
 
-#include <stdio.h>
+        wheel->links         = links;
+        wheel->link_capacity = wheel->timers.capacity;
+    }
 
+    timer->period = period;
+    timer->proc   = proc;
+    timer->data   = data;
 
-NB_EXTERN bool 
-nb_abort_error_message(const char *title, 
-                       const char *message, 
-                       const char *details) {
-    UNUSED(title);
-    UNUSED(message);
-    UNUSED(details);
+    u32 index = nb_handle_index(handle);
+    wheel->links[index].expires = wheel->now + nb_max(delay, 1);
+    nb_timer_wheel_link(wheel, index);
 
-    fflush(stderr);
-    return true;
+    return handle;
 }
 
-#if NB_ENABLE_ASSERTS
+NB_EXTERN bool
+nb_timer_cancel(NB_Timer_Wheel *wheel, u32 timer) {
+    if (!nb_handle_pool_get(&wheel->timers, timer)) return false;
 
-#include <execinfo.h>
-#include <inttypes.h>
+    nb_timer_wheel_unlink(wheel, nb_handle_index(timer));
+    nb_handle_pool_remove(&wheel->timers, timer);
+    return true;
+}
 
-NB_EXTERN char *nb_get_stacktrace(void) {
-    char *result = null;
 
-    // @Note: to print the stack, compile with -rdynamic.
-    const int MAX_STACK_FRAMES = 64;
-    void *stack[MAX_STACK_FRAMES];
 
-    int frames = backtrace(stack, MAX_STACK_FRAMES);
-    if (frames > 0) {
-        print("Caller stack:\n");
+static void
+nb_qsort_insertion(u8 *data, s64 count, s64 stride, s64 (*qsort_compare)(void *, void *)) {
+    // Swapping down beats a memmove rotation, the runs are short.
+    for (s64 index = 1; index < count; ++index) {
+        u8 *item = data + index * stride;
 
-        char **symbols = backtrace_symbols(stack, frames);
-        if (symbols) {
-            for (int index = 0; index < frames; index++) {
-                void *stack_address = stack[index];
+        while ((item > data) && (qsort_compare(item, item - stride) < 0)) {
+            nb_swap_two_memory_blocks(item, item - stride, stride);
+            item -= stride;
+        }
+    }
+}
 
-                // @Todo: line numbers...
-                s64 stack_line = 0;
-                s64 call_line  = 0;
+static void
+nb_qsort_sift_down(u8 *data, s64 root, s64 count, s64 stride, s64 (*qsort_compare)(void *, void *)) {
+    for (;;) {
+        s64 child = root * 2 + 1;
+        if (child >= count) break;
 
-                // @Todo: Actually allocate and append to the result!!
+        u8 *child_address = data + child * stride;
+        if ((child + 1 < count) && (qsort_compare(child_address, child_address + stride) < 0)) {
+            child += 1;
+            child_address += stride;
+        }
 
-#if COMPILER_GCC
-                print("0x%016zu: %s(%ld) Line %ld\n", 
-                      (size_t)stack_address, 
-                      symbols[index], 
-                      stack_line, call_line);
-#else
-                print("0x%016" PRIXPTR ": %s(%" PRId64 ") Line %" PRId64 "\n", 
-                      (size_t)stack_address, 
-                      symbols[index], 
-                      stack_line, call_line);
-#endif
-            }
+        u8 *root_address = data + root * stride;
+        if (qsort_compare(root_address, child_address) >= 0) break;
+
+        nb_swap_two_memory_blocks(root_address, child_address, stride);
+        root = child;
+    }
+}
 
-            free(symbols);
-        }
+static void
+nb_qsort_heap(u8 *data, s64 count, s64 stride, s64 (*qsort_compare)(void *, void *)) {
+    for (s64 index = count / 2 - 1; index >= 0; --index) {
+        nb_qsort_sift_down(data, index, count, stride, qsort_compare);
     }
 
-    return result;
+    for (s64 end = count - 1; end > 0; --end) {
+        nb_swap_two_memory_blocks(data, data + end * stride, stride);
+        nb_qsort_sift_down(data, 0, end, stride, qsort_compare);
+    }
 }
 
-#endif  // NB_ENABLE_ASSERTS
-
-NB_EXTERN void *
-nb_heap_allocator(NB_Allocator_Mode mode, 
-                  s64 size, s64 old_size, 
-                  void *old_memory, 
-                  void *allocator_data) {
-    UNUSED(allocator_data);
+static s64
+nb_qsort_median_of_3(u8 *data, s64 a, s64 b, s64 c, s64 stride, s64 (*qsort_compare)(void *, void *)) {
+    u8 *x = data + a * stride;
+    u8 *y = data + b * stride;
+    u8 *z = data + c * stride;
 
-    switch (mode) {
-        case NB_ALLOCATOR_ALLOCATE:
-            // @Todo: mmap?
-            return malloc((umm)size);
+    if (qsort_compare(x, y) < 0) {
+        if (qsort_compare(y, z) < 0) return b;
+        return (qsort_compare(x, z) < 0) ? c : a;
+    }
 
-        case NB_ALLOCATOR_RESIZE: {
-            // Allocate, copy, free.
+    if (qsort_compare(x, z) < 0) return a;
+    return (qsort_compare(y, z) < 0) ? c : b;
+}
 
-            void *result = malloc((umm)size);
-            if (result == null) return null;
+// Moves the pivot to data[0], partitions the rest around it and returns
+// the pivot's final index.
+static s64
+nb_qsort_partition(u8 *data, s64 count, s64 stride, s64 (*qsort_compare)(void *, void *)) {
+    // The samples skip both ends, see nb_sort_introsort().
+    s64 first  = 1;
+    s64 middle = count / 2;
+    s64 last   = count - 2;
+    s64 pivot;
+    if (count > NB_SORT_NINTHER_THRESHOLD) {
+        s64 step = count / 8;
+        pivot = nb_qsort_median_of_3(data,
+                                     nb_qsort_median_of_3(data, first, first + step, first + step * 2, stride, qsort_compare),
+                                     nb_qsort_median_of_3(data, middle - step, middle, middle + step, stride, qsort_compare),
+                                     nb_qsort_median_of_3(data, last - step * 2, last - step, last, stride, qsort_compare),
+                                     stride, qsort_compare);
+    } else {
+        pivot = nb_qsort_median_of_3(data, first, middle, last, stride, qsort_compare);
+    }
 
-            if (old_memory && (old_size > 0)) {
-                memcpy(result, old_memory, (umm)old_size);
-                free(old_memory);
-            }
+    if (pivot) nb_swap_two_memory_blocks(data, data + pivot * stride, stride);
 
-            return result;
-        } break;
+    // Hoare partition, stopping on equal items keeps the halves balanced
+    // when the keys repeat.
+    s64 i = 0;
+    s64 j = count;
+    for (;;) {
+        do { i += 1; } while ((i < count) && (qsort_compare(data + i * stride, data) < 0));
+        do { j -= 1; } while (qsort_compare(data, data + j * stride) < 0);
 
-        case NB_ALLOCATOR_FREE: {
-            free(old_memory);
-            return null;
-        } break;
+        if (i >= j) break;
+        nb_swap_two_memory_blocks(data + i * stride, data + j * stride, stride);
+    }
 
-        case NB_ALLOCATOR_FREE_ALL: {
-            // Not supported.
-            assert(!"Not supported");
-            return null;
-        } break;
+    if (j) nb_swap_two_memory_blocks(data, data + j * stride, stride);
+    return j;
+}
 
-        default: {
-            assert(false);
-            return null;
-        } break;
+static void
+nb_qsort_introsort(u8 *data, s64 count, s64 depth, s64 stride, s64 (*qsort_compare)(void *, void *)) {
+    while (count > NB_SORT_INSERTION_THRESHOLD) {
+        if (depth == 0) {
+            nb_qsort_heap(data, count, stride, qsort_compare);
+            return;
+        }
+        depth -= 1;
+
+        s64 pivot = nb_qsort_partition(data, count, stride, qsort_compare);
+
+        // Recurses in the smaller side, so the stack stays O(log n).
+        s64 left_count  = pivot;
+        s64 right_count = count - pivot - 1;
+        if (left_count < right_count) {
+            nb_qsort_introsort(data, left_count, depth, stride, qsort_compare);
+            data  += (pivot + 1) * stride;
+            count  = right_count;
+        } else {
+            nb_qsort_introsort(data + (pivot + 1) * stride, right_count, depth, stride, qsort_compare);
+            count  = left_count;
+        }
     }
-    return null;
+
+    nb_qsort_insertion(data, count, stride, qsort_compare);
 }
 
-#endif  // OS_LINUX
+NB_EXTERN void 
+nb_qsort(void *data, s64 count, 
+         s64 stride, 
+         s64 (*qsort_compare)(void *, void *)) {
+    if (count < 2) return;
 
+    s64 depth = 2 * (s64)nb_find_most_significant_set_bit64((u64)count);
+    nb_qsort_introsort((u8 *)data, count, depth, stride, qsort_compare);
+}
 
+NB_EXTERN void 
+nb_qsort_it(void *data, s64 count, 
+            s64 stride, 
+            s64 (*qsort_compare)(void *, void *)) {
+    if (count < 2) return;
 
-NB_EXTERN void *
-nb_talloc(NB_Temporary_Storage *ts, s64 nbytes) {
-    assert(ts->allocator.proc != null);
+    // The larger side is pushed and the loop goes on with the smaller one,
+    // which at least halves the working range with every push, so the
+    // stack never holds more than log2(count) ranges.
+    struct {
+        u8 *data;
+        s64 count;
+        s64 depth;
+    } stack[64];
+    s32 top = 0;
+
+    u8 *range = (u8 *)data;
+    s64 depth = 2 * (s64)nb_find_most_significant_set_bit64((u64)count);
+
+    for (;;) {
+        if (count <= NB_SORT_INSERTION_THRESHOLD) {
+            nb_qsort_insertion(range, count, stride, qsort_compare);
+        } else if (depth == 0) {
+            nb_qsort_heap(range, count, stride, qsort_compare);
+        } else {
+            depth -= 1;
+
+            s64 pivot = nb_qsort_partition(range, count, stride, qsort_compare);
+
+            u8 *left_data   = range;
+            s64 left_count  = pivot;
+            u8 *right_data  = range + (pivot + 1) * stride;
+            s64 right_count = count - pivot - 1;
+
+            assert(top < (s32)nb_array_count(stack));
+            if (left_count < right_count) {
+                stack[top].data  = right_data;
+                stack[top].count = right_count;
+                stack[top].depth = depth;
+                range = left_data;
+                count = left_count;
+            } else {
+                stack[top].data  = left_data;
+                stack[top].count = left_count;
+                stack[top].depth = depth;
+                range = right_data;
+                count = right_count;
+            }
+            top += 1;
+            continue;
+        }
 
-    if (!ts->data) {
-        if (!ts->size) ts->size = NB_TS_SIZE_DEFAULT;
+        if (!top) break;
 
-        ts->data = (u8 *)ts->allocator.proc(NB_ALLOCATOR_ALLOCATE, 
-                                            ts->size, 0, 
-                                            null, 
-                                            ts->allocator.data);
-        if (!ts->data) return null;
+        // Pop.
+        top  -= 1;
+        range = stack[top].data;
+        count = stack[top].count;
+        depth = stack[top].depth;
     }
+}
 
-#if NB_DEBUG
-    if (nbytes > (ts->size - ts->occupied)) {
-        ts->high_water_mark += nbytes;
-
-        u32 old_mode = nb_logger_push_mode(NB_LOG_WARNING);
-        const char *old_ident = nb_logger_push_ident("Temporary_Storage");
 
-#if OS_WINDOWS && COMPILER_GCC
-        Log("Attempting to allocate from the heap, highest water mark: %I64d\n", 
-            ts->high_water_mark);
-#else
-        Log("Attempting to allocate from the heap, highest water mark: %" PRId64 "\n", 
-            ts->high_water_mark);
-#endif
 
-        nb_logger_push_mode(old_mode);
-        nb_logger_push_ident(old_ident);
-        return nb_heap_allocator(NB_ALLOCATOR_ALLOCATE, nbytes, 0, null, null);
-    }
-#else
-    // @Cleanup:
-    // assert(nbytes <= (ts->size - ts->occupied));
-#endif // NB_DEBUG
+// Maps the keys to u32 keys that sort in the same order, and back.
+enum {
+    NB_RADIX_SORT_KEY_U32,
+    NB_RADIX_SORT_KEY_S32,
+    NB_RADIX_SORT_KEY_FLOAT32,
+};
 
-    void *result = ts->data + ts->occupied;
-    ts->occupied += nbytes;
-    return result;
+NB_INLINE u32
+nb_radix_sort_encode(u32 key, u32 kind) {
+    if (kind == NB_RADIX_SORT_KEY_S32) return key ^ 0x80000000u;
+    if (kind == NB_RADIX_SORT_KEY_FLOAT32) return key ^ ((key >> 31) ? 0xFFFFFFFFu : 0x80000000u);
+    return key;
 }
 
-NB_EXTERN void *
-nb_talloc_align(NB_Temporary_Storage *ts, s64 size, s64 alignment) {
-    s64 nbytes = size;
+NB_INLINE u32
+nb_radix_sort_decode(u32 key, u32 kind) {
+    if (kind == NB_RADIX_SORT_KEY_S32) return key ^ 0x80000000u;
+    if (kind == NB_RADIX_SORT_KEY_FLOAT32) return key ^ ((key >> 31) ? 0x80000000u : 0xFFFFFFFFu);
+    return key;
+}
 
-    s64 extra = (alignment - (nbytes % alignment)) % alignment;
-    nbytes += extra;
+static void
+nb_radix_sort_insertion32(u32 *keys, u32 *values, s64 count) {
+    for (s64 index = 1; index < count; ++index) {
+        u32 key = keys[index];
+        u32 value = values ? values[index] : 0;
+
+        s64 at = index;
+        while ((at > 0) && (keys[at - 1] > key)) {
+            keys[at] = keys[at - 1];
+            if (values) values[at] = values[at - 1];
+            at -= 1;
+        }
 
-    if (!ts->allocator.proc) {
-        ts->allocator.proc = nb_heap_allocator;
-        ts->allocator.data = null;
+        keys[at] = key;
+        if (values) values[at] = value;
     }
+}
 
-    return nb_talloc(ts, nbytes);
+static void
+nb_radix_sort_insertion64(u64 *keys, u32 *values, s64 count) {
+    for (s64 index = 1; index < count; ++index) {
+        u64 key = keys[index];
+        u32 value = values ? values[index] : 0;
+
+        s64 at = index;
+        while ((at > 0) && (keys[at - 1] > key)) {
+            keys[at] = keys[at - 1];
+            if (values) values[at] = values[at - 1];
+            at -= 1;
+        }
+
+        keys[at] = key;
+        if (values) values[at] = value;
+    }
 }
 
-NB_EXTERN NB_ALLOCATOR_PROC(nb_temporary_storage_proc) {
-    UNUSED(allocator_data);
+static bool
+nb_radix_sort32(u32 *keys, u32 *values, s64 count, u32 kind) {
+    assert((count >= 0) && (count <= NB_MAX_U32));
 
-    NB_Temporary_Storage *ts = &nb_temporary_storage;
+    if (count < NB_RADIX_SORT_SMALL) {
+        for (s64 index = 0; index < count; ++index) keys[index] = nb_radix_sort_encode(keys[index], kind);
+        nb_radix_sort_insertion32(keys, values, count);
+        for (s64 index = 0; index < count; ++index) keys[index] = nb_radix_sort_decode(keys[index], kind);
+        return true;
+    }
 
-    if (!ts->allocator.proc) {
-        ts->allocator.proc = nb_heap_allocator;
-        ts->allocator.data = null;
+    const s32 pass_count = (32 + NB_RADIX_SORT_DIGIT_BITS - 1) / NB_RADIX_SORT_DIGIT_BITS;
+
+    s64 mark = nb_get_temporary_storage_mark();
+    u32 *counts      = (u32 *)nb_talloc_align(&nb_temporary_storage, pass_count * NB_RADIX_SORT_BUCKETS * size_of(u32), 64);
+    u32 *temp_keys   = (u32 *)nb_talloc_align(&nb_temporary_storage, count * size_of(u32), 64);
+    u32 *temp_values = values ? (u32 *)nb_talloc_align(&nb_temporary_storage, count * size_of(u32), 64) : null;
+    if (!counts || !temp_keys || (values && !temp_values)) {
+        nb_set_temporary_storage_mark(mark);
+        return false;
     }
 
-    s64 nbytes = size;
-    s64 alignment = 8;
+    memset(counts, 0, (umm)(pass_count * NB_RADIX_SORT_BUCKETS * size_of(u32)));
 
-    s64 extra = (alignment - (nbytes % alignment)) % alignment;
-    nbytes += extra;
+    // The encoding is written back during the count, the last pass or the
+    // copy back decodes.
+    for (s64 index = 0; index < count; ++index) {
+        u32 key = nb_radix_sort_encode(keys[index], kind);
+        keys[index] = key;
 
-    switch (mode) {
-        case NB_ALLOCATOR_ALLOCATE: {
-/*
-            if (!ts->data) {
-                if (!ts->size) ts->size = NB_TS_SIZE_DEFAULT;
+        for (s32 pass = 0; pass < pass_count; ++pass) {
+            counts[pass * NB_RADIX_SORT_BUCKETS + ((key >> (pass * NB_RADIX_SORT_DIGIT_BITS)) & (NB_RADIX_SORT_BUCKETS - 1))] += 1;
+        }
+    }
 
-                ts->data = (u8 *)ts->allocator.proc(NB_ALLOCATOR_ALLOCATE, 
-                                                    ts->size, 0, 
-                                                    null, 
-                                                    ts->allocator.data);
-                if (!ts->data) return null;
-            }
+    u32 *source_keys   = keys;
+    u32 *source_values = values;
+    u32 *dest_keys     = temp_keys;
+    u32 *dest_values   = temp_values;
 
-#if NB_DEBUG
-            if (nbytes > (ts->size - ts->occupied)) {
-                ts->high_water_mark += nbytes;
+    for (s32 pass = 0; pass < pass_count; ++pass) {
+        u32 *offsets = counts + pass * NB_RADIX_SORT_BUCKETS;
+        u32 shift = (u32)pass * NB_RADIX_SORT_DIGIT_BITS;
 
-                u32 old_mode = nb_logger_push_mode(NB_LOG_WARNING);
-                const char *old_ident = nb_logger_push_ident("Temporary_Storage");
+        // Every key has this digit, the pass would not move anything.
+        if (offsets[(source_keys[0] >> shift) & (NB_RADIX_SORT_BUCKETS - 1)] == (u32)count) continue;
 
-#if OS_WINDOWS && COMPILER_GCC
-                Log("Attempting to allocate from the heap, highest water mark: %I64d\n", 
-                    ts->high_water_mark);
-#else
-                Log("Attempting to allocate from the heap, highest water mark: %" PRId64 "\n", 
-                    ts->high_water_mark);
-#endif
+        u32 sum = 0;
+        for (s32 bucket = 0; bucket < NB_RADIX_SORT_BUCKETS; ++bucket) {
+            u32 bucket_count = offsets[bucket];
+            offsets[bucket] = sum;
+            sum += bucket_count;
+        }
 
-                nb_logger_push_mode(old_mode);
-                nb_logger_push_ident(old_ident);
-                return nb_heap_allocator(NB_ALLOCATOR_ALLOCATE, nbytes, 0, null, null);
+        if (values) {
+            for (s64 index = 0; index < count; ++index) {
+                u32 key = source_keys[index];
+                u32 at  = offsets[(key >> shift) & (NB_RADIX_SORT_BUCKETS - 1)]++;
+                dest_keys[at]   = key;
+                dest_values[at] = source_values[index];
             }
-#else
-            // @Cleanup:
-            assert(nbytes <= (ts->size - ts->occupied));
-#endif
+        } else {
+            for (s64 index = 0; index < count; ++index) {
+                u32 key = source_keys[index];
+                dest_keys[offsets[(key >> shift) & (NB_RADIX_SORT_BUCKETS - 1)]++] = key;
+            }
+        }
 
-            void *result = ts->data + ts->occupied;
-            ts->occupied += nbytes;
-            return result;
-*/
-            return nb_talloc(ts, nbytes);
-        } break;
+        u32 *swap_keys   = source_keys;
+        u32 *swap_values = source_values;
+        source_keys   = dest_keys;
+        source_values = dest_values;
+        dest_keys     = swap_keys;
+        dest_values   = swap_values;
+    }
 
-        case NB_ALLOCATOR_RESIZE: {
-            // Bump allocators do not resize so we allocate
-            // a new chunk of memory using the new size.
+    for (s64 index = 0; index < count; ++index) {
+        keys[index] = nb_radix_sort_decode(source_keys[index], kind);
+    }
 
+    if (values && (source_values != values)) {
+        memcpy(values, source_values, (umm)(count * size_of(u32)));
+    }
 
-/*
-            // @Cutnpaste: from ALLOCATOR_ALLOCATE.
-#if NB_DEBUG
-            if (nbytes > (ts->size - ts->occupied)) {
-                ts->high_water_mark += nbytes;
+    nb_set_temporary_storage_mark(mark);
+    return true;
+}
 
-                u32 old_mode = nb_logger_push_mode(NB_LOG_WARNING);
-                const char *old_ident = nb_logger_push_ident("Temporary_Storage");
+NB_EXTERN bool
+nb_radix_sort_u32(u32 *keys, u32 *values, s64 count) {
+    return nb_radix_sort32(keys, values, count, NB_RADIX_SORT_KEY_U32);
+}
 
-#if OS_WINDOWS && COMPILER_GCC
-                Log("Attempting to allocate from the heap, highest water mark: %I64d\n", 
-                    ts->high_water_mark);
-#else
-                Log("Attempting to allocate from the heap, highest water mark: %" PRId64 "\n", 
-                    ts->high_water_mark);
-#endif
+NB_EXTERN bool
+nb_radix_sort_s32(s32 *keys, u32 *values, s64 count) {
+    return nb_radix_sort32((u32 *)keys, values, count, NB_RADIX_SORT_KEY_S32);
+}
 
-                nb_logger_push_mode(old_mode);
-                nb_logger_push_ident(old_ident);
-                return nb_heap_allocator(NB_ALLOCATOR_ALLOCATE, nbytes, 0, null, null);
-            }
-#else
-            // @Cleanup:
-            assert(nbytes <= (ts->size - ts->occupied));
-#endif
+NB_EXTERN bool
+nb_radix_sort_float32(float32 *keys, u32 *values, s64 count) {
+    return nb_radix_sort32((u32 *)keys, values, count, NB_RADIX_SORT_KEY_FLOAT32);
+}
 
-            void *result = ts->data + ts->occupied;
-            ts->occupied += nbytes;
-*/
+NB_EXTERN bool
+nb_radix_sort_u64(u64 *keys, u32 *values, s64 count) {
+    assert((count >= 0) && (count <= NB_MAX_U32));
 
-            void *result = nb_talloc(ts, nbytes);
+    if (count < NB_RADIX_SORT_SMALL) {
+        nb_radix_sort_insertion64(keys, values, count);
+        return true;
+    }
 
-            if (old_memory && (old_size > 0)) {
-                memcpy(result, old_memory, (umm)nb_min(old_size, nbytes));
-            }
+    const s32 pass_count = (64 + NB_RADIX_SORT_DIGIT_BITS - 1) / NB_RADIX_SORT_DIGIT_BITS;
 
-            return result;
-        } break;
+    s64 mark = nb_get_temporary_storage_mark();
+    u32 *counts      = (u32 *)nb_talloc_align(&nb_temporary_storage, pass_count * NB_RADIX_SORT_BUCKETS * size_of(u32), 64);
+    u64 *temp_keys   = (u64 *)nb_talloc_align(&nb_temporary_storage, count * size_of(u64), 64);
+    u32 *temp_values = values ? (u32 *)nb_talloc_align(&nb_temporary_storage, count * size_of(u32), 64) : null;
+    if (!counts || !temp_keys || (values && !temp_values)) {
+        nb_set_temporary_storage_mark(mark);
+        return false;
+    }
 
-        case NB_ALLOCATOR_FREE:
-            // Not supported.
-            assert(false);
-            return null;
+    memset(counts, 0, (umm)(pass_count * NB_RADIX_SORT_BUCKETS * size_of(u32)));
 
-        case NB_ALLOCATOR_FREE_ALL: {
-            ts->allocator.proc(NB_ALLOCATOR_FREE, 0, 0, ts->data, ts->allocator.data);
-            ts->data = null;
-            ts->size = 0;
-            ts->occupied = 0;
-            ts->high_water_mark = 0;
-            return null;
-        } break;
+    for (s64 index = 0; index < count; ++index) {
+        u64 key = keys[index];
 
-        default:
-            assert(false);
-            return null;
+        for (s32 pass = 0; pass < pass_count; ++pass) {
+            counts[pass * NB_RADIX_SORT_BUCKETS + ((key >> (pass * NB_RADIX_SORT_DIGIT_BITS)) & (NB_RADIX_SORT_BUCKETS - 1))] += 1;
+        }
     }
-}
 
+    u64 *source_keys   = keys;
+    u32 *source_values = values;
+    u64 *dest_keys     = temp_keys;
+    u32 *dest_values   = temp_values;
 
+    for (s32 pass = 0; pass < pass_count; ++pass) {
+        u32 *offsets = counts + pass * NB_RADIX_SORT_BUCKETS;
+        u32 shift = (u32)pass * NB_RADIX_SORT_DIGIT_BITS;
 
-static s64 
-nb_get_partition_index_for_qsort(u8 *data, 
-                                 s64 low, s64 high, 
-                                 s64 stride, 
-                                 s64 (*qsort_compare)(void *, void *)) {
-    u8 *pivot_address = data + high * stride;
+        if (offsets[(source_keys[0] >> shift) & (NB_RADIX_SORT_BUCKETS - 1)] == (u32)count) continue;
 
-    u8 *start = data + low  * stride;
-    u8 *end   = data + high * stride;
-
-    s64 i = low - 1;
+        u32 sum = 0;
+        for (s32 bucket = 0; bucket < NB_RADIX_SORT_BUCKETS; ++bucket) {
+            u32 bucket_count = offsets[bucket];
+            offsets[bucket] = sum;
+            sum += bucket_count;
+        }
 
-    for (u8 *it = start; it < end; it += stride) {
-        if (qsort_compare(it, pivot_address) < 0) {
-            i += 1;
-            nb_swap_two_memory_blocks(data + i * stride, it, stride);
+        if (values) {
+            for (s64 index = 0; index < count; ++index) {
+                u64 key = source_keys[index];
+                u32 at  = offsets[(key >> shift) & (NB_RADIX_SORT_BUCKETS - 1)]++;
+                dest_keys[at]   = key;
+                dest_values[at] = source_values[index];
+            }
+        } else {
+            for (s64 index = 0; index < count; ++index) {
+                u64 key = source_keys[index];
+                dest_keys[offsets[(key >> shift) & (NB_RADIX_SORT_BUCKETS - 1)]++] = key;
+            }
         }
-    }
 
-    nb_swap_two_memory_blocks(data + (i+1) * stride, pivot_address, stride);
-    return i + 1;
-}
+        u64 *swap_keys   = source_keys;
+        u32 *swap_values = source_values;
+        source_keys   = dest_keys;
+        source_values = dest_values;
+        dest_keys     = swap_keys;
+        dest_values   = swap_values;
+    }
 
-NB_EXTERN void 
-nb_qsort(void *data, s64 count, 
-         s64 stride, 
-         s64 (*qsort_compare)(void *, void *)) {
-    if (count < 2) return;
+    if (source_keys != keys) {
+        memcpy(keys, source_keys, (umm)(count * size_of(u64)));
+        if (values) memcpy(values, source_values, (umm)(count * size_of(u32)));
+    }
 
-    u8 *start = (u8 *)data;
-    u8 *pivot_address = start + (count / 2) * stride;
+    nb_set_temporary_storage_mark(mark);
+    return true;
+}
 
-    s64 i = 0;
-    s64 j = count-1;
 
-    while (1) {
-        while (qsort_compare(start + i*stride, pivot_address) < 0) { i += 1; }
-        while (qsort_compare(pivot_address, start + j*stride) < 0) { j -= 1; }
 
-        if (i >= j) break;
+// memcpy with a runtime size is a call, the common strides get plain moves.
+NB_INLINE void
+nb_merge_sort_copy_item(u8 *dest, u8 *source, s64 stride) {
+    if (stride == 8)      { u64 item; memcpy(&item, source, 8); memcpy(dest, &item, 8); }
+    else if (stride == 4) { u32 item; memcpy(&item, source, 4); memcpy(dest, &item, 4); }
+    else                  memcpy(dest, source, (umm)stride);
+}
 
-        nb_swap_two_memory_blocks(start + i*stride, start + j*stride, stride);
+// Items of 'base' that go before 'key': the ones <= key when 'upper',
+// the ones < key otherwise.
+static s64
+nb_merge_sort_gallop(u8 *key, u8 *base, s64 count, bool upper, s64 stride, s64 (*compare)(void *, void *)) {
+#define NB_MERGE_SORT_BEFORE(index) (upper ? (compare(base + (index) * stride, key) <= 0) : (compare(base + (index) * stride, key) < 0))
+    if (!count || !NB_MERGE_SORT_BEFORE(0)) return 0;
+
+    // Exponential probe from the start, then binary search the last gap.
+    s64 last_before = 0;
+    s64 step = 1;
+    while ((last_before + step < count) && NB_MERGE_SORT_BEFORE(last_before + step)) {
+        last_before += step;
+        step *= 2;
+    }
 
-        i += 1;
-        j -= 1;
+    s64 low  = last_before + 1;
+    s64 high = nb_min(last_before + step, count);
+    while (low < high) {
+        s64 middle = low + (high - low) / 2;
+        if (NB_MERGE_SORT_BEFORE(middle)) low = middle + 1;
+        else                              high = middle;
     }
+#undef NB_MERGE_SORT_BEFORE
 
-    nb_qsort(start, i, stride, qsort_compare);
-    nb_qsort(start + i*stride, count-i, stride, qsort_compare);
+    return low;
 }
 
-NB_EXTERN void 
-nb_qsort_it(void *data, s64 count, 
-            s64 stride, 
-            s64 (*qsort_compare)(void *, void *)) {
-    if (count < 2) return;
+static void
+nb_merge_sort_merge(u8 *left_run, s64 left_count, s64 right_count, u8 *temp, s64 stride, s64 (*compare)(void *, void *)) {
+    u8 *right = left_run + left_count * stride;
+
+    s64 skip = nb_merge_sort_gallop(right, left_run, left_count, true, stride, compare);
+    left_run   += skip * stride;
+    left_count -= skip;
+    if (!left_count) return;
+
+    right_count = nb_merge_sort_gallop(left_run + (left_count - 1) * stride, right, right_count, false, stride, compare);
+    if (!right_count) return;
+
+    memcpy(temp, left_run, (umm)(left_count * stride));
+
+    u8 *left      = temp;
+    u8 *left_end  = temp + left_count * stride;
+    u8 *right_end = right + right_count * stride;
+    u8 *dest      = left_run;
+
+    s64 left_wins  = 0;
+    s64 right_wins = 0;
+    while ((left < left_end) && (right < right_end)) {
+        if (left_wins >= NB_MERGE_SORT_MIN_GALLOP) {
+            s64 run = nb_merge_sort_gallop(right, left, (left_end - left) / stride, true, stride, compare);
+            memcpy(dest, left, (umm)(run * stride));
+            dest += run * stride;
+            left += run * stride;
+
+            left_wins = 0;
+            if (left == left_end) break;
+        } else if (right_wins >= NB_MERGE_SORT_MIN_GALLOP) {
+            // dest trails the right run, the block may overlap it.
+            s64 run = nb_merge_sort_gallop(left, right, (right_end - right) / stride, false, stride, compare);
+            memmove(dest, right, (umm)(run * stride));
+            dest  += run * stride;
+            right += run * stride;
+
+            right_wins = 0;
+            if (right == right_end) break;
+        }
 
-    // s64 *qsort_stack = nb_new_array(s64, count * 2);
-    s64 mark = nb_get_temporary_storage_mark();
-    s64 *qsort_stack = (s64 *)nb_talloc(&nb_temporary_storage, size_of(s64) * count * 2);
+        if (compare(right, left) < 0) {
+            nb_merge_sort_copy_item(dest, right, stride);
+            right += stride;
+            right_wins += 1;
+            left_wins   = 0;
+        } else {
+            nb_merge_sort_copy_item(dest, left, stride);
+            left += stride;
+            left_wins += 1;
+            right_wins = 0;
+        }
+
+        dest += stride;
+    }
+
+    // What is left of the right run is in place already.
+    memcpy(dest, left, (umm)(left_end - left));
+}
 
-    // Push.
-    qsort_stack[0] = 0;
-    qsort_stack[1] = count-1;
+NB_EXTERN bool
+nb_merge_sort(void *data_, s64 count, s64 stride, s64 (*compare)(void *, void *)) {
+    u8 *data = (u8 *)data_;
+    if (count < 2) return true;
 
-    int top = 1;
-    while (top >= 0) {
-        // Pop.
-        s64 high = qsort_stack[top--];
-        s64 low  = qsort_stack[top--];
+    // nb_qsort_insertion only swaps strictly smaller items down, it is stable.
+    if (count <= NB_MERGE_SORT_MIN_RUN) {
+        nb_qsort_insertion(data, count, stride, compare);
+        return true;
+    }
 
-        s64 pivot_index = nb_get_partition_index_for_qsort((u8 *)data, low, high, stride, qsort_compare);
+    // Every run but the last has NB_MERGE_SORT_MIN_RUN items at least.
+    s64 mark = nb_get_temporary_storage_mark();
+    s64 *runs = (s64 *)nb_talloc_align(&nb_temporary_storage, (count / NB_MERGE_SORT_MIN_RUN + 2) * size_of(s64), 8);
+    u8  *temp = (u8 *)nb_talloc_align(&nb_temporary_storage, count * stride, 16);
+    if (!runs || !temp) {
+        nb_set_temporary_storage_mark(mark);
+        return false;
+    }
 
-        // Insert array intervals using the pivot index.
+    s64 run_count = 0;
+    for (s64 start = 0; start < count;) {
+        s64 end = start + 1;
+        if (end < count) {
+            if (compare(data + end * stride, data + start * stride) < 0) {
+                // Only strictly descending, reversing equal items would
+                // break the stability.
+                end += 1;
+                while ((end < count) && (compare(data + end * stride, data + (end - 1) * stride) < 0)) end += 1;
+
+                for (s64 i = start, j = end - 1; i < j; ++i, --j) {
+                    nb_swap_two_memory_blocks(data + i * stride, data + j * stride, stride);
+                }
+            } else {
+                end += 1;
+                while ((end < count) && (compare(data + end * stride, data + (end - 1) * stride) >= 0)) end += 1;
+            }
+        }
 
-        if ((pivot_index - 1) > low) {
-            qsort_stack[++top] = low;
-            qsort_stack[++top] = pivot_index - 1;
+        if (end - start < NB_MERGE_SORT_MIN_RUN) {
+            end = nb_min(start + NB_MERGE_SORT_MIN_RUN, count);
+            nb_qsort_insertion(data + start * stride, end - start, stride, compare);
         }
 
-        if ((pivot_index + 1) < high) {
-            qsort_stack[++top] = pivot_index + 1;
-            qsort_stack[++top] = high;
+        runs[run_count++] = start;
+        start = end;
+    }
+    runs[run_count] = count;
+
+    // Each pass merges the runs two by two, the merged starts are written
+    // behind the ones still to read.
+    while (run_count > 1) {
+        s64 merged = 0;
+        for (s64 run = 0; run + 1 < run_count; run += 2) {
+            nb_merge_sort_merge(data + runs[run] * stride,
+                                runs[run + 1] - runs[run], runs[run + 2] - runs[run + 1],
+                                temp, stride, compare);
+            runs[merged++] = runs[run];
         }
+
+        if (run_count & 1) runs[merged++] = runs[run_count - 1];
+        runs[merged] = count;
+        run_count = merged;
     }
 
     nb_set_temporary_storage_mark(mark);
+    return true;
 }
 
 NB_EXTERN void 
@@ -1909,12 +8782,12 @@ nb_sprint_valist(char *buf, int size, const char *fmt, va_list arg_list) {
     return result;
 }
 
-NB_EXTERN char *mprint(const char *fmt, ...) {
+NB_EXTERN char *(mprint)(const char *fmt, ...) {
     char *result = null;
     int size = NB_PRINT_INITIAL_GUESS;
 
     while (1) {
-        result = nb_new_array(char, size);
+        result = nb_new_array_no_zero(char, size);
         if (!result) return null;
         
         va_list args;
@@ -1935,13 +8808,13 @@ NB_EXTERN char *mprint(const char *fmt, ...) {
 }
 
 NB_EXTERN char *
-mprint_guess(int size, const char *fmt, ...) {
+(mprint_guess)(int size, const char *fmt, ...) {
     assert(size > 0);
     
     char *result = null;
 
     while (1) {
-        result = nb_new_array(char, size);
+        result = nb_new_array_no_zero(char, size);
         if (!result) return null;
         
         va_list args;
@@ -1962,12 +8835,12 @@ mprint_guess(int size, const char *fmt, ...) {
 }
 
 NB_EXTERN char *
-mprint_valist(const char *fmt, va_list arg_list) {
+(mprint_valist)(const char *fmt, va_list arg_list) {
     char *result = null;
     int size = NB_PRINT_INITIAL_GUESS;
 
     while (1) {
-        result = nb_new_array(char, size);
+        result = nb_new_array_no_zero(char, size);
         if (!result) return null;
         
         va_list args;
@@ -2099,12 +8972,135 @@ NB_EXTERN void print(const char *fmt, ...) {
 #define ALLOCATOR_RESIZE   NB_ALLOCATOR_RESIZE
 #define ALLOCATOR_FREE     NB_ALLOCATOR_FREE
 #define ALLOCATOR_FREE_ALL NB_ALLOCATOR_FREE_ALL
+#define ALLOCATOR_ZERO     NB_ALLOCATOR_ZERO
+#define ALLOCATOR_NO_ZERO  NB_ALLOCATOR_NO_ZERO
+#define ALLOCATOR_LARGE_PAGES NB_ALLOCATOR_LARGE_PAGES
+#define ALLOCATOR_QUERY_STATS NB_ALLOCATOR_QUERY_STATS
+
+#define allocator_query_stats nb_allocator_query_stats
+#define register_allocator    nb_register_allocator
+#define unregister_allocator  nb_unregister_allocator
+#define allocator_report      nb_allocator_report
 
 #define new_array nb_new_array
 
 #define String NB_String
 #define make_string nb_make_string
 
+#define Hash_Map            NB_Hash_Map
+#define hash_map_init       nb_hash_map_init
+#define hash_map_init_type  nb_hash_map_init_type
+#define hash_map_release    nb_hash_map_release
+#define hash_map_reset      nb_hash_map_reset
+#define hash_map_next       nb_hash_map_next
+#define hash_u64            nb_hash_u64
+#define hash_bytes          nb_hash_bytes
+#define hash_string         nb_hash_string
+
+#define Interner           NB_Interner
+#define intern             nb_intern
+#define intern_cstring     nb_intern_cstring
+#define interner_find      nb_interner_find
+#define interner_get       nb_interner_get
+#define interner_release   nb_interner_release
+
+#define Handle_Pool          NB_Handle_Pool
+#define HANDLE_NONE          NB_HANDLE_NONE
+#define handle_pool_init     nb_handle_pool_init
+#define handle_pool_init_type nb_handle_pool_init_type
+#define handle_pool_release  nb_handle_pool_release
+#define handle_pool_add      nb_handle_pool_add
+#define handle_pool_remove   nb_handle_pool_remove
+#define handle_pool_reset    nb_handle_pool_reset
+#define handle_pool_get      nb_handle_pool_get
+#define handle_pool_item     nb_handle_pool_item
+
+#define Bucket_Array           NB_Bucket_Array
+#define bucket_array_init      nb_bucket_array_init
+#define bucket_array_init_type nb_bucket_array_init_type
+#define bucket_array_release   nb_bucket_array_release
+#define bucket_array_add       nb_bucket_array_add
+#define bucket_array_remove    nb_bucket_array_remove
+#define bucket_array_next      nb_bucket_array_next
+#define bucket_array_get       nb_bucket_array_get
+
+#define SPSC_Ring         NB_SPSC_Ring
+#define MPMC_Ring         NB_MPMC_Ring
+#define spsc_ring_init    nb_spsc_ring_init
+#define spsc_ring_release nb_spsc_ring_release
+#define spsc_ring_push    nb_spsc_ring_push
+#define spsc_ring_pop     nb_spsc_ring_pop
+#define mpmc_ring_init    nb_mpmc_ring_init
+#define mpmc_ring_release nb_mpmc_ring_release
+#define mpmc_ring_push    nb_mpmc_ring_push
+#define mpmc_ring_pop     nb_mpmc_ring_pop
+
+#define Small_String                NB_Small_String
+#define Small_Array                 NB_Small_Array
+#define small_string_init           nb_small_string_init
+#define small_string_release        nb_small_string_release
+#define small_string_append         nb_small_string_append
+#define small_string_append_cstring nb_small_string_append_cstring
+#define small_string_print          nb_small_string_print
+#define small_string_cstring        nb_small_string_cstring
+#define small_string_view           nb_small_string_view
+#define small_string_reset          nb_small_string_reset
+#define small_array_init            nb_small_array_init
+#define small_array_init_type       nb_small_array_init_type
+#define small_array_release         nb_small_array_release
+#define small_array_add             nb_small_array_add
+#define small_array_push            nb_small_array_push
+#define small_array_items           nb_small_array_items
+#define small_array_at              nb_small_array_at
+
+#define Bitset                  NB_Bitset
+#define bitset_init             nb_bitset_init
+#define bitset_init_buffer      nb_bitset_init_buffer
+#define bitset_release          nb_bitset_release
+#define bitset_resize           nb_bitset_resize
+#define bitset_get              nb_bitset_get
+#define bitset_set              nb_bitset_set
+#define bitset_clear            nb_bitset_clear
+#define bitset_toggle           nb_bitset_toggle
+#define bitset_set_range        nb_bitset_set_range
+#define bitset_clear_range      nb_bitset_clear_range
+#define bitset_clear_all        nb_bitset_clear_all
+#define bitset_popcount         nb_bitset_popcount
+#define bitset_find_next_set    nb_bitset_find_next_set
+#define bitset_find_next_clear  nb_bitset_find_next_clear
+#define bitset_and              nb_bitset_and
+#define bitset_or               nb_bitset_or
+#define bitset_xor              nb_bitset_xor
+#define bitset_andnot           nb_bitset_andnot
+#define count_set_bits64        nb_count_set_bits64
+
+#define Heap                    NB_Heap
+#define Heap_Entry              NB_Heap_Entry
+#define heap_init               nb_heap_init
+#define heap_release            nb_heap_release
+#define heap_reserve            nb_heap_reserve
+#define heap_push               nb_heap_push
+#define heap_pop                nb_heap_pop
+#define heap_peek               nb_heap_peek
+#define heap_reset              nb_heap_reset
+
+#define Timer                   NB_Timer
+#define Timer_Proc              NB_Timer_Proc
+#define Timer_Link              NB_Timer_Link
+#define Timer_Wheel             NB_Timer_Wheel
+#define timer_wheel_init        nb_timer_wheel_init
+#define timer_wheel_release     nb_timer_wheel_release
+#define timer_wheel_advance     nb_timer_wheel_advance
+#define timer_wheel_count       nb_timer_wheel_count
+#define timer_add               nb_timer_add
+#define timer_cancel            nb_timer_cancel
+
+#define radix_sort_u32          nb_radix_sort_u32
+#define radix_sort_s32          nb_radix_sort_s32
+#define radix_sort_float32      nb_radix_sort_float32
+#define radix_sort_u64          nb_radix_sort_u64
+#define merge_sort              nb_merge_sort
+
 #define Log_Mode    NB_Log_Mode
 #define LOG_NONE    NB_LOG_NONE
 #define LOG_ERROR   NB_LOG_ERROR
@@ -2124,9 +9120,13 @@ NB_EXTERN void print(const char *fmt, ...) {
 #define set_temporary_storage_mark nb_set_temporary_storage_mark
 #define reset_temporary_storage nb_reset_temporary_storage
 
+#define frame_advance nb_frame_advance
+
 #define safe_truncate_u64 nb_safe_truncate_u64
 
 #define find_least_significant_set_bit nb_find_least_significant_set_bit
+#define find_least_significant_set_bit64 nb_find_least_significant_set_bit64
+#define find_most_significant_set_bit  nb_find_most_significant_set_bit
 #define swap_two_memory_blocks         nb_swap_two_memory_blocks
 
 #define get_current_os   nb_get_current_os
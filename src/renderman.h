@@ -112,7 +112,7 @@ void rm_texture_update(u32 texture_id, Renderman_Format format,
 typedef struct RMShader RMShader;
 
 // Compiles and creates a shader object from vertex and pixel shader text sources.
-// This uses the default bound allocator.
+// Shader objects come from the renderer's shader pool.
 RMShader *rm_shader_create(const char *vertex_shader_source,
                            const char *pixel_shader_source,
                            const char *shader_name);
@@ -121,6 +121,11 @@ RMShader *rm_shader_create_from_file(const char *vertex_shader_path,
                                      const char *pixel_shader_path,
                                      const char *shader_name);
 
+#if NB_TRACK_ALLOCATIONS
+// Reports the source buffers against the caller.
+#define rm_shader_create_from_file(...) NB_TRACK_CALL(RMShader *, rm_shader_create_from_file(__VA_ARGS__))
+#endif
+
 // Free the shader resources.
 void rm_shader_free(RMShader *shader);
 
@@ -93,7 +93,7 @@ typedef struct {
 } RMShader_State;
 
 struct RMShader {
-    char name[32];
+    u32 name_id;  // In rm_state.names.
     IDirect3DVertexShader9 *vs;
     IDirect3DPixelShader9  *ps;
 
@@ -117,10 +117,10 @@ typedef struct {
 
     RMShader *current_shader;
     RMShader *argb_texture_shader;
+    NB_Pool shader_pool;
+    NB_Interner names;
 
-    RM_Texture9 *texture_pointers;
-    u32 texture_pointer_allocated;
-    u32 texture_pointer_count;
+    NB_Handle_Pool textures;  // RM_Texture9, texture ids are its handles.
     u32 bound_texture_ids[16];
 
     u32 num_immediate_vertices;
@@ -256,10 +256,15 @@ static char *d3d_hresult_to_message(HRESULT hr) {
         TCHAR *s = (TCHAR *)DXGetErrorString(hr);
         TCHAR *d = (TCHAR *)DXGetErrorDescription(hr);
 
-        char *error_str  = b_w32_wide_to_utf8(s, 0, nb_temporary_allocator);
-        char *error_desc = b_w32_wide_to_utf8(d, 0, nb_temporary_allocator);
+        // Only the final message goes to the temporary storage.
+        NB_Scratch scratch = nb_get_scratch(null, 0);
+
+        char *error_str  = b_w32_wide_to_utf8(s, 0, nb_scratch_allocator(scratch));
+        char *error_desc = b_w32_wide_to_utf8(d, 0, nb_scratch_allocator(scratch));
 
         result = tprint("%s: %s", error_str, error_desc);
+
+        nb_release_scratch(scratch);
     }
 
     return result;
@@ -641,6 +646,11 @@ NB_EXTERN bool rm_init(u32 window_id) {
     rm_state.current_shader = null;
     // rm_shader_state_init(&rm_state.current_state);
 
+    nb_pool_init_type(&rm_state.shader_pool, RMShader, 
+                      /*slots_per_slab=*/16, NB_GET_ALLOCATOR());
+    nb_handle_pool_init_type(&rm_state.textures, RM_Texture9, 
+                             /*capacity=*/64, NB_GET_ALLOCATOR());
+
     if (!d3d_immediate_mode_init()) {
         return false;
     }
@@ -676,6 +686,15 @@ NB_EXTERN bool rm_init(u32 window_id) {
 NB_EXTERN void rm_finish(void) {
     d3d_immediate_mode_release();
 
+    nb_pool_release(&rm_state.shader_pool);
+    nb_interner_release(&rm_state.names);
+
+    for (u32 index = 0; index < rm_state.textures.count; ++index) {
+        RM_Texture9 *t9 = (RM_Texture9 *)nb_handle_pool_item(&rm_state.textures, index);
+        IDirect3DTexture9_Release(t9->pointer);
+    }
+    nb_handle_pool_release(&rm_state.textures);
+
     if (rm_state.d3d_device) {
         IDirect3DDevice9_Release(rm_state.d3d_device);
         rm_state.d3d_device = null;
@@ -1220,37 +1239,14 @@ rm_texture_create(Renderman_Format format, u32 x, u32 y, u32 z,
         }
     }
 
-    if (!rm_state.texture_pointers || !rm_state.texture_pointer_allocated) {
-        rm_state.texture_pointer_allocated = 8;
-        rm_state.texture_pointer_count = 1;
-        rm_state.texture_pointers = nb_new_array(RM_Texture9, rm_state.texture_pointer_allocated);
-    }
-
-    if (rm_state.texture_pointer_count != 0) {
-        for (u32 index = 0; index < rm_state.texture_pointer_count; ++index) {
-            IDirect3DTexture9 *ptr = rm_state.texture_pointers[index].pointer;
-            if (ptr == null) {
-                result = index;
-                break;
-            }
-        }
-    }
-
-    if (rm_state.texture_pointer_count >= rm_state.texture_pointer_allocated) {
-        u32 old_size = rm_state.texture_pointer_allocated * size_of(RM_Texture9);
-        rm_state.texture_pointer_allocated *= 2;
-        rm_state.texture_pointers = (RM_Texture9 *)nb_realloc(rm_state.texture_pointers,
-                                       rm_state.texture_pointer_allocated*size_of(RM_Texture9),
-                                       old_size);
-    }
-
-    if (result == -1) {
-        result = rm_state.texture_pointer_count;
-        rm_state.texture_pointer_count += 1;
+    RM_Texture9 *t9;
+    result = nb_handle_pool_add(&rm_state.textures, (void **)&t9);
+    if (result == NB_HANDLE_NONE) {
+        nb_log_print(NB_LOG_ERROR, "D3D9", "Failed to grow the texture table.");
+        IDirect3DTexture9_Release(texture);
+        return (u32)-1;
     }
 
-    assert(result != -1);
-    RM_Texture9 *t9 = rm_state.texture_pointers + result;
     t9->pointer = texture;
 
     if (filter) {
@@ -1271,13 +1267,12 @@ rm_texture_create(Renderman_Format format, u32 x, u32 y, u32 z,
 }
 
 NB_EXTERN void rm_texture_free(u32 texture_id) {
-    IDirect3DTexture9 *texture;
-
-    assert(texture_id != -1);
-    texture = rm_state.texture_pointers[texture_id].pointer;
-    rm_state.texture_pointers[texture_id].pointer = null;
+    RM_Texture9 *t9 = (RM_Texture9 *)nb_handle_pool_get(&rm_state.textures, texture_id);
+    assert(t9);  // The id is stale or was never created.
+    if (!t9) return;
 
-    IDirect3DTexture9_Release(texture);
+    IDirect3DTexture9_Release(t9->pointer);
+    nb_handle_pool_remove(&rm_state.textures, texture_id);
 }
 
 static void d3d_copy_texture_region(void *dest, void *src, u32 dest_pitch, u32 src_pitch, u32 width, u32 height) {
@@ -1303,8 +1298,11 @@ rm_texture_update(u32 texture_id, Renderman_Format format,
     RECT updated_rect;
     u32 bytes_per_pixel;
 
-    assert(texture_id != -1);
-    texture = rm_state.texture_pointers[texture_id].pointer;
+    RM_Texture9 *t9 = (RM_Texture9 *)nb_handle_pool_get(&rm_state.textures, texture_id);
+    assert(t9);  // The id is stale or was never created.
+    if (!t9) return;
+
+    texture = t9->pointer;
 
     bytes_per_pixel = 0;
 
@@ -1366,13 +1364,8 @@ rm_shader_create(const char *vertex_shader_source,
     IDirect3DVertexShader9 *vs;
     IDirect3DPixelShader9  *ps;
     DWORD *shader_data;
-    u32 index;
 
-    if (shader_name) {
-        assert(nb_string_length(shader_name) <= 32);
-    } else {
-        shader_name = "Unnamed";
-    }
+    if (!shader_name) shader_name = "Unnamed";
 
     UINT compile_flags = 0;
 #if NB_DEBUG
@@ -1463,12 +1456,15 @@ rm_shader_create(const char *vertex_shader_source,
     compiled_shader->Release();
 #endif
 
-    shader = New(RMShader);
-    
-    for (index = 0; (index < 32) && (shader_name[index] != 0); ++index) {
-        shader->name[index] = shader_name[index];
+    shader = (RMShader *)nb_pool_alloc(&rm_state.shader_pool);
+    if (!shader) {
+        IDirect3DVertexShader9_Release(vs);
+        IDirect3DPixelShader9_Release(ps);
+        return shader;
     }
-    shader->name[index] = 0;
+
+    nb_memory_zero_struct(shader);
+    shader->name_id = nb_intern_cstring(&rm_state.names, shader_name);
 
     shader->vs = vs;
     shader->ps = ps;
@@ -1478,9 +1474,9 @@ rm_shader_create(const char *vertex_shader_source,
     return shader;
 }
 
-NB_EXTERN RMShader *rm_shader_create_from_file(const char *vertex_shader_path,
-                                               const char *pixel_shader_path,
-                                               const char *shader_name) {
+NB_EXTERN RMShader *(rm_shader_create_from_file)(const char *vertex_shader_path,
+                                                 const char *pixel_shader_path,
+                                                 const char *shader_name) {
     char *vertex_shader_source, *pixel_shader_source;
     FILE *file;
     size_t size;
@@ -1493,7 +1489,7 @@ NB_EXTERN RMShader *rm_shader_create_from_file(const char *vertex_shader_path,
     size = ftell(file);
     rewind(file);
 
-    vertex_shader_source = nb_new_array(char, size + 1);
+    vertex_shader_source = nb_new_array_no_zero(char, size + 1);
     size = fread(vertex_shader_source, 1, size, file);
     fclose(file);
     vertex_shader_source[size] = 0;
@@ -1506,7 +1502,7 @@ NB_EXTERN RMShader *rm_shader_create_from_file(const char *vertex_shader_path,
     size = ftell(file);
     rewind(file);
 
-    pixel_shader_source = nb_new_array(char, size + 1);
+    pixel_shader_source = nb_new_array_no_zero(char, size + 1);
     size = fread(pixel_shader_source, 1, size, file);
     fclose(file);
     pixel_shader_source[size] = 0;
@@ -1528,7 +1524,7 @@ NB_EXTERN void rm_shader_free(RMShader *shader) {
     if (shader->vs) IDirect3DVertexShader9_Release(shader->vs);
     if (shader->ps) IDirect3DPixelShader9_Release(shader->ps);
 
-    nb_free(shader);
+    nb_pool_free(&rm_state.shader_pool, shader);
 }
 
 #if 0
@@ -1635,7 +1631,9 @@ NB_EXTERN void rm_shader_texture_set(RMShader *shader, u32 slot, u32 texture_id)
 
     if (shader == rm_state.current_shader) {
         if (rm_state.bound_texture_ids[slot] != texture_id) {
-            t9 = rm_state.texture_pointers + texture_id;
+            t9 = (RM_Texture9 *)nb_handle_pool_get(&rm_state.textures, texture_id);
+            assert(t9);  // The id is stale or was never created.
+            if (!t9) return;
 
             IDirect3DDevice9_SetSamplerState(rm_state.d3d_device, 0, D3DSAMP_MINFILTER, t9->min_filter);
             IDirect3DDevice9_SetSamplerState(rm_state.d3d_device, 0, D3DSAMP_MAGFILTER, t9->mag_filter);